@@ -0,0 +1,88 @@
+// aomw_cmd.ino - command interpreter with the topo, trace and stream commands
+/*****************************************************************************
+ * Copyright 2024 by ams OSRAM AG                                            *
+ * All rights are reserved.                                                  *
+ *                                                                           *
+ * IMPORTANT - PLEASE READ CAREFULLY BEFORE COPYING, INSTALLING OR USING     *
+ * THE SOFTWARE.                                                             *
+ *                                                                           *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS       *
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT         *
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS         *
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT  *
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,     *
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT          *
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,     *
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY     *
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT       *
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE     *
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.      *
+ *****************************************************************************/
+#include <aospi.h>
+#include <aoosp.h>
+#include <aocmd.h>
+#include <aomw.h>
+
+
+/*
+DESCRIPTION
+This demo runs the command interpreter with the commands of the middleware
+registered: `topo` (build, inspect and drive the chain), `trace` (dump
+the telegrams topo sent) and `stream` (receive binary frames, see 
+extras/aomw_stream_send.py). There is no animation; everything is done by
+typing commands over the serial port, e.g. `topo build`, `topo pwm 0 7fff`
+and `trace`, or by streaming from a host.
+
+HARDWARE
+The demo runs on the OSP32 board, no demo board needs to be attached, but 
+connect eg the SAIDbasic board to have a chain to inspect.
+In Arduino select board "ESP32S3 Dev Module".
+The trace only records telegrams when tracing is compiled in: define 
+AOMW_TRACE_ENABLED as 1 (in aomw_trace.h or as build flag).
+
+BEHAVIOR
+Waits for commands on the serial port (type `help` for a list).
+
+OUTPUT
+Welcome to aomw_cmd.ino
+version: result 0.4.1 spi 0.5.1 osp 0.4.1 cmd 0.4.1 mw 0.5.0
+spi: init
+osp: init
+cmd: init
+mw: init
+cmds: registered
+
+>> topo build
+>> trace count
+trace 41/256 entries
+*/
+
+
+// Pick commands that we want in this application
+void cmds_register() {
+  aocmd_register();           // include all standard apps from aocmd
+  aomw_topo_cmd_register();   // include the topo command
+  aomw_trace_cmd_register();  // include the trace command
+  aomw_stream_cmd_register(); // include the stream command
+  Serial.printf("cmds: registered\n");
+}
+
+
+void setup() {
+  Serial.begin(115200);
+  Serial.printf("\n\nWelcome to aomw_cmd.ino\n");
+  Serial.printf("version: result %s spi %s osp %s cmd %s mw %s\n", AORESULT_VERSION, AOSPI_VERSION, AOOSP_VERSION, AOCMD_VERSION, AOMW_VERSION );
+
+  aospi_init();
+  aoosp_init();
+  aocmd_init();
+  aomw_init();
+  cmds_register();
+  Serial.printf("\n");
+}
+
+
+void loop() {
+  // Process incoming characters (commands)
+  aocmd_cint_pollserial();
+}
@@ -34,7 +34,8 @@ for better flag rendering connect eg the SAIDbasic board.
 In Arduino select board "ESP32S3 Dev Module".
 
 BEHAVIOR
-Shows 8 country flags in a sequence, then repeats.
+Shows 8 country flags in a sequence, then repeats. By default the flags
+crossfade; only triplets that change color are updated.
 
 OUTPUT
 Welcome to aomw_flag.ino
@@ -75,6 +76,13 @@ void setup() {
 }
 
 
+// Maximum number of telegrams per transition step (one step per frame)
+#define TRANSITION_BUDGET  100
+// Number of frames in a fade, and time between frames
+#define TRANSITION_FRAMES   25
+#define TRANSITION_MS       20
+
+
 void loop() {
   aoresult_t result;
   #if 0
@@ -94,13 +102,24 @@ void loop() {
     delay(2000);
     result= aomw_flag_painter_china(); PRINT_ERROR();
     delay(2000);
-  #else
+  #elif 0
     for( int pix=0; pix<aomw_flag_count(); pix++ ) {
       Serial.printf("flag %s\n", aomw_flag_name(pix) );
       result= aomw_flag_painter(pix)(); PRINT_ERROR();
       delay(2000);
     }
     Serial.printf("\n");
+  #else
+    for( int pix=0; pix<aomw_flag_count(); pix++ ) {
+      Serial.printf("flag %s\n", aomw_flag_name(pix) );
+      aomw_flag_transition_start(pix, AOMW_FLAG_TRANSITION_FADE, TRANSITION_FRAMES);
+      while( !aomw_flag_transition_done() ) {
+        result= aomw_flag_transition_step(TRANSITION_BUDGET); PRINT_ERROR();
+        delay(TRANSITION_MS);
+      }
+      delay(2000);
+    }
+    Serial.printf("\n");
   #endif
 }
 
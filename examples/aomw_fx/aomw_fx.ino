@@ -0,0 +1,184 @@
+// aomw_fx.ino - cycles through the effects of the effects engine
+/*****************************************************************************
+ * Copyright 2024 by ams OSRAM AG                                            *
+ * All rights are reserved.                                                  *
+ *                                                                           *
+ * IMPORTANT - PLEASE READ CAREFULLY BEFORE COPYING, INSTALLING OR USING     *
+ * THE SOFTWARE.                                                             *
+ *                                                                           *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS       *
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT         *
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS         *
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT  *
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,     *
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT          *
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,     *
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY     *
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT       *
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE     *
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.      *
+ *****************************************************************************/
+#include <aospi.h>
+#include <aoosp.h>
+#include <aomw.h>
+
+
+/*
+DESCRIPTION
+This demo first creates a topology map of all nodes of the OSP chain.
+Next it plays the effects of the effects engine (chase, rainbow, breathing,
+sparkle, gradient), each for 5 seconds. Every tick the effect is rendered
+into the topo framebuffer within a time budget; when a frame is complete
+it is flushed, which only sends telegrams for the triplets that changed.
+
+HARDWARE
+The demo runs on the OSP32 board, no demo board needs to be attached, but 
+for better effects connect eg the SAIDbasic board.
+In Arduino select board "ESP32S3 Dev Module".
+
+BEHAVIOR
+Chase, rainbow, breathing, sparkle and gradient, 5 seconds each, repeated.
+At the end of each effect, some statistics are printed: frames, 
+telegrams sent, and the average number of dirty spans per frame.
+
+OUTPUT
+Welcome to aomw_fx.ino
+version: result 0.4.1 spi 0.5.1 osp 0.4.1 mw 0.5.0
+spi: init
+osp: init
+mw: init
+
+Starting effects on 17 RGBs
+chase     frames 250 telegrams 214 spans/frame 0.2
+rainbow   frames 250 telegrams 4250 spans/frame 1.0
+breathing frames 250 telegrams 4148 spans/frame 1.0
+sparkle   frames 250 telegrams 208 spans/frame 0.3
+gradient  frames 250 telegrams 16 spans/frame 0.0
+*/
+
+
+// === The effects ==========================================================
+
+
+// Time (in ms) between two ticks, the time budget (in us) for rendering per tick, and the duration (in ms) of one effect
+#define FX_TICK_MS   20
+#define FX_BUDGET_US 2000
+#define FX_SHOW_MS   5000
+
+
+// The effects to cycle through
+static const char * const fx_names[] = { "chase", "rainbow", "breathing", "sparkle", "gradient" };
+static aomw_fx_t fx_effects[] = {
+  { AOMW_FX_CHASE    , aomw_topo_white, aomw_topo_off , 2000, 4, 0, 0 },
+  { AOMW_FX_RAINBOW  , aomw_topo_off  , aomw_topo_off , 3000, 0, 0, 0 },
+  { AOMW_FX_BREATHING, aomw_topo_cyan , aomw_topo_off , 4000, 0, 0, 0 },
+  { AOMW_FX_SPARKLE  , aomw_topo_white, aomw_topo_blue,  100,40, 0, 0 },
+  { AOMW_FX_GRADIENT , aomw_topo_red  , aomw_topo_blue,    0, 0, 0, 0 },
+};
+#define FX_EFFECTS_SIZE ( sizeof(fx_effects)/sizeof(fx_effects[0]) )
+
+
+// The state of the effects state machine
+static int      fx_ix;        // The effect being shown
+static uint32_t fx_start_ms;  // When the effect started
+static uint32_t fx_tick_ms;   // When the last tick started
+static int      fx_frames;    // Statistics: number of completed frames
+static int      fx_spans;     // Statistics: sum of dirty spans over all frames
+static int      fx_telegrams; // Statistics: telegrams at start of effect
+
+
+// Start of the effects state machine (shows effect ix)
+static void fx_start(int ix) {
+  fx_ix= ix;
+  aomw_fx_start( &fx_effects[fx_ix] );
+  fx_start_ms= millis();
+  fx_tick_ms= fx_start_ms;
+  fx_frames= 0;
+  fx_spans= 0;
+  fx_telegrams= aospi_txcount_get();
+}
+
+
+// Step of the effects state machine
+static aoresult_t fx_step() {
+  if( millis()-fx_tick_ms < FX_TICK_MS ) return aoresult_ok; // not yet time for a tick
+  fx_tick_ms = millis();
+
+  // Render (part of) a frame; flush when complete
+  if( aomw_fx_render(fx_tick_ms, FX_BUDGET_US) ) {
+    fx_frames++;
+    fx_spans+= aomw_fx_numspans();
+    aoresult_t result= aomw_fx_flush();
+    if( result!=aoresult_ok ) return result;
+  }
+
+  // Next effect
+  if( millis()-fx_start_ms >= FX_SHOW_MS ) {
+    int telegrams= aospi_txcount_get()-fx_telegrams;
+    Serial.printf("%-9s frames %d telegrams %d spans/frame %.1f\n", fx_names[fx_ix], fx_frames, telegrams, fx_frames==0 ? 0.0 : (float)fx_spans/fx_frames );
+    fx_start( (fx_ix+1) % FX_EFFECTS_SIZE );
+  }
+  return aoresult_ok;
+}
+
+
+// === The application ======================================================
+
+
+// The application states
+#define APPSTATE_TOPOBUILD  1
+#define APPSTATE_FX         2
+#define APPSTATE_ERROR      3
+#define APPSTATE_DONE       4
+
+
+int appstate;
+
+
+void setup() {
+  Serial.begin(115200);
+  Serial.printf("\n\nWelcome to aomw_fx.ino\n");
+  Serial.printf("version: result %s spi %s osp %s mw %s\n", AORESULT_VERSION, AOSPI_VERSION, AOOSP_VERSION, AOMW_VERSION );
+
+  aospi_init();
+  aoosp_init();
+  aomw_init();
+  Serial.printf("\n");
+
+  aomw_topo_dim_set(64); // 64/1024 (~6%) of max brightness
+
+  appstate= APPSTATE_TOPOBUILD;
+  aomw_topo_build_start();
+}
+
+
+aoresult_t result;
+void loop() {
+  switch( appstate ) {
+
+    case APPSTATE_TOPOBUILD:
+      if( aomw_topo_build_done() ) {
+        Serial.printf("Starting effects on %d RGBs\n", aomw_topo_numtriplets() );
+        fx_start(0);
+        appstate= APPSTATE_FX;
+      }
+      result= aomw_topo_build_step(); 
+      if( result!=aoresult_ok ) appstate= APPSTATE_ERROR;
+    break;
+
+    case APPSTATE_FX:
+      result= fx_step(); 
+      if( result!=aoresult_ok ) appstate= APPSTATE_ERROR;
+    break;
+
+    case APPSTATE_ERROR:
+      Serial.printf("ERROR %s\n", aoresult_to_str(result,1));
+      appstate= APPSTATE_DONE;
+    break;
+
+    case APPSTATE_DONE:
+      // spin (after error is printed)
+    break;
+  }
+
+}
@@ -0,0 +1,120 @@
+// aomw_sched.ino - demonstrates the cooperative scheduler
+/*****************************************************************************
+ * Copyright 2024 by ams OSRAM AG                                            *
+ * All rights are reserved.                                                  *
+ *                                                                           *
+ * IMPORTANT - PLEASE READ CAREFULLY BEFORE COPYING, INSTALLING OR USING     *
+ * THE SOFTWARE.                                                             *
+ *                                                                           *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS       *
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT         *
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS         *
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT  *
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,     *
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT          *
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,     *
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY     *
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT       *
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE     *
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.      *
+ *****************************************************************************/
+#include <aospi.h>
+#include <aoosp.h>
+#include <aomw.h>
+
+
+/*
+DESCRIPTION
+This demo uses the cooperative scheduler to interleave several tasks. The 
+topo build runs as background task (one telegram per step). When the build
+is done, a periodic frame task plays an animation script, and a periodic 
+health task clears errors and switches the nodes back on. The frame task
+has an auto period: the scheduler picks the highest frame rate that the 
+chain sustains (based on the measured telegram cost of the triplets). A stats task 
+periodically prints the run-time accounting of all tasks.
+
+HARDWARE
+The demo runs on the OSP32 board, no demo board needs to be attached, but 
+for better animation script rendering connect eg the SAIDbasic board.
+In Arduino select board "ESP32S3 Dev Module".
+
+BEHAVIOR
+Plays the stock rainbow script, at the frame rate the chain sustains 
+(between 10 and 50 FPS, at half the bus time).
+Every 5 seconds the task statistics are printed.
+
+OUTPUT
+Welcome to aomw_sched.ino
+version: result 0.4.1 spi 0.5.1 osp 0.4.1 mw 0.5.0
+spi: init
+osp: init
+mw: init
+
+build done: 17 triplets, frame predicted 2210us
+task 0 build      off prio 1 bg runs 43 misses 0 avg 385us max 1270us (ok)
+task 1 frame      on  prio 3 period 20000us (auto) deadline 20000us runs 245 misses 0 avg 2311us max 2405us (ok)
+task 2 health     on  prio 2 period 1000000us deadline 1000000us runs 5 misses 0 avg 281us max 290us (ok)
+task 3 stats      on  prio 0 period 5000000us deadline 5000000us runs 1 misses 0 avg 0us max 0us (ok)
+*/
+
+
+// Task id of the frame task (enabled when the build is done)
+static int frame_tid;
+
+
+// Background task: steps the topo build; when done, starts the animation.
+static aoresult_t build_task( void * arg ) {
+  aoresult_t result= aomw_sched_task_topobuild(arg);
+  if( result==aoresult_ok && aomw_topo_build_done() ) {
+    Serial.printf("build done: %d triplets, frame predicted %luus\n", aomw_topo_numtriplets(), (unsigned long)aomw_topo_predict_us(aomw_topo_numtriplets()) );
+    aomw_tscript_install( aomw_tscript_rainbow(), aomw_topo_numtriplets() );
+    // Frame rate follows the chain: 50% bus utilization, between 50 FPS and 10 FPS
+    aomw_sched_autoperiod(frame_tid, aomw_topo_numtriplets(), 50, 20000, 100000);
+    aomw_sched_enable(frame_tid,1);
+  }
+  return result;
+}
+
+
+// Periodic task: in case there was an error (under voltage) in some node, broadcast clear all and broadcast switch back on.
+static aoresult_t health_task( void * arg ) {
+  (void)arg;
+  if( !aomw_topo_build_done() ) return aoresult_ok;
+  aoresult_t result= aoosp_send_clrerror(0x000);
+  if( result!=aoresult_ok ) return result;
+  return aoosp_send_goactive(0x000);
+}
+
+
+// Periodic task: prints the scheduler statistics.
+static aoresult_t stats_task( void * arg ) {
+  (void)arg;
+  aomw_sched_dump();
+  return aoresult_ok;
+}
+
+
+void setup() {
+  Serial.begin(115200);
+  Serial.printf("\n\nWelcome to aomw_sched.ino\n");
+  Serial.printf("version: result %s spi %s osp %s mw %s\n", AORESULT_VERSION, AOSPI_VERSION, AOOSP_VERSION, AOMW_VERSION );
+
+  aospi_init();
+  aoosp_init();
+  aomw_init();
+  Serial.printf("\n");
+
+  // Tasks: frames have the highest priority (20 FPS until the auto period takes over)
+  aomw_topo_build_start();
+  aomw_sched_add           ("build" , build_task             , NULL,       0,     0, 1);
+  frame_tid= aomw_sched_add("frame" , aomw_sched_task_tscript, NULL,   50000, 20000, 3);
+  aomw_sched_add           ("health", health_task            , NULL, 1000000,     0, 2);
+  aomw_sched_add           ("stats" , stats_task             , NULL, 5000000,     0, 0);
+  aomw_sched_enable(frame_tid,0); // enabled when build is done
+}
+
+
+void loop() {
+  aoresult_t result= aomw_sched_step();
+  if( result!=aoresult_ok ) Serial.printf("ERROR %s\n", aoresult_to_str(result,1));
+}
@@ -29,7 +29,8 @@ This demo first creates a topology map of all nodes of the OSP chain.
 Next it animates a running led animation, constantly updating the triplets.
 The topo map creation and running led animation is driven from a state
 machine. This would allow running commands from serial or scanning for 
-presses of UI buttons.
+presses of UI buttons. The animation draws in the framebuffer, and topo 
+scales frames to a power budget, so that no node trips on under voltage.
 
 HARDWARE
 The demo runs on the OSP32 board, no demo board needs to be attached, but 
@@ -49,6 +50,7 @@ mw: init
 
 Starting animation on 17 RGBs
 Brightness 64/1024
+Power budget 200mA
 */
 
 
@@ -59,6 +61,10 @@ Brightness 64/1024
 #define RUNLED_MS 25
 
 
+// Max estimated LED current (in mA) of a frame; brighter frames are scaled down by topo
+#define RUNLED_BUDGET_MA 200
+
+
 // The colors in the runled loop
 static const aomw_topo_rgb_t * const runled_rgbs[] = { &aomw_topo_blue, &aomw_topo_white };
 #define RUNLED_RGBS_SIZE ( sizeof(runled_rgbs)/sizeof(runled_rgbs[0]) )
@@ -85,8 +91,9 @@ static aoresult_t runled_step() {
   if( millis()-runled_ms < RUNLED_MS ) return aoresult_ok; // not yet time to update
   runled_ms = millis();
 
-  // Set triplet tix to color cix
-  aoresult_t result= aomw_topo_settriplet(runled_tix, runled_rgbs[runled_colorix] );
+  // Set triplet tix to color cix (the flush scales the frame to the power budget)
+  aomw_topo_fb_set(runled_tix, runled_rgbs[runled_colorix] );
+  aoresult_t result= aomw_topo_fb_flush();
   if( result!=aoresult_ok ) return result;
 
   // Go to next triplet
@@ -100,11 +107,6 @@ static aoresult_t runled_step() {
     if( runled_colorix==RUNLED_RGBS_SIZE ) {
       runled_colorix= 0;
     }
-    // Just in case there was and error (under voltage error) in some node, broadcast clear all and broadcast switch back on
-    result= aoosp_send_clrerror(0x000);
-    if( result!=aoresult_ok ) return result;
-    result=aoosp_send_goactive(0x000);
-    if( result!=aoresult_ok ) return result;
   }
   return aoresult_ok;
 }
@@ -134,6 +136,7 @@ void setup() {
   Serial.printf("\n");
 
   aomw_topo_dim_set(64); // 64/1024 (~6%) of max brightness
+  aomw_topo_power_budget_set(RUNLED_BUDGET_MA); // prevents under voltage (instead of clearing errors after the fact)
 
   appstate= APPSTATE_TOPOBUILD;
   aomw_topo_build_start();
@@ -148,6 +151,7 @@ void loop() {
       if( aomw_topo_build_done() ) {
         Serial.printf("Starting animation on %d RGBs\n", aomw_topo_numtriplets() );
         Serial.printf("Brightness %d/1024\n", aomw_topo_dim_get() );
+        Serial.printf("Power budget %lumA\n", (unsigned long)aomw_topo_power_budget_get() );
         runled_start();
         appstate= APPSTATE_RUNLED;
       }
@@ -0,0 +1,55 @@
+// Arduino.h - host stand-in for the Arduino core, just enough to compile aomw on Linux (see aomw_host.cpp)
+/*****************************************************************************
+ * Copyright 2024 by ams OSRAM AG                                            *
+ * All rights are reserved.                                                  *
+ *                                                                           *
+ * IMPORTANT - PLEASE READ CAREFULLY BEFORE COPYING, INSTALLING OR USING     *
+ * THE SOFTWARE.                                                             *
+ *                                                                           *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS       *
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT         *
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS         *
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT  *
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,     *
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT          *
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,     *
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY     *
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT       *
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE     *
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.      *
+ *****************************************************************************/
+#ifndef _ARDUINO_H_
+#define _ARDUINO_H_
+
+
+#include <stdint.h>     // uint32_t
+#include <stddef.h>     // size_t
+#include <string.h>     // strlen()
+#include <stdio.h>      // snprintf()
+#include <stdlib.h>     // abort()
+
+
+// The serial port is stdin/stdout
+class HardwareSerial {
+  public:
+    void   begin( long baud ) { (void)baud; }
+    int    printf( const char * format, ... ) __attribute__((format(printf,2,3)));
+    size_t write( uint8_t byte );
+    size_t write( const uint8_t * buf, size_t size );
+    int    availableForWrite();
+    int    available();
+    int    read();
+    void   flush();
+};
+extern HardwareSerial Serial;
+
+
+// Time is wall clock time
+uint32_t millis();
+uint32_t micros();
+void     delay( uint32_t ms );
+void     delayMicroseconds( uint32_t us );
+void     yield();
+
+
+#endif
@@ -0,0 +1,45 @@
+// aocmd.h - host stand-in for the aocmd library, just enough to compile aomw on Linux (see aomw_host.cpp)
+/*****************************************************************************
+ * Copyright 2024 by ams OSRAM AG                                            *
+ * All rights are reserved.                                                  *
+ *                                                                           *
+ * IMPORTANT - PLEASE READ CAREFULLY BEFORE COPYING, INSTALLING OR USING     *
+ * THE SOFTWARE.                                                             *
+ *                                                                           *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS       *
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT         *
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS         *
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT  *
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,     *
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT          *
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,     *
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY     *
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT       *
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE     *
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.      *
+ *****************************************************************************/
+#ifndef _AOCMD_H_
+#define _AOCMD_H_
+
+
+#include <stdint.h>     // uint16_t
+
+
+#define AOCMD_VERSION "host"
+
+
+typedef void (*aocmd_cint_func_t)( int argc, char * argv[] );
+
+
+void aocmd_init();
+void aocmd_register();
+void aocmd_cint_pollserial();
+// Registers a command; registration is ignored on the host (there is no command interpreter)
+int  aocmd_cint_register( aocmd_cint_func_t main, const char * name, const char * shorthelp, const char * longhelp );
+bool aocmd_cint_isprefix( const char * full, const char * prefix );
+bool aocmd_cint_parse_dec( const char * s, int * v );
+bool aocmd_cint_parse_hex( const char * s, uint16_t * v );
+bool aocmd_cint_parse_hex( const char * s, uint32_t * v );
+
+
+#endif
@@ -0,0 +1,215 @@
+// aomw_host.cpp - mocked OSP chains, to run aomw on a host (Linux) without hardware
+/*****************************************************************************
+ * Copyright 2024 by ams OSRAM AG                                            *
+ * All rights are reserved.                                                  *
+ *                                                                           *
+ * IMPORTANT - PLEASE READ CAREFULLY BEFORE COPYING, INSTALLING OR USING     *
+ * THE SOFTWARE.                                                             *
+ *                                                                           *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS       *
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT         *
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS         *
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT  *
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,     *
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT          *
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,     *
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY     *
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT       *
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE     *
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.      *
+ *****************************************************************************/
+#include <stdarg.h>     // va_list
+#include <time.h>       // clock_gettime()
+#include <Arduino.h>    // own stand-in
+#include <aoresult.h>   // own stand-in
+#include <aospi.h>      // own stand-in
+#include <aoosp.h>      // own stand-in
+#include <aocmd.h>      // own stand-in
+#include <aomw_host.h>  // own
+
+
+// The directory extras/aomw_host has stand-ins for the libraries aomw 
+// depends on (Arduino core, aoresult, aospi, aoosp, aocmd), so that the 
+// aomw sources compile and run on Linux, e.g.
+//   g++ -std=gnu++17 -O2 -pthread -Iextras/aomw_host -Isrc extras/aomw_host/aomw_host.cpp extras/aomw_host/aomw_multi_host.cpp src/aomw*.cpp
+// The aoosp stand-in sends the telegrams to mocked chains. Each thread has
+// its own route (aomw_host_select), so threads drive different chains at 
+// the same time, like an MCU with an SPI port per chain. A telegram 
+// occupies the wire (the calling thread sleeps) for AOMW_HOST_TELE_US.
+
+
+// === Arduino ==============================================================
+
+
+HardwareSerial Serial;
+
+
+int HardwareSerial::printf( const char * format, ... ) {
+  va_list args;
+  va_start(args, format);
+  int len= vprintf(format, args);
+  va_end(args);
+  return len;
+}
+size_t HardwareSerial::write( uint8_t byte ) { return fwrite(&byte, 1, 1, stdout); }
+size_t HardwareSerial::write( const uint8_t * buf, size_t size ) { return fwrite(buf, 1, size, stdout); }
+int    HardwareSerial::availableForWrite() { return 128; }
+int    HardwareSerial::available() { return 0; }
+int    HardwareSerial::read() { return -1; }
+void   HardwareSerial::flush() { fflush(stdout); }
+
+
+static uint64_t aomw_host_now_us() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec*1000000 + ts.tv_nsec/1000;
+}
+uint32_t millis() { return aomw_host_now_us()/1000; }
+uint32_t micros() { return aomw_host_now_us(); }
+void delayMicroseconds( uint32_t us ) { struct timespec ts= { (time_t)(us/1000000), (long)(us%1000000)*1000 }; nanosleep(&ts, NULL); }
+void delay( uint32_t ms ) { delayMicroseconds(ms*1000); }
+void yield() { }
+
+
+// === aoresult =============================================================
+
+
+const char * aoresult_to_str( aoresult_t result, int terse ) {
+  static const char * names[]= { "ok", "other", "outofmem", "outargnull", "assert", "sys_id", "comparefail", "dev_i2cnack", "dev_i2ctimeout", "dev_noi2cbridge", "dev_noi2cdev", "sys_cmdargs", "sys_crc" };
+  (void)terse;
+  if( result<0 || result>=(int)(sizeof(names)/sizeof(names[0])) ) return "unknown";
+  return names[result];
+}
+
+
+// === mocked chains ========================================================
+
+
+typedef struct aomw_host_chain_s {
+  int      numnodes;
+  uint32_t ids[AOMW_HOST_MAXNODES];
+  int      loop;
+  int      txcount;  // Telegrams sent to this chain
+  int      rxcount;  // Response telegrams received from this chain
+  int      pwmcount; // Pwm telegrams sent to this chain
+} aomw_host_chain_t;
+
+
+static aomw_host_chain_t aomw_host_chains[AOMW_HOST_MAXCHAINS];
+static int               aomw_host_numchains;
+static uint32_t          aomw_host_tele_us= AOMW_HOST_TELE_US;
+static thread_local int  aomw_host_cix; // The chain the telegrams of this thread are routed to
+
+
+int aomw_host_chain_add( const uint32_t * ids, int numnodes, int loop ) {
+  AORESULT_ASSERT( aomw_host_numchains<AOMW_HOST_MAXCHAINS && numnodes<=AOMW_HOST_MAXNODES );
+  aomw_host_chain_t * chain= &aomw_host_chains[aomw_host_numchains];
+  chain->numnodes= numnodes;
+  for( int i=0; i<numnodes; i++ ) chain->ids[i]= ids[i];
+  chain->loop= loop;
+  return aomw_host_numchains++;
+}
+
+
+void aomw_host_select( int cix, void * arg ) {
+  (void)arg;
+  AORESULT_ASSERT( 0<=cix && cix<aomw_host_numchains );
+  aomw_host_cix= cix;
+}
+
+
+void aomw_host_tele_us_set( uint32_t us ) { aomw_host_tele_us= us; }
+int  aomw_host_txcount( int cix ) { return aomw_host_chains[cix].txcount; }
+int  aomw_host_pwmcount( int cix ) { return aomw_host_chains[cix].pwmcount; }
+
+
+// Sends a telegram (and receives the response) on the chain of the calling thread; returns that chain.
+static aomw_host_chain_t * aomw_host_tele( int response ) {
+  aomw_host_chain_t * chain= &aomw_host_chains[aomw_host_cix];
+  chain->txcount++;
+  if( response ) chain->rxcount++;
+  if( aomw_host_tele_us>0 ) delayMicroseconds( aomw_host_tele_us * (response ? 2 : 1) );
+  return chain;
+}
+
+
+// === aospi ================================================================
+
+
+void aospi_init() { }
+void aospi_txcount_reset() { aomw_host_chains[aomw_host_cix].txcount= 0; }
+int  aospi_txcount_get() { return aomw_host_chains[aomw_host_cix].txcount; }
+void aospi_rxcount_reset() { aomw_host_chains[aomw_host_cix].rxcount= 0; }
+int  aospi_rxcount_get() { return aomw_host_chains[aomw_host_cix].rxcount; }
+
+
+// === aoosp ================================================================
+
+
+void aoosp_init() { }
+
+
+aoresult_t aoosp_exec_resetinit( uint16_t * last, int * loop ) {
+  aomw_host_tele(0); // reset
+  aomw_host_chain_t * chain= aomw_host_tele(1); // initloop/initbidir
+  if( last ) *last= chain->numnodes;
+  if( loop ) *loop= chain->loop;
+  return aoresult_ok;
+}
+
+
+aoresult_t aoosp_send_identify( uint16_t addr, uint32_t * id ) {
+  aomw_host_chain_t * chain= aomw_host_tele(1);
+  if( addr<1 || addr>chain->numnodes ) return aoresult_other;
+  *id= chain->ids[addr-1];
+  return aoresult_ok;
+}
+
+
+aoresult_t aoosp_send_setpwmchn( uint16_t addr, uint8_t chan, uint16_t red, uint16_t green, uint16_t blue ) {
+  (void)addr; (void)chan; (void)red; (void)green; (void)blue;
+  aomw_host_tele(0)->pwmcount++;
+  return aoresult_ok;
+}
+
+
+aoresult_t aoosp_send_setpwm( uint16_t addr, uint16_t red, uint16_t green, uint16_t blue, uint8_t daytimes ) {
+  (void)addr; (void)red; (void)green; (void)blue; (void)daytimes;
+  aomw_host_tele(0)->pwmcount++;
+  return aoresult_ok;
+}
+
+
+aoresult_t aoosp_send_readotp( uint16_t addr, uint8_t otpaddr, uint8_t * buf, int size ) {
+  (void)addr; (void)otpaddr;
+  aomw_host_tele(1);
+  memset(buf, 0, size); // no I2C bridge, no clustering
+  return aoresult_ok;
+}
+
+
+aoresult_t aoosp_send_clrerror( uint16_t addr ) { (void)addr; aomw_host_tele(0); return aoresult_ok; }
+aoresult_t aoosp_send_goactive( uint16_t addr ) { (void)addr; aomw_host_tele(0); return aoresult_ok; }
+aoresult_t aoosp_send_sync( uint16_t addr ) { (void)addr; aomw_host_tele(0); return aoresult_ok; }
+aoresult_t aoosp_send_setsetup( uint16_t addr, uint8_t flags ) { (void)addr; (void)flags; aomw_host_tele(0); return aoresult_ok; }
+aoresult_t aoosp_send_setcurchn( uint16_t addr, uint8_t chan, uint8_t flags, uint8_t rcur, uint8_t gcur, uint8_t bcur ) { (void)addr; (void)chan; (void)flags; (void)rcur; (void)gcur; (void)bcur; aomw_host_tele(0); return aoresult_ok; }
+aoresult_t aoosp_send_seti2ccfg( uint16_t addr, uint8_t flags, uint8_t speed ) { (void)addr; (void)flags; (void)speed; aomw_host_tele(0); return aoresult_ok; }
+// The mocked nodes have no I2C bridge
+aoresult_t aoosp_exec_i2cenable_get( uint16_t addr, int * enable ) { (void)addr; aomw_host_tele(1); *enable= 0; return aoresult_ok; }
+aoresult_t aoosp_exec_i2cpower( uint16_t addr ) { (void)addr; return aoresult_dev_noi2cbridge; }
+aoresult_t aoosp_exec_i2cread8( uint16_t addr, uint8_t daddr7, uint8_t raddr, uint8_t * buf, int count ) { (void)addr; (void)daddr7; (void)raddr; (void)buf; (void)count; return aoresult_dev_noi2cbridge; }
+aoresult_t aoosp_exec_i2cwrite8( uint16_t addr, uint8_t daddr7, uint8_t raddr, const uint8_t * buf, int count ) { (void)addr; (void)daddr7; (void)raddr; (void)buf; (void)count; return aoresult_dev_noi2cbridge; }
+const char * aoosp_buf_str( const uint8_t * buf, int size ) { (void)buf; (void)size; return ""; }
+
+
+// === aocmd ================================================================
+
+
+void aocmd_init() { }
+void aocmd_register() { }
+void aocmd_cint_pollserial() { }
+int  aocmd_cint_register( aocmd_cint_func_t main, const char * name, const char * shorthelp, const char * longhelp ) { (void)main; (void)name; (void)shorthelp; (void)longhelp; return 1; }
+bool aocmd_cint_isprefix( const char * full, const char * prefix ) { return *prefix && strncmp(full, prefix, strlen(prefix))==0; }
+bool aocmd_cint_parse_dec( const char * s, int * v ) { char * end; long x= strtol(s, &end, 10); if( *s==0 || *end!=0 ) return false; *v= x; return true; }
+bool aocmd_cint_parse_hex( const char * s, uint16_t * v ) { char * end; unsigned long x= strtoul(s, &end, 16); if( *s==0 || *end!=0 || x>0xFFFF ) return false; *v= x; return true; }
+bool aocmd_cint_parse_hex( const char * s, uint32_t * v ) { char * end; unsigned long x= strtoul(s, &end, 16); if( *s==0 || *end!=0 ) return false; *v= x; return true; }
@@ -0,0 +1,48 @@
+// aomw_host.h - mocked OSP chains, to run aomw on a host (Linux) without hardware
+/*****************************************************************************
+ * Copyright 2024 by ams OSRAM AG                                            *
+ * All rights are reserved.                                                  *
+ *                                                                           *
+ * IMPORTANT - PLEASE READ CAREFULLY BEFORE COPYING, INSTALLING OR USING     *
+ * THE SOFTWARE.                                                             *
+ *                                                                           *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS       *
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT         *
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS         *
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT  *
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,     *
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT          *
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,     *
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY     *
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT       *
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE     *
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.      *
+ *****************************************************************************/
+#ifndef _AOMW_HOST_H_
+#define _AOMW_HOST_H_
+
+
+#include <stdint.h>     // uint32_t
+
+
+// Maximum number of mocked chains
+#define AOMW_HOST_MAXCHAINS  4
+// Maximum number of nodes in a mocked chain
+#define AOMW_HOST_MAXNODES   100
+// Default time (us) a telegram occupies the wire (a 12 byte telegram at 2.4 Mbit/s, plus gaps)
+#define AOMW_HOST_TELE_US    50
+
+
+// Adds a mocked chain with `numnodes` nodes with ids `ids` (0x00000000 for RGBI, 0x00000040 for SAID); returns its index.
+int  aomw_host_chain_add( const uint32_t * ids, int numnodes, int loop );
+// Routes the telegrams of the calling thread to mocked chain `cix` (as aomw_multi_select_t, `arg` is unused).
+void aomw_host_select( int cix, void * arg );
+// Sets the time (us) a telegram occupies the wire; a response telegram takes the same time again.
+void aomw_host_tele_us_set( uint32_t us );
+// Returns the number of telegrams sent to mocked chain `cix`.
+int  aomw_host_txcount( int cix );
+// Returns the number of pwm telegrams sent to mocked chain `cix`.
+int  aomw_host_pwmcount( int cix );
+
+
+#endif
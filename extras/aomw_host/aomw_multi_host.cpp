@@ -0,0 +1,88 @@
+// aomw_multi_host.cpp - builds and flushes mocked chains with aomw_multi, interleaved and in parallel (host, Linux)
+/*****************************************************************************
+ * Copyright 2024 by ams OSRAM AG                                            *
+ * All rights are reserved.                                                  *
+ *                                                                           *
+ * IMPORTANT - PLEASE READ CAREFULLY BEFORE COPYING, INSTALLING OR USING     *
+ * THE SOFTWARE.                                                             *
+ *                                                                           *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS       *
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT         *
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS         *
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT  *
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,     *
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT          *
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,     *
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY     *
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT       *
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE     *
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.      *
+ *****************************************************************************/
+#include <Arduino.h>    // Serial.printf()
+#include <aomw_topo.h>  // aomw_topo_ctx_t
+#include <aomw_multi.h> // aomw_multi_build()
+#include <aomw_host.h>  // aomw_host_chain_add()
+
+
+// Build (from the repo root):
+//   g++ -std=gnu++17 -O2 -pthread -Iextras/aomw_host -Isrc -o aomw_multi_host extras/aomw_host/aomw_host.cpp extras/aomw_host/aomw_multi_host.cpp src/aomw*.cpp
+// Runs a build and a flush of four mocked chains of different lengths, 
+// first interleaved, then in parallel (a thread per chain), and prints 
+// the time per chain and the wall time. Interleaved, the wall time is the
+// sum of the chains; in parallel, it approaches that of the longest chain.
+
+
+#define NUMCHAINS 4
+static const int       numnodes[NUMCHAINS]= { 80, 60, 40, 20 };
+static aomw_topo_ctx_t ctxs[NUMCHAINS];
+
+
+// Gives every triplet of every chain a new color, so that all are dirty.
+static void frame( int n ) {
+  for( int cix=0; cix<NUMCHAINS; cix++ ) {
+    for( int tix=0; tix<aomw_topo_numtriplets_ctx(&ctxs[cix]); tix++ ) {
+      aomw_topo_rgb_t rgb= { (uint16_t)((tix*n)&0x7FFF), (uint16_t)(n*64), (uint16_t)(tix*8), NULL };
+      aomw_topo_fb_set_ctx(&ctxs[cix], tix, &rgb);
+    }
+  }
+}
+
+
+// Prints the times of the last build or flush.
+static void show( const char * what, aoresult_t result ) {
+  uint32_t sum= 0;
+  Serial.printf("%-20s %-6s", what, aoresult_to_str(result));
+  for( int cix=0; cix<NUMCHAINS; cix++ ) {
+    Serial.printf(" C%d %6luus", cix, (unsigned long)aomw_multi_us(cix) );
+    sum+= aomw_multi_us(cix);
+  }
+  Serial.printf("  sum %7luus  wall %7luus\n", (unsigned long)sum, (unsigned long)aomw_multi_wall_us() );
+}
+
+
+int main() {
+  // Mocked chains: alternating SAID and RGBI nodes
+  for( int cix=0; cix<NUMCHAINS; cix++ ) {
+    uint32_t ids[AOMW_HOST_MAXNODES];
+    for( int i=0; i<numnodes[cix]; i++ ) ids[i]= i%2 ? 0x00000000 : 0x00000040;
+    aomw_host_chain_add(ids, numnodes[cix], 1);
+    aomw_multi_add(&ctxs[cix], aomw_host_select, NULL);
+  }
+
+  for( int parallel=0; parallel<=1; parallel++ ) {
+    aoresult_t result= aomw_multi_parallel_set(parallel);
+    if( result!=aoresult_ok ) { Serial.printf("parallel mode not available (%s)\n", aoresult_to_str(result)); return 1; }
+    const char * mode= parallel ? "parallel" : "interleaved";
+    char what[32];
+    snprintf(what, sizeof what, "build %s", mode);
+    show(what, aomw_multi_build());
+    frame(1);
+    snprintf(what, sizeof what, "flush %s", mode);
+    show(what, aomw_multi_flush());
+  }
+
+  for( int cix=0; cix<NUMCHAINS; cix++ ) {
+    Serial.printf("C%d: %d nodes, %d triplets, %d telegrams (%d pwm)\n", cix, aomw_topo_numnodes_ctx(&ctxs[cix]), aomw_topo_numtriplets_ctx(&ctxs[cix]), aomw_host_txcount(cix), aomw_host_pwmcount(cix) );
+  }
+  return 0;
+}
@@ -0,0 +1,125 @@
+// aomw_stream_host.cpp - feeds binary frames through the aomw_stream receiver into a mocked chain, and measures its frame rate (host, Linux)
+/*****************************************************************************
+ * Copyright 2024 by ams OSRAM AG                                            *
+ * All rights are reserved.                                                  *
+ *                                                                           *
+ * IMPORTANT - PLEASE READ CAREFULLY BEFORE COPYING, INSTALLING OR USING     *
+ * THE SOFTWARE.                                                             *
+ *                                                                           *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS       *
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT         *
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS         *
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT  *
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,     *
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT          *
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,     *
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY     *
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT       *
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE     *
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.      *
+ *****************************************************************************/
+#include <Arduino.h>     // Serial.printf()
+#include <aomw_topo.h>   // aomw_topo_build()
+#include <aomw_stream.h> // aomw_stream_feed()
+#include <aomw_host.h>   // aomw_host_chain_add()
+
+
+// Build (from the repo root):
+//   g++ -std=gnu++17 -O2 -pthread -Iextras/aomw_host -Isrc -o aomw_stream_host extras/aomw_host/aomw_host.cpp extras/aomw_host/aomw_stream_host.cpp src/aomw*.cpp
+// Usage: aomw_stream_host [numtriplets [frames [rgb8]]]
+// Builds a mocked chain, then feeds frames (a moving rainbow, as 
+// extras/aomw_stream_send.py sends) byte by byte to aomw_stream_feed(), 
+// which is the receiver the "stream" command runs in the firmware. It 
+// measures the frame rate of the receiver code twice: with telegrams that
+// take no time (the cost of parsing, CRC, framebuffer and flush), and 
+// with telegrams that occupy the wire for AOMW_HOST_TELE_US. It also 
+// prints the rate the serial link (115200 baud) allows for the frame size.
+// The host CPU is faster than an MCU, so the first figure is an upper bound.
+
+
+#define NUMNODES 90  // Every node a SAID (3 triplets) or RGBI (1 triplet)
+
+
+// CRC-16/CCITT (poly 0x1021, init 0xFFFF), as the receiver checks it.
+static uint16_t crc16( const uint8_t * buf, int len ) {
+  uint16_t crc= 0xFFFF;
+  for( int i=0; i<len; i++ ) {
+    crc ^= (uint16_t)buf[i] << 8;
+    for( int b=0; b<8; b++ ) crc= crc & 0x8000 ? (crc<<1) ^ 0x1021 : crc<<1;
+  }
+  return crc;
+}
+
+
+// Encodes frame `step` of a moving rainbow over `count` triplets into `buf`; returns its size.
+static int frame( uint8_t * buf, int count, int step, int rgb8 ) {
+  uint8_t * p= buf;
+  *p++= AOMW_STREAM_SYNC;
+  *p++= rgb8 ? AOMW_STREAM_FLAGS_RGB8 : 0;
+  *p++= count & 0xFF; *p++= count >> 8;
+  *p++= 0; *p++= 0; // tix0
+  for( int i=0; i<count; i++ ) {
+    int hue= (i*6*256/count + step*16) % (6*256); // 0..1535
+    int x= hue%256;
+    int seg= hue/256;
+    int r= seg==0||seg==5 ? 255 : seg==1 ? 255-x : seg==4 ? x : 0;
+    int g= seg==1||seg==2 ? 255 : seg==0 ? x : seg==3 ? 255-x : 0;
+    int b= seg==3||seg==4 ? 255 : seg==2 ? x : seg==5 ? 255-x : 0;
+    if( rgb8 ) { *p++= r; *p++= g; *p++= b; continue; }
+    int rgb[3]= { r<<7, g<<7, b<<7 };
+    for( int c=0; c<3; c++ ) { *p++= rgb[c] & 0xFF; *p++= rgb[c] >> 8; }
+  }
+  uint16_t crc= crc16(buf, p-buf);
+  *p++= crc & 0xFF; *p++= crc >> 8;
+  return p-buf;
+}
+
+
+// Feeds `frames` frames to the receiver; returns the time in us, or 0 when a frame is not acknowledged with OK.
+static uint32_t run( uint8_t * buf, int count, int frames, int rgb8 ) {
+  uint32_t t0= micros();
+  for( int step=0; step<frames; step++ ) {
+    int size= frame(buf, count, step, rgb8);
+    int ack= 0;
+    for( int i=0; i<size; i++ ) ack= aomw_stream_feed(buf[i]);
+    if( ack!=AOMW_STREAM_ACK_OK ) { Serial.printf("ERROR: frame %d acknowledged with '%c'\n", step, ack ? ack : '0'); return 0; }
+  }
+  return micros()-t0;
+}
+
+
+int main( int argc, char * argv[] ) {
+  int count= argc>1 ? atoi(argv[1]) : 100;
+  int frames= argc>2 ? atoi(argv[2]) : 1000;
+  int rgb8= argc>3 ? atoi(argv[3]) : 0;
+
+  uint32_t ids[NUMNODES];
+  for( int i=0; i<NUMNODES; i++ ) ids[i]= i%2 ? 0x00000000 : 0x00000040;
+  aomw_host_chain_add(ids, NUMNODES, 1);
+  aomw_host_select(0, NULL);
+  aoresult_t result= aomw_topo_build();
+  if( result!=aoresult_ok ) { Serial.printf("ERROR: build failed (%s)\n", aoresult_to_str(result)); return 1; }
+  if( count<1 || count>aomw_topo_numtriplets() || frames<1 ) { Serial.printf("ERROR: numtriplets 1..%d, frames 1..\n", aomw_topo_numtriplets()); return 1; }
+
+  static uint8_t buf[6+6*AOMW_STREAM_MAXCOUNT+2];
+  int size= frame(buf, count, 0, rgb8);
+  Serial.printf("frames of %d triplets (%d bytes), %d frames\n", count, size, frames);
+
+  aomw_stream_reset();
+  aomw_host_tele_us_set(0);
+  uint32_t us= run(buf, count, frames, rgb8);
+  if( us==0 ) return 1;
+  Serial.printf("receiver, telegrams free:  %8.1f frames/s\n", frames*1e6/us );
+
+  aomw_host_tele_us_set(AOMW_HOST_TELE_US);
+  us= run(buf, count, frames/10+1, rgb8);
+  if( us==0 ) return 1;
+  Serial.printf("receiver, telegrams %2dus:  %8.1f frames/s (%d pwm telegrams)\n", AOMW_HOST_TELE_US, (frames/10+1)*1e6/us, aomw_host_pwmcount(0) );
+
+  Serial.printf("serial link at 115200 baud: %8.1f frames/s\n", 115200.0/10/size );
+
+  uint32_t applied, dropped;
+  aomw_stream_stats(&applied, &dropped);
+  Serial.printf("frames applied %lu, dropped %lu\n", (unsigned long)applied, (unsigned long)dropped );
+  return 0;
+}
@@ -0,0 +1,64 @@
+// aoosp.h - host stand-in for the aoosp library, just enough to compile aomw on Linux (see aomw_host.cpp)
+/*****************************************************************************
+ * Copyright 2024 by ams OSRAM AG                                            *
+ * All rights are reserved.                                                  *
+ *                                                                           *
+ * IMPORTANT - PLEASE READ CAREFULLY BEFORE COPYING, INSTALLING OR USING     *
+ * THE SOFTWARE.                                                             *
+ *                                                                           *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS       *
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT         *
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS         *
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT  *
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,     *
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT          *
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,     *
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY     *
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT       *
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE     *
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.      *
+ *****************************************************************************/
+#ifndef _AOOSP_H_
+#define _AOOSP_H_
+
+
+#include <stdint.h>     // uint16_t
+#include <aoresult.h>   // aoresult_t
+
+
+#define AOOSP_VERSION "host"
+
+
+// The mocked chains have two node kinds: RGBI (id 0x00000000) and SAID (id 0x00000040)
+#define AOOSP_IDENTIFY_IS_RGBI(id)  ((id)==0x00000000)
+#define AOOSP_IDENTIFY_IS_SAID(id)  ((id)==0x00000040)
+#define AOOSP_SETUP_FLAGS_RGBI_DFLT 0x31
+#define AOOSP_SETUP_FLAGS_SAID_DFLT 0x31
+#define AOOSP_SETUP_FLAGS_CRCEN     0x02
+#define AOOSP_CURCHN_FLAGS_DEFAULT  0x00
+#define AOOSP_CURCHN_FLAGS_DITHER   0x04
+#define AOOSP_CURCHN_FLAGS_SYNCEN   0x02
+#define AOOSP_I2CCFG_FLAGS_DEFAULT  0x00
+#define AOOSP_I2CCFG_SPEED_DEFAULT  0x00
+
+
+void aoosp_init();
+aoresult_t aoosp_exec_resetinit( uint16_t * last=0, int * loop=0 );
+aoresult_t aoosp_send_clrerror( uint16_t addr );
+aoresult_t aoosp_send_goactive( uint16_t addr );
+aoresult_t aoosp_send_sync( uint16_t addr );
+aoresult_t aoosp_send_identify( uint16_t addr, uint32_t * id );
+aoresult_t aoosp_send_setsetup( uint16_t addr, uint8_t flags );
+aoresult_t aoosp_send_setcurchn( uint16_t addr, uint8_t chan, uint8_t flags, uint8_t rcur, uint8_t gcur, uint8_t bcur );
+aoresult_t aoosp_send_setpwmchn( uint16_t addr, uint8_t chan, uint16_t red, uint16_t green, uint16_t blue );
+aoresult_t aoosp_send_setpwm( uint16_t addr, uint16_t red, uint16_t green, uint16_t blue, uint8_t daytimes );
+aoresult_t aoosp_send_readotp( uint16_t addr, uint8_t otpaddr, uint8_t * buf, int size );
+aoresult_t aoosp_send_seti2ccfg( uint16_t addr, uint8_t flags, uint8_t speed );
+aoresult_t aoosp_exec_i2cenable_get( uint16_t addr, int * enable );
+aoresult_t aoosp_exec_i2cpower( uint16_t addr );
+aoresult_t aoosp_exec_i2cread8( uint16_t addr, uint8_t daddr7, uint8_t raddr, uint8_t * buf, int count );
+aoresult_t aoosp_exec_i2cwrite8( uint16_t addr, uint8_t daddr7, uint8_t raddr, const uint8_t * buf, int count );
+const char * aoosp_buf_str( const uint8_t * buf, int size );
+
+
+#endif
@@ -0,0 +1,55 @@
+// aoresult.h - host stand-in for the aoresult library, just enough to compile aomw on Linux (see aomw_host.cpp)
+/*****************************************************************************
+ * Copyright 2024 by ams OSRAM AG                                            *
+ * All rights are reserved.                                                  *
+ *                                                                           *
+ * IMPORTANT - PLEASE READ CAREFULLY BEFORE COPYING, INSTALLING OR USING     *
+ * THE SOFTWARE.                                                             *
+ *                                                                           *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS       *
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT         *
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS         *
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT  *
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,     *
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT          *
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,     *
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY     *
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT       *
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE     *
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.      *
+ *****************************************************************************/
+#ifndef _AORESULT_H_
+#define _AORESULT_H_
+
+
+#include <stdint.h>     // uint8_t
+#include <stdlib.h>     // abort()
+
+
+#define AORESULT_VERSION "host"
+
+
+typedef enum aoresult_e {
+  aoresult_ok,
+  aoresult_other,
+  aoresult_outofmem,
+  aoresult_outargnull,
+  aoresult_assert,
+  aoresult_sys_id,
+  aoresult_comparefail,
+  aoresult_dev_i2cnack,
+  aoresult_dev_i2ctimeout,
+  aoresult_dev_noi2cbridge,
+  aoresult_dev_noi2cdev,
+  aoresult_sys_cmdargs,
+  aoresult_sys_crc,
+} aoresult_t;
+
+
+// Converts a result to a string
+const char * aoresult_to_str( aoresult_t result, int terse=0 );
+// On a host an assert aborts
+#define AORESULT_ASSERT(cond) do { if( !(cond) ) { fprintf(stderr,"ASSERT %s:%d %s\n",__FILE__,__LINE__,#cond); abort(); } } while(0)
+
+
+#endif
@@ -0,0 +1,177 @@
+# aomw_stream_send.py - streams binary frames to the "stream" command of an OSP firmware and measures frames per second
+#
+# Usage: python aomw_stream_send.py [options] port
+#        python aomw_stream_send.py --selftest [options]
+#
+# The firmware must have the "stream" command registered (aomw_stream_cmd_register)
+# and a built topology ("topo build"). This tool sends "stream <timeout>" on the
+# serial port, waits for the firmware to switch to binary mode, then sends frames
+# (a moving rainbow over --numtriplets triplets), each time waiting for the
+# acknowledge byte. It ends with an end frame and reports the sustained frame rate
+# and the acknowledges. See aomw_stream.cpp for the frame format.
+#
+# With --selftest the port is one side of a pseudo-terminal, and a receiver that
+# mimics the firmware (it checks and acknowledges the frames) runs on the other
+# side. This tests the protocol on Linux, without hardware; the frame rate it
+# reports is that of this script and the Python receiver, not of the firmware.
+# For the rate of the firmware receiver (aomw_stream.cpp, compiled for the host
+# with a mocked chain) see extras/aomw_host/aomw_stream_host.cpp.
+
+import argparse
+import os
+import select
+import sys
+import termios
+import threading
+import time
+import tty
+
+
+SYNC          = 0xA5
+FLAGS_RGB8    = 0x01
+FLAGS_NOFLUSH = 0x02
+ACKS          = { b"K":"ok", b"Z":"end", b"C":"crc", b"R":"range", b"F":"flush" }
+
+
+def crc16(data) :
+  """CRC-16/CCITT (poly 0x1021, init 0xFFFF), as aomw_stream_crc()."""
+  crc = 0xFFFF
+  for byte in data :
+    crc ^= byte<<8
+    for _ in range(8) :
+      crc = ((crc<<1)^0x1021)&0xFFFF if crc&0x8000 else (crc<<1)&0xFFFF
+  return crc
+
+
+def frame(tix0, colors, flags=0) :
+  """Returns the bytes of a frame setting triplets tix0.. to colors (list of (r,g,b), 0..0x7FFF)."""
+  data = bytearray([SYNC, flags, len(colors)&0xFF, len(colors)>>8, tix0&0xFF, tix0>>8])
+  for r,g,b in colors :
+    if flags & FLAGS_RGB8 : data += bytes([r>>7, g>>7, b>>7])
+    else : data += bytes([r&0xFF, r>>8, g&0xFF, g>>8, b&0xFF, b>>8])
+  crc = crc16(data)
+  return bytes(data + bytes([crc&0xFF, crc>>8]))
+
+
+def rainbow(numtriplets, step) :
+  """Returns the colors of one frame of a moving rainbow."""
+  colors = []
+  for tix in range(numtriplets) :
+    hue = (tix*768//max(numtriplets,1) + step*8) % 768
+    seg, pos = divmod(hue, 256)
+    up, down = pos*0x7F, (255-pos)*0x7F
+    colors.append( [(down,up,0),(0,down,up),(up,0,down)][seg] )
+  return colors
+
+
+def openport(path, baud) :
+  """Opens a serial port (or pty) in raw mode; returns the file descriptor."""
+  fd = os.open(path, os.O_RDWR|os.O_NOCTTY)
+  tty.setraw(fd)
+  attr = termios.tcgetattr(fd)
+  speed = getattr(termios, f"B{baud}", None)
+  if speed is not None : attr[4] = attr[5] = speed
+  termios.tcsetattr(fd, termios.TCSANOW, attr)
+  return fd
+
+
+def readbyte(fd, timeout) :
+  """Reads one byte; returns None on time-out."""
+  r,_,_ = select.select([fd],[],[],timeout)
+  return os.read(fd,1) if r else None
+
+
+def readline(fd, timeout) :
+  """Reads a text line; returns None on time-out."""
+  line = b""
+  while not line.endswith(b"\n") :
+    c = readbyte(fd, timeout)
+    if c is None : return None
+    line += c
+  return line.decode(errors="replace")
+
+
+def writeall(fd, data) :
+  while data :
+    n = os.write(fd, data)
+    data = data[n:]
+
+
+def mockreceiver(fd, numtriplets) :
+  """Mimics the firmware: answers the stream command, checks and acknowledges frames, until the end frame."""
+  buf = b""
+  while b"\n" not in buf : buf += os.read(fd, 64)
+  writeall(fd, b"stream: binary mode until end frame or 5000ms idle\n")
+  data = bytearray()
+  while True :
+    data += os.read(fd, 4096)
+    while data :
+      if data[0]!=SYNC : del data[0]; continue
+      if len(data)<6 : break
+      flags, count, tix0 = data[1], data[2]|data[3]<<8, data[4]|data[5]<<8
+      if flags & ~(FLAGS_RGB8|FLAGS_NOFLUSH) or tix0+count>numtriplets : del data[:6]; writeall(fd, b"R"); continue
+      size = 6 + count*(3 if flags&FLAGS_RGB8 else 6) + 2
+      if len(data)<size : break
+      ok = crc16(data[:size-2])==(data[size-2]|data[size-1]<<8)
+      del data[:size]
+      writeall(fd, b"C" if not ok else b"Z" if count==0 else b"K")
+      if ok and count==0 : return
+
+
+def stream(fd, args) :
+  """Runs the stream command and sends the frames; returns (frames sent, seconds, ack counts)."""
+  if not args.nocmd :
+    writeall(fd, f"stream {args.timeout}\n".encode())
+    while True :
+      line = readline(fd, 2.0)
+      if line is None : sys.exit("no reply from firmware on 'stream' command")
+      if line.startswith("stream: binary") : break
+      if line.startswith("ERROR") : sys.exit(line.strip())
+  flags = FLAGS_RGB8 if args.rgb8 else 0
+  acks = {}
+  t0 = time.perf_counter()
+  for step in range(args.frames) :
+    writeall(fd, frame(args.tix0, rainbow(args.numtriplets, step), flags))
+    ack = readbyte(fd, 2.0)
+    name = ACKS.get(ack, "none" if ack is None else repr(ack))
+    acks[name] = acks.get(name,0)+1
+    if ack is None : break
+  secs = time.perf_counter()-t0
+  writeall(fd, frame(0, [], 0))
+  ack = readbyte(fd, 2.0)
+  acks[ACKS.get(ack,"none")] = acks.get(ACKS.get(ack,"none"),0)+1
+  return step+1, secs, acks
+
+
+def main() :
+  parser = argparse.ArgumentParser(description="Streams binary frames to the 'stream' command of an OSP firmware.")
+  parser.add_argument("port", nargs="?", help="serial port of the firmware (e.g. /dev/ttyUSB0)")
+  parser.add_argument("--baud", type=int, default=115200, help="baud rate (default 115200)")
+  parser.add_argument("--selftest", action="store_true", help="stream to a mock receiver via a pseudo-terminal (protocol test)")
+  parser.add_argument("--numtriplets", type=int, default=100, help="triplets per frame (default 100)")
+  parser.add_argument("--tix0", type=int, default=0, help="first triplet (default 0)")
+  parser.add_argument("--frames", type=int, default=100, help="number of frames (default 100)")
+  parser.add_argument("--rgb8", action="store_true", help="send 8 bit colors (half the bytes)")
+  parser.add_argument("--timeout", type=int, default=5000, help="idle time-out (ms) passed to the stream command")
+  parser.add_argument("--nocmd", action="store_true", help="do not send the 'stream' command (firmware already streaming)")
+  args = parser.parse_args()
+  if args.selftest :
+    master, slave = os.openpty()
+    tty.setraw(master)
+    tty.setraw(slave)
+    thread = threading.Thread(target=mockreceiver, args=(slave, args.tix0+args.numtriplets), daemon=True)
+    thread.start()
+    fd = master
+  elif args.port :
+    fd = openport(args.port, args.baud)
+  else :
+    sys.exit("give a port, or --selftest")
+  frames, secs, acks = stream(fd, args)
+  size = len(frame(args.tix0, rainbow(args.numtriplets,0), FLAGS_RGB8 if args.rgb8 else 0))
+  print(f"frames {frames} of {args.numtriplets} triplets ({size} bytes) in {secs:.3f}s: {frames/secs:.1f} frames/s, {frames*args.numtriplets/secs:.0f} triplets/s")
+  if args.selftest : print("(selftest: rate of the Python mock receiver, not of the firmware)")
+  print("acks " + " ".join(f"{k}={v}" for k,v in sorted(acks.items())))
+
+
+if __name__=="__main__" :
+  main()
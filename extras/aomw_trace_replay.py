@@ -0,0 +1,143 @@
+# aomw_trace_replay.py - replays a telegram trace (output of the "trace" command) against a mocked OSP chain
+#
+# Usage: python aomw_trace_replay.py [options] tracefile
+#
+# The tracefile is a capture of the serial output of the "trace" command (lines
+# other than trace records are ignored). The trace is fed, in time order, through
+# a mocked chain that tracks the PWM state of every triplet. The replay reports
+# timing statistics (telegram rate, gaps, frames) and flags frames that look like
+# flicker sources (a triplet set to different values within one frame, or frames
+# that take longer than the frame period). With --realtime the original timing
+# is reproduced (scaled with --speed), otherwise the replay runs as fast as
+# possible and reports the replay throughput (offline benchmark).
+#
+# Tracing must be compiled in the firmware, see AOMW_TRACE_ENABLED in aomw_trace.h.
+
+import argparse
+import sys
+import time
+
+
+class Entry :
+  def __init__(self, us, type, addr, chan, d) :
+    self.us   = us    # time stamp (micro seconds, unwrapped)
+    self.type = type  # telegram type name (e.g. "setpwmchn")
+    self.addr = addr  # node address (0 is broadcast)
+    self.chan = chan  # channel or None
+    self.d    = d     # payload (three ints)
+
+
+def parse(lines) :
+  """Parses the CSV lines of a trace dump; returns a list of Entry (time stamps unwrapped)."""
+  entries = []
+  prev = None
+  wrap = 0
+  for line in lines :
+    fields = line.strip().split(",")
+    if len(fields)!=7 or not fields[0].isdigit() : continue # header, comment or other output
+    us = int(fields[0])
+    if prev is not None and us+wrap<prev : wrap += 1<<32 # micros() wraps after ~71 minutes
+    us += wrap
+    prev = us
+    chan = int(fields[3]) if fields[3]!="" else None
+    entries.append( Entry(us, fields[1], int(fields[2]), chan, [int(x,16) for x in fields[4:7]]) )
+  return entries
+
+
+class MockChain :
+  """Tracks the state of a chain as far as visible in the trace."""
+  def __init__(self) :
+    self.numnodes = None # unknown until a resetinit is in the trace (the ring may have dropped it)
+    self.active = None
+    self.pwm = {}       # (addr,chan) -> (r,g,b); chan is None for RGBI, addr 0 for the last broadcast
+    self.errors = []    # telegrams that do not fit the chain
+  def apply(self, e) :
+    if e.type=="resetinit" :
+      self.numnodes = e.addr
+      self.active = False
+      self.pwm = {}
+    elif e.type=="goactive" :
+      self.active = True
+    elif e.type in ("setpwm","setpwmchn") and e.addr==0 : # broadcast (whole chain fill)
+      for key in self.pwm :
+        if key[1]==e.chan : self.pwm[key] = tuple(e.d)
+      self.pwm[(0,e.chan)] = tuple(e.d)
+    elif e.type in ("setpwm","setpwmchn") :
+      if self.numnodes is not None and not 1<=e.addr<=self.numnodes : self.errors.append(e)
+      self.pwm[(e.addr,e.chan)] = tuple(e.d)
+
+
+def frames(entries, framegap) :
+  """Splits the pwm telegrams in frames: bursts separated by more than `framegap` us."""
+  result = []
+  for e in entries :
+    if not e.type.startswith("setpwm") : continue
+    if result and e.us-result[-1][-1].us<=framegap : result[-1].append(e)
+    else : result.append([e])
+  return result
+
+
+def replay(entries, chain, realtime, speed) :
+  """Feeds the entries through the mock chain; returns host seconds used."""
+  t0 = time.perf_counter()
+  for e in entries :
+    if realtime :
+      wait = (e.us-entries[0].us)/1e6/speed - (time.perf_counter()-t0)
+      if wait>0 : time.sleep(wait)
+    chain.apply(e)
+  return time.perf_counter()-t0
+
+
+def report(entries, chain, host, args) :
+  span = entries[-1].us-entries[0].us if len(entries)>1 else 0
+  print(f"telegrams {len(entries)} over {span}us", end="")
+  if span>0 : print(f", {len(entries)*1e6/span:.0f} telegrams/s", end="")
+  print()
+  counts = {}
+  for e in entries : counts[e.type] = counts.get(e.type,0)+1
+  print("types " + " ".join(f"{t}={n}" for t,n in sorted(counts.items())))
+  gaps = [b.us-a.us for a,b in zip(entries,entries[1:])]
+  if gaps : print(f"gaps min {min(gaps)}us avg {sum(gaps)/len(gaps):.0f}us max {max(gaps)}us")
+  fs = frames(entries, args.framegap)
+  if fs :
+    durs = [f[-1].us-f[0].us for f in fs]
+    print(f"frames {len(fs)}: telegrams/frame avg {sum(len(f) for f in fs)/len(fs):.1f}, duration avg {sum(durs)/len(durs):.0f}us max {max(durs)}us")
+    for ix,f in enumerate(fs) :
+      seen = {}
+      multi = set()
+      for e in f :
+        key = (e.addr,e.chan)
+        if key in seen and seen[key]!=tuple(e.d) : multi.add(key)
+        seen[key] = tuple(e.d)
+      dur = f[-1].us-f[0].us
+      if multi : print(f"  frame {ix} at {f[0].us}us: {len(multi)} triplet(s) set to different values within the frame")
+      if args.period and dur>args.period : print(f"  frame {ix} at {f[0].us}us: takes {dur}us, longer than period {args.period}us")
+  for e in chain.errors : print(f"  {e.type} at {e.us}us to N{e.addr:03X} which is not in the chain ({chain.numnodes} nodes)")
+  nodes = "unknown number of" if chain.numnodes is None else chain.numnodes
+  active = "active unknown" if chain.active is None else "active" if chain.active else "not active"
+  print(f"chain {nodes} nodes, {active}, {len(chain.pwm)} triplets driven")
+  if args.state :
+    for (addr,chan),(r,g,b) in sorted(chain.pwm.items(), key=lambda kv:(kv[0][0],-1 if kv[0][1] is None else kv[0][1])) :
+      print(f"  N{addr:03X}{'' if chan is None else f'.C{chan}'} {r:04X} {g:04X} {b:04X}")
+  if not args.realtime and host>0 : print(f"replay {host*1e3:.1f}ms host time, {len(entries)/host:.0f} telegrams/s")
+
+
+def main() :
+  parser = argparse.ArgumentParser(description="Replays an aomw telegram trace against a mocked OSP chain.")
+  parser.add_argument("tracefile", help="capture of the output of the 'trace' command ('-' for stdin)")
+  parser.add_argument("--realtime", action="store_true", help="reproduce the original timing")
+  parser.add_argument("--speed", type=float, default=1.0, help="speed factor for --realtime (default 1.0)")
+  parser.add_argument("--framegap", type=int, default=2000, help="gap (us) that separates frames (default 2000)")
+  parser.add_argument("--period", type=int, default=0, help="frame period (us); report frames that take longer")
+  parser.add_argument("--state", action="store_true", help="print the final pwm state of all triplets")
+  args = parser.parse_args()
+  with (sys.stdin if args.tracefile=="-" else open(args.tracefile)) as f :
+    entries = parse(f)
+  if not entries : sys.exit("no trace entries found")
+  chain = MockChain()
+  host = replay(entries, chain, args.realtime, args.speed)
+  report(entries, chain, host, args)
+
+
+if __name__=="__main__" :
+  main()
@@ -23,7 +23,7 @@
 
 
 // Identifies lib version
-#define AOMW_VERSION "0.4.1"
+#define AOMW_VERSION "0.5.0"
 
 
 // Include the (headers of the) modules of this app
@@ -32,6 +32,12 @@
 #include <aomw_iox.h>
 #include <aomw_eeprom.h>
 #include <aomw_tscript.h>
+#include <aomw_trace.h>
+#include <aomw_sched.h>
+#include <aomw_pixmap.h>
+#include <aomw_fx.h>
+#include <aomw_multi.h>
+#include <aomw_stream.h>
 
 
 // Initializes the aomw library (nothing now).
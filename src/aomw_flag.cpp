@@ -23,47 +23,188 @@
 #include <aomw_flag.h>  // own
 
 
-// Paints a flag with three bands, using topo
-static aoresult_t aomw_flag_3bands(const aomw_topo_rgb_t*band1,const aomw_topo_rgb_t*band2,const aomw_topo_rgb_t*band3) {
+// === Engine ================================================================
+// A flag is described by a table of bands (aomw_flag_t). The engine resolves
+// the bands to the current topo, resulting in a list of spans: a triplet range 
+// with a color. Painting then consists of one range fill per span.
+//
+// Resolving uses these rules:
+// - The triplets on the MCU board (node 1, and in case of loop also the last 
+//   node) are reserved; the first band is extended over the start MCU 
+//   triplets, the last band over the end MCU triplets. When there are fewer 
+//   non-MCU triplets than proportional bands, all triplets are used instead.
+// - Detail bands get their fixed number of triplets, but only if there are 
+//   at least `mindetail` (non-MCU) triplets; otherwise they are skipped.
+// - The remaining triplets are divided over the proportional bands by their
+//   share; pattern bands get an even number (whole periods). Triplets left 
+//   over are spread symmetrically over the solid proportional bands: if their 
+//   number is odd, one goes to the middle band, the others go pairwise to the
+//   outer bands (so for a tricolor, one left over goes to the middle band, 
+//   two left over go to both side bands). When there are no solid 
+//   proportional bands, the last band gets the left overs.
+
+
+// The stock flag that was painted last (-1 if unknown), and the topo generation it was painted for
+static int      aomw_flag_shown_pix = -1;
+static uint32_t aomw_flag_shown_generation;
+
+
+/*!
+    @brief  Resolves the bands of `flag` to spans of triplets of the current 
+            topo.
+    @param  flag
+            The description of the flag.
+    @param  spans
+            Output array of (at least) AOMW_FLAG_MAXBANDS spans.
+    @return The number of spans written to `spans`.
+    @note   The OSP chain must be initialized (eg with aomw_topo_build()).
+    @note   Adjacent solid spans with the same color are merged.
+*/
+int aomw_flag_resolve( const aomw_flag_t * flag, aomw_flag_span_t * spans ) {
+  AORESULT_ASSERT( 1<=flag->numbands && flag->numbands<=AOMW_FLAG_MAXBANDS );
   // determine number of triplets we have
   int numtot  = aomw_topo_numtriplets(); // total number of triplets in chain
-  int nummcu1 = aomw_topo_node_numtriplets(1); // number of triplets on MCU board at the start of the chain
+  int nummcu1 = aomw_topo_numnodes()>0 ? aomw_topo_node_numtriplets(1) : 0; // number of triplets on MCU board at the start of the chain
   int nummcu3 = aomw_topo_loop()? aomw_topo_node_numtriplets(aomw_topo_numnodes()) : 0; // number of triplets on MCU board at the end of the chain
   int numpcb  = numtot-nummcu1-nummcu3; // number of triplets on the pcb(s), ie not on the MCU board
-  int numflag = numpcb>=3 ? numpcb : numtot; // if there is enough triplets on the pcb, use only pcb for flag else use all triplets in chain
 
-  // divide triplets over 3 bands
-  int div = numflag / 3; // number of triplets for each band
-  int mod = numflag % 3; // triplets left over
-
-  // If one triplet is left over, put it in the middle band; if two are left over put it on both side bands
-  int num1 = div + (mod==2?1:0); // number of colors for left side band
-  int num2 = div + (mod==1?1:0); // number of colors for middle band
-  int num3 = div + (mod==2?1:0); // number of colors for right side band
-
-  // if we ignored the triplets on the MCU, add them again
-  if( numpcb>=3 ) { num1+=nummcu1; num3+=nummcu3; }
+  // Collect the proportional bands and the size of the details
+  int numprop = 0; // number of proportional bands
+  int props[AOMW_FLAG_MAXBANDS]; // band indices of the proportional bands
+  int sumshare= 0;
+  int sumfixed= 0;
+  for( int bix=0; bix<flag->numbands; bix++ ) {
+    if( flag->bands[bix].fixed==0 ) { props[numprop++]= bix; sumshare+= flag->bands[bix].share; }
+    else sumfixed+= flag->bands[bix].fixed;
+  }
 
-  // generate all three bands
-  aoresult_t result;
-  uint16_t tix=0;
-  for( int i=0; i<num1; i++,tix++ ) {
-    result= aomw_topo_settriplet(tix, band1 );
-    if( result!=aoresult_ok ) return result;
+  // Details are only shown when there are enough triplets on the pcb
+  int details= numpcb>=flag->mindetail && numpcb>=sumfixed;
+  // If there are not enough triplets on the pcb, use all triplets in chain
+  if( numpcb<numprop ) { numpcb=numtot; nummcu1=0; nummcu3=0; }
+
+  // Size of the bands: details first, proportional bands get the rest (patterns in whole periods)
+  int sizes[AOMW_FLAG_MAXBANDS];
+  int numrest= numpcb - (details?sumfixed:0);
+  int numleft= numrest;
+  int numsolid= 0; // number of proportional bands that are solid
+  int solids[AOMW_FLAG_MAXBANDS]; // band indices of the solid proportional bands
+  for( int bix=0; bix<flag->numbands; bix++ ) {
+    if( flag->bands[bix].fixed>0 ) {
+      sizes[bix]= details ? flag->bands[bix].fixed : 0;
+    } else {
+      sizes[bix]= sumshare==0 ? 0 : numrest * flag->bands[bix].share / sumshare;
+      if( flag->bands[bix].alt!=NULL ) sizes[bix]&= ~1; else solids[numsolid++]= bix;
+      numleft-= sizes[bix];
+    }
   }
-  for( int i=0; i<num2; i++,tix++ ) {
-    result= aomw_topo_settriplet(tix, band2 );
-    if( result!=aoresult_ok ) return result;
+  // Spread left over triplets symmetrically over the solid proportional bands (or give them to the last band)
+  if( numsolid>0 ) {
+    if( numleft%2==1 ) { sizes[solids[numsolid/2]]++; numleft--; }
+    for( int six=0; numleft>0; six=(six+1)%numsolid, numleft-=2 ) { sizes[solids[six]]++; sizes[solids[numsolid-1-six]]++; }
+  } else if( numprop>0 ) {
+    sizes[props[numprop-1]]+= numleft;
   }
-  for( int i=0; i<num3; i++,tix++ ) {
-    result= aomw_topo_settriplet(tix, band3 );
-    if( result!=aoresult_ok ) return result;
+  // If we ignored the triplets on the MCU, add them again
+  sizes[0]+= nummcu1;
+  sizes[flag->numbands-1]+= nummcu3;
+
+  // Convert band sizes to spans (merging adjacent solid spans of same color)
+  int numspans= 0;
+  uint16_t tix= 0;
+  for( int bix=0; bix<flag->numbands; bix++ ) {
+    if( sizes[bix]==0 ) continue;
+    const aomw_flag_band_t * band= &flag->bands[bix];
+    aomw_flag_span_t * prev= numspans>0 ? &spans[numspans-1] : NULL;
+    if( prev!=NULL && prev->alt==NULL && band->alt==NULL && prev->rgb==band->rgb ) {
+      prev->tix1+= sizes[bix];
+    } else {
+      spans[numspans].tix0= tix;
+      spans[numspans].tix1= tix+sizes[bix];
+      spans[numspans].rgb = band->rgb;
+      spans[numspans].alt = band->alt;
+      numspans++;
+    }
+    tix+= sizes[bix];
   }
+  AORESULT_ASSERT( tix==numtot );
+
+  return numspans;
+}
+
 
+// Paints `numspans` spans using topo
+static aoresult_t aomw_flag_paintspans( const aomw_flag_span_t * spans, int numspans ) {
+  aoresult_t result;
+  for( int six=0; six<numspans; six++ ) {
+    const aomw_flag_span_t * span= &spans[six];
+    if( span->alt==NULL ) {
+      result= aomw_topo_settriplets(span->tix0, span->tix1, span->rgb );
+      if( result!=aoresult_ok ) return result;
+    } else {
+      for( uint16_t tix=span->tix0; tix<span->tix1; tix++ ) {
+        result= aomw_topo_settriplet(tix, (tix-span->tix0)%2==0 ? span->rgb : span->alt );
+        if( result!=aoresult_ok ) return result;
+      }
+    }
+  }
   return aoresult_ok;
 }
 
 
+/*!
+    @brief  Paints the flag described by `flag` on the OSP chain (using topo).
+    @param  flag
+            The description of the flag.
+    @return aoresult_ok           If painting was successful
+            other error code      if there is a (communications) error
+    @note   The OSP chain must be initialized (eg with aomw_topo_build()).
+    @note   See aomw_flag_resolve() for how bands are mapped to triplets.
+    @note   The layout of `flag` is resolved on every call; the stock
+            painters (eg aomw_flag_painter_dutch) use a cached layout.
+*/
+aoresult_t aomw_flag_paint( const aomw_flag_t * flag ) {
+  aomw_flag_span_t spans[AOMW_FLAG_MAXBANDS];
+  int numspans= aomw_flag_resolve(flag, spans);
+  aomw_flag_shown_pix= -1; // not a stock flag (see transitions)
+  return aomw_flag_paintspans(spans, numspans);
+}
+
+
+// === Flags =================================================================
+// The flags are data only: a table of bands.
+
+
+static constexpr aomw_flag_band_t aomw_flag_dutch_bands[]    = { AOMW_FLAG_SOLID(&aomw_topo_red,1),    AOMW_FLAG_SOLID(&aomw_topo_white,1),  AOMW_FLAG_SOLID(&aomw_topo_blue,1) };
+static constexpr aomw_flag_band_t aomw_flag_columbia_bands[] = { AOMW_FLAG_SOLID(&aomw_topo_yellow,1), AOMW_FLAG_SOLID(&aomw_topo_blue,1),   AOMW_FLAG_SOLID(&aomw_topo_red,1) };
+static constexpr aomw_flag_band_t aomw_flag_japan_bands[]    = { AOMW_FLAG_SOLID(&aomw_topo_white,1),  AOMW_FLAG_SOLID(&aomw_topo_red,1),    AOMW_FLAG_SOLID(&aomw_topo_white,1) };
+static constexpr aomw_flag_band_t aomw_flag_mali_bands[]     = { AOMW_FLAG_SOLID(&aomw_topo_green,1),  AOMW_FLAG_SOLID(&aomw_topo_yellow,1), AOMW_FLAG_SOLID(&aomw_topo_red,1) };
+static constexpr aomw_flag_band_t aomw_flag_italy_bands[]    = { AOMW_FLAG_SOLID(&aomw_topo_green,1),  AOMW_FLAG_SOLID(&aomw_topo_white,1),  AOMW_FLAG_SOLID(&aomw_topo_red,1) };
+static constexpr aomw_flag_band_t aomw_flag_europe_bands[]   = { 
+  AOMW_FLAG_SOLID(&aomw_topo_blue,1), AOMW_FLAG_DETAIL(&aomw_topo_yellow,1), AOMW_FLAG_SOLID(&aomw_topo_blue,1), AOMW_FLAG_DETAIL(&aomw_topo_yellow,1), AOMW_FLAG_SOLID(&aomw_topo_blue,1) 
+};
+static constexpr aomw_flag_band_t aomw_flag_usa_bands[]      = { 
+  AOMW_FLAG_DETAIL(&aomw_topo_blue,1), AOMW_FLAG_PATTERN(&aomw_topo_white,&aomw_topo_blue,1), AOMW_FLAG_PATTERN(&aomw_topo_red,&aomw_topo_white,2) 
+};
+static constexpr aomw_flag_band_t aomw_flag_china_bands[]    = { 
+  AOMW_FLAG_DETAIL(&aomw_topo_red,1), AOMW_FLAG_DETAIL(&aomw_topo_yellow,2), AOMW_FLAG_DETAIL(&aomw_topo_red,1), AOMW_FLAG_DETAIL(&aomw_topo_yellow,1), AOMW_FLAG_SOLID(&aomw_topo_red,1) 
+};
+
+
+static constexpr aomw_flag_t aomw_flag_dutch    = { "dutch",    aomw_flag_dutch_bands,    AOMW_FLAG_NUMBANDS(aomw_flag_dutch_bands),    0 };
+static constexpr aomw_flag_t aomw_flag_columbia = { "columbia", aomw_flag_columbia_bands, AOMW_FLAG_NUMBANDS(aomw_flag_columbia_bands), 0 };
+static constexpr aomw_flag_t aomw_flag_japan    = { "japan",    aomw_flag_japan_bands,    AOMW_FLAG_NUMBANDS(aomw_flag_japan_bands),    0 };
+static constexpr aomw_flag_t aomw_flag_mali     = { "mali",     aomw_flag_mali_bands,     AOMW_FLAG_NUMBANDS(aomw_flag_mali_bands),     0 };
+static constexpr aomw_flag_t aomw_flag_italy    = { "italy",    aomw_flag_italy_bands,    AOMW_FLAG_NUMBANDS(aomw_flag_italy_bands),    0 };
+static constexpr aomw_flag_t aomw_flag_europe   = { "europe",   aomw_flag_europe_bands,   AOMW_FLAG_NUMBANDS(aomw_flag_europe_bands),   5 };
+static constexpr aomw_flag_t aomw_flag_usa      = { "usa",      aomw_flag_usa_bands,      AOMW_FLAG_NUMBANDS(aomw_flag_usa_bands),      0 };
+static constexpr aomw_flag_t aomw_flag_china    = { "china",    aomw_flag_china_bands,    AOMW_FLAG_NUMBANDS(aomw_flag_china_bands),    7 };
+
+
+// Paints stock flag `pix` using its cached layout (see below)
+static aoresult_t aomw_flag_paintpix( int pix );
+
+
 /*!
     @brief  Paints a red-white-blue flag on the OSP chain (using topo).
     @return aoresult_ok           If painting was successful
@@ -72,7 +213,7 @@ static aoresult_t aomw_flag_3bands(const aomw_topo_rgb_t*band1,const aomw_topo_r
     @note   The Netherlands, France, and Luxembourg uses these colors.
 */
 aoresult_t aomw_flag_painter_dutch() {
-  return aomw_flag_3bands( &aomw_topo_red, &aomw_topo_white, &aomw_topo_blue );
+  return aomw_flag_paintpix( AOMW_FLAG_PIX_DUTCH );
 }
 
 
@@ -84,7 +225,7 @@ aoresult_t aomw_flag_painter_dutch() {
     @note   Columbia, Ecuador, and Venezuela uses these colors.
 */
 aoresult_t aomw_flag_painter_columbia() {
-  return aomw_flag_3bands( &aomw_topo_yellow, &aomw_topo_blue, &aomw_topo_red );
+  return aomw_flag_paintpix( AOMW_FLAG_PIX_COLUMBIA );
 }
 
 
@@ -96,7 +237,7 @@ aoresult_t aomw_flag_painter_columbia() {
     @note   Abstraction of the flag from Japan.
 */
 aoresult_t aomw_flag_painter_japan() {
-  return aomw_flag_3bands( &aomw_topo_white, &aomw_topo_red, &aomw_topo_white );
+  return aomw_flag_paintpix( AOMW_FLAG_PIX_JAPAN );
 }
 
 
@@ -108,7 +249,7 @@ aoresult_t aomw_flag_painter_japan() {
     @note   Mali, Benin, Cameroon, Ghana, and Senegal uses the colors.
 */
 aoresult_t aomw_flag_painter_mali() {
-  return aomw_flag_3bands( &aomw_topo_green, &aomw_topo_yellow, &aomw_topo_red );
+  return aomw_flag_paintpix( AOMW_FLAG_PIX_MALI );
 }
 
 
@@ -120,7 +261,7 @@ aoresult_t aomw_flag_painter_mali() {
     @note   Italy uses the colors.
 */
 aoresult_t aomw_flag_painter_italy() {
-  return aomw_flag_3bands( &aomw_topo_green, &aomw_topo_white, &aomw_topo_red );
+  return aomw_flag_paintpix( AOMW_FLAG_PIX_ITALY );
 }
 
 
@@ -133,52 +274,7 @@ aoresult_t aomw_flag_painter_italy() {
     @note   Abstraction of the flag from European Union.
 */
 aoresult_t aomw_flag_painter_europe() {
-  int numtot  = aomw_topo_numtriplets(); // total number of triplets in chain
-  int numstart= aomw_topo_node_numtriplets(1); // number of triplets on the start of the chain that must be blue
-  int numend  = aomw_topo_loop()? aomw_topo_node_numtriplets(aomw_topo_numnodes()) : 0; // number of triplets on the end of the chain that must be blue
-  int numpcb  = numtot-numstart-numend; // number of triplets on the PCB
-  int numstars= numpcb<5 ? 0 : 2 ; //number of yellow stars
-  int numblue = numpcb-numstars; // number of triplets on the pcb(s) that we want to be blue
-
-  // there are three blue bands
-  int div = numblue / 3; // number of triplets for each band
-  int mod = numblue % 3; // triplets left over
-
-  // If one triplet is left over, put it in the middle band; if two are left over put it on both side bands
-  int num1 = div + (mod==2?1:0); // number of blues before first star
-  int num2 = numstars/2; // yellow star
-  int num3 = div + (mod==1?1:0); // number of blues between the two stars
-  int num4 = numstars/2; // yellow star
-  int num5 = div + (mod==2?1:0); // number of blues after the star
-
-  num1+= numstart;
-  num5+= numend;
-
-  // generate three blue bands with two yellow stars
-  aoresult_t result;
-  uint16_t tix=0;
-  for( int i=0; i<num1; i++,tix++ ) {
-    result= aomw_topo_settriplet(tix, &aomw_topo_blue );
-    if( result!=aoresult_ok ) return result;
-  }
-  for( int i=0; i<num2; i++,tix++ ) {
-    result= aomw_topo_settriplet(tix, &aomw_topo_yellow );
-    if( result!=aoresult_ok ) return result;
-  }
-  for( int i=0; i<num3; i++,tix++ ) {
-    result= aomw_topo_settriplet(tix, &aomw_topo_blue );
-    if( result!=aoresult_ok ) return result;
-  }
-  for( int i=0; i<num4; i++,tix++ ) {
-    result= aomw_topo_settriplet(tix, &aomw_topo_yellow );
-    if( result!=aoresult_ok ) return result;
-  }
-  for( int i=0; i<num5; i++,tix++ ) {
-    result= aomw_topo_settriplet(tix, &aomw_topo_blue );
-    if( result!=aoresult_ok ) return result;
-  }
-
-  return aoresult_ok;
+  return aomw_flag_paintpix( AOMW_FLAG_PIX_EUROPE );
 }
 
 
@@ -191,54 +287,7 @@ aoresult_t aomw_flag_painter_europe() {
     @note   Abstraction of the flag from the USA.
 */
 aoresult_t aomw_flag_painter_usa() {
-  // determine number of triplets we have
-  int numtot    = aomw_topo_numtriplets(); // total number of triplets in chain
-  int nummain   = numtot-2-aomw_topo_node_numtriplets(1); // we have 1 blue to start then several white-blue and then several red-white pairs, and finally one red. The outer two are removed here.
-  int numpairs  = nummain/2;
-  int numcorner = numpairs/3; // the blue-white part
-
-  aoresult_t result;
-  uint16_t tixnum=aomw_topo_numtriplets();
-  uint16_t tix=0;
-  // First blue
-  int mcu=0;
-  while( mcu<aomw_topo_node_numtriplets(1)+1 && tix<tixnum ) {
-    result= aomw_topo_settriplet(tix, &aomw_topo_blue );
-    if( result!=aoresult_ok ) return result;
-    tix++;
-    mcu++;
-  }
-  // white/blue pairs
-  int pairs=0;
-  while( pairs<numcorner && tix<tixnum ) {
-    result= aomw_topo_settriplet(tix, &aomw_topo_white );
-    if( result!=aoresult_ok ) return result;
-    tix++;
-    if( tix<tixnum ) {
-      result= aomw_topo_settriplet(tix, &aomw_topo_blue );
-      if( result!=aoresult_ok ) return result;
-      tix++;
-    }
-    pairs++;
-  }
-  // first red
-  if( tix<tixnum ) {
-    result= aomw_topo_settriplet(tix, &aomw_topo_red );
-    if( result!=aoresult_ok ) return result;
-    tix++;
-  }
-  // white/red pairs
-  while( tix<tixnum ) {
-    result= aomw_topo_settriplet(tix, &aomw_topo_white );
-    if( result!=aoresult_ok ) return result;
-    tix++;
-    if( tix<tixnum ) {
-      result= aomw_topo_settriplet(tix, &aomw_topo_red );
-      if( result!=aoresult_ok ) return result;
-      tix++;
-    }
-  }
-  return aoresult_ok;
+  return aomw_flag_paintpix( AOMW_FLAG_PIX_USA );
 }
 
 
@@ -251,48 +300,7 @@ aoresult_t aomw_flag_painter_usa() {
     @note   Abstraction of the flag from China.
 */
 aoresult_t aomw_flag_painter_china() {
-  int numtot  = aomw_topo_numtriplets(); // total number of triplets in chain
-  int numstart= aomw_topo_node_numtriplets(1); // number of triplets on the start of the chain that must be red
-  int numend  = aomw_topo_loop()? aomw_topo_node_numtriplets(aomw_topo_numnodes()) : 0; // number of triplets on the end of the chain that must be red
-  int numpcb  = numtot-numstart-numend; // number of triplets on the PCB
-  int numstars= numpcb<7 ? 0 : 3 ; //number of yellow stars
-  int numred  = numpcb-numstars; // number of triplets on the pcb(s) that we want to be red
-
-  // If one triplet is left over, put it in the middle band; if two are left over put it on both side bands
-  int num1 = numred>1 ? 1 : 0; // number of reds before first star
-  int num2 = (numstars+1)/2; // yellow star
-  int num3 = numred>2 ? 1 : 0; // number of reds between the two stars
-  int num4 = numstars/2; // yellow star
-  int num5 = numred-num1-num3; // number of reds after the star
-
-  num1+= numstart;
-  num5+= numend;
-
-  // generate three red bands with two yellow stars
-  aoresult_t result;
-  uint16_t tix=0;
-  for( int i=0; i<num1; i++,tix++ ) {
-    result= aomw_topo_settriplet(tix, &aomw_topo_red );
-    if( result!=aoresult_ok ) return result;
-  }
-  for( int i=0; i<num2; i++,tix++ ) {
-    result= aomw_topo_settriplet(tix, &aomw_topo_yellow );
-    if( result!=aoresult_ok ) return result;
-  }
-  for( int i=0; i<num3; i++,tix++ ) {
-    result= aomw_topo_settriplet(tix, &aomw_topo_red );
-    if( result!=aoresult_ok ) return result;
-  }
-  for( int i=0; i<num4; i++,tix++ ) {
-    result= aomw_topo_settriplet(tix, &aomw_topo_yellow );
-    if( result!=aoresult_ok ) return result;
-  }
-  for( int i=0; i<num5; i++,tix++ ) {
-    result= aomw_topo_settriplet(tix, &aomw_topo_red );
-    if( result!=aoresult_ok ) return result;
-  }
-
-  return aoresult_ok;
+  return aomw_flag_paintpix( AOMW_FLAG_PIX_CHINA );
 }
 
 
@@ -301,28 +309,28 @@ aoresult_t aomw_flag_painter_china() {
 // available via index (aomw_flag_pix_xxx) or via name (aomw_flag_name())
 
 
-// Coupling a name to a painter
+// Coupling a flag (description) to a painter
 typedef struct aomw_flag_painter_s {
-  const char *         name;
+  const aomw_flag_t *  flag;
   aocmd_flag_painter_t painter;
 } aomw_flag_painter_t;
 
 
 // Database of painters - must be kept in sync with AOMW_FLAG_PIX_XXX
-static aomw_flag_painter_t aomw_flag_painters[] = {
-  { "dutch",     aomw_flag_painter_dutch    },
-  { "columbia",  aomw_flag_painter_columbia },
-  { "japan",     aomw_flag_painter_japan    },
-  { "mali",      aomw_flag_painter_mali     },
-  { "italy",     aomw_flag_painter_italy    },
-  { "europe",    aomw_flag_painter_europe   },
-  { "usa",       aomw_flag_painter_usa      },
-  { "china",     aomw_flag_painter_china    },
+static const aomw_flag_painter_t aomw_flag_painters[] = {
+  { &aomw_flag_dutch,     aomw_flag_painter_dutch    },
+  { &aomw_flag_columbia,  aomw_flag_painter_columbia },
+  { &aomw_flag_japan,     aomw_flag_painter_japan    },
+  { &aomw_flag_mali,      aomw_flag_painter_mali     },
+  { &aomw_flag_italy,     aomw_flag_painter_italy    },
+  { &aomw_flag_europe,    aomw_flag_painter_europe   },
+  { &aomw_flag_usa,       aomw_flag_painter_usa      },
+  { &aomw_flag_china,     aomw_flag_painter_china    },
 };
 
 
 // Number of painters
-#define AOMW_FLAG_PAINTERS_COUNT ( sizeof(aomw_flag_painters)/sizeof(aomw_flag_painters[0]) )
+#define AOMW_FLAG_PAINTERS_COUNT ( (int)(sizeof(aomw_flag_painters)/sizeof(aomw_flag_painters[0])) )
 
 
 /*!
@@ -343,7 +351,7 @@ int aomw_flag_count() {
 */
 const char * aomw_flag_name(int pix) {
   AORESULT_ASSERT( 0<=pix && pix<AOMW_FLAG_PAINTERS_COUNT );
-  return aomw_flag_painters[pix].name;
+  return aomw_flag_painters[pix].flag->name;
 }
 
 
@@ -358,3 +366,292 @@ aocmd_flag_painter_t aomw_flag_painter(int pix) {
   return aomw_flag_painters[pix].painter;
 }
 
+
+// === Layout cache ==========================================================
+// The layout (spans) of a flag only depends on the topo map. So the layout
+// of each stock flag is cached, together with the topo generation it was
+// resolved for. Repeated painting of a flag is then pure output.
+
+
+// The cached layout of one flag
+typedef struct aomw_flag_cache_s {
+  uint32_t         generation;  // topo generation the spans were resolved for (0 for not cached)
+  int              numspans;    // number of valid entries in spans[]
+  aomw_flag_span_t spans[AOMW_FLAG_MAXBANDS];
+} aomw_flag_cache_t;
+
+
+// The caches, one per stock flag
+static aomw_flag_cache_t aomw_flag_caches[AOMW_FLAG_PAINTERS_COUNT];
+
+
+/*!
+    @brief  Returns the layout (spans) of stock flag `pix` for the current
+            topo.
+    @param  pix
+            The painter index [0..aomw_flag_count)
+    @param  numspans
+            Output parameter, receives the number of spans.
+    @return Pointer to the (cached) spans. 
+    @note   The OSP chain must be initialized (eg with aomw_topo_build()).
+    @note   The layout is only resolved (aomw_flag_resolve) when the topo 
+            map changed since the previous call (aomw_topo_generation).
+*/
+const aomw_flag_span_t * aomw_flag_layout(int pix, int * numspans) {
+  AORESULT_ASSERT( 0<=pix && pix<AOMW_FLAG_PAINTERS_COUNT );
+  aomw_flag_cache_t * cache= &aomw_flag_caches[pix];
+  if( cache->generation != aomw_topo_generation() ) {
+    cache->numspans= aomw_flag_resolve(aomw_flag_painters[pix].flag, cache->spans);
+    cache->generation= aomw_topo_generation();
+  }
+  *numspans= cache->numspans;
+  return cache->spans;
+}
+
+
+// Paints stock flag `pix` using its cached layout
+static aoresult_t aomw_flag_paintpix( int pix ) {
+  int numspans;
+  const aomw_flag_span_t * spans= aomw_flag_layout(pix, &numspans);
+  aoresult_t result= aomw_flag_paintspans(spans, numspans);
+  aomw_flag_shown_pix= result==aoresult_ok ? pix : -1;
+  aomw_flag_shown_generation= aomw_topo_generation();
+  return result;
+}
+
+
+/*!
+    @brief  Returns the description (table of bands) of flag `pix`.
+    @param  pix
+            The painter index [0..aomw_flag_count)
+    @return Flag description (eg for aomw_flag_paint()). 
+*/
+const aomw_flag_t * aomw_flag_flag(int pix) {
+  AORESULT_ASSERT( 0<=pix && pix<AOMW_FLAG_PAINTERS_COUNT );
+  return aomw_flag_painters[pix].flag;
+}
+
+
+// === Transitions ===========================================================
+// A transition switches from the stock flag currently shown to another stock
+// flag. It compares the (cached) layouts of both flags, and only sends 
+// telegrams for triplets that change color. For example, going from italy
+// (green-white-red) to japan (white-red-white) does not touch the white 
+// triplets in the middle band of italy that are also white in japan (if 
+// the bands align), and going from dutch to itself sends nothing at all.
+//
+// The comparison is done span-wise: walking the spans of both layouts gives
+// at most 2*AOMW_FLAG_MAXBANDS segments in which both flags have a constant 
+// span. Segments where both spans are solid with the same color are dropped.
+// Within the remaining segments, triplets are compared individually (needed 
+// for patterns).
+//
+// A transition has a start/step/done API, like the topo builder. Every step
+// sends at most `budget` telegrams, so that the caller can fit it in its 
+// frame time. The mode determines how the changed triplets are updated:
+// - AOMW_FLAG_TRANSITION_WIPE: every changed triplet is sent once (with its 
+//   new color), in order of triplet index, so the new flag wipes in.
+// - AOMW_FLAG_TRANSITION_FADE: all changed triplets are sent `numframes` 
+//   times, each time with a color closer to the new color (fixed-point 
+//   linear interpolation in 1/256 steps). A frame may be spread over several
+//   steps if it does not fit the budget.
+
+
+// A segment of triplets where both the old and the new flag have one span
+typedef struct aomw_flag_seg_s {
+  uint16_t                 tix0;
+  uint16_t                 tix1;
+  const aomw_flag_span_t * from; // span of the old flag (NULL if old flag is unknown)
+  const aomw_flag_span_t * to;   // span of the new flag
+} aomw_flag_seg_t;
+
+
+// State of the transition
+static int             aomw_flag_trans_pix;       // flag we transition to
+static int             aomw_flag_trans_mode;      // AOMW_FLAG_TRANSITION_XXX
+static int             aomw_flag_trans_numframes; // number of frames for a fade
+static int             aomw_flag_trans_frame;     // current frame 1..numframes
+static int             aomw_flag_trans_numsegs;   // number of segments with (potential) changes
+static aomw_flag_seg_t aomw_flag_trans_segs[2*AOMW_FLAG_MAXBANDS];
+static int             aomw_flag_trans_six;       // cursor: segment index
+static uint16_t        aomw_flag_trans_tix;       // cursor: triplet index
+static int             aomw_flag_trans_done = 1;  // no transition in progress
+static uint32_t        aomw_flag_trans_generation; // topo generation the segments were made for
+
+
+// Returns the color of triplet `tix` in `span`
+static const aomw_topo_rgb_t * aomw_flag_spancolor( const aomw_flag_span_t * span, uint16_t tix ) {
+  if( span->alt!=NULL && (tix-span->tix0)%2==1 ) return span->alt;
+  return span->rgb;
+}
+
+
+// Returns 1 iff colors `rgb1` and `rgb2` are the same
+static int aomw_flag_samecolor( const aomw_topo_rgb_t * rgb1, const aomw_topo_rgb_t * rgb2 ) {
+  return rgb1==rgb2 || ( rgb1->r==rgb2->r && rgb1->g==rgb2->g && rgb1->b==rgb2->b );
+}
+
+
+// Moves the cursor to the first changed triplet at or after the cursor; returns 0 if there is none
+static int aomw_flag_trans_seek() {
+  while( aomw_flag_trans_six < aomw_flag_trans_numsegs ) {
+    const aomw_flag_seg_t * seg= &aomw_flag_trans_segs[aomw_flag_trans_six];
+    if( aomw_flag_trans_tix < seg->tix1 ) {
+      if( seg->from==NULL ) return 1;
+      if( !aomw_flag_samecolor(aomw_flag_spancolor(seg->from,aomw_flag_trans_tix), aomw_flag_spancolor(seg->to,aomw_flag_trans_tix)) ) return 1;
+      aomw_flag_trans_tix++;
+    } else {
+      aomw_flag_trans_six++;
+      if( aomw_flag_trans_six < aomw_flag_trans_numsegs ) aomw_flag_trans_tix= aomw_flag_trans_segs[aomw_flag_trans_six].tix0;
+    }
+  }
+  return 0;
+}
+
+
+// Moves the cursor to the start of the segments
+static void aomw_flag_trans_rewind() {
+  aomw_flag_trans_six= 0;
+  aomw_flag_trans_tix= aomw_flag_trans_numsegs>0 ? aomw_flag_trans_segs[0].tix0 : 0;
+}
+
+
+/*!
+    @brief  Starts a transition from the stock flag currently shown to stock
+            flag `pix`. Follow up with aomw_flag_transition_step() until 
+            aomw_flag_transition_done().
+    @param  pix
+            The painter index [0..aomw_flag_count) of the new flag.
+    @param  mode
+            AOMW_FLAG_TRANSITION_WIPE or AOMW_FLAG_TRANSITION_FADE.
+    @param  numframes
+            Number of frames of a fade (1 switches in one frame); 
+            ignored for a wipe.
+    @note   The OSP chain must be initialized (eg with aomw_topo_build()).
+    @note   The current flag is the one last painted by a stock painter or
+            by a completed transition. If that is unknown (eg first flag, 
+            other painting, topo rebuilt) all triplets are considered 
+            changed; a fade then starts from off.
+    @note   No telegrams are sent by this function.
+*/
+void aomw_flag_transition_start(int pix, int mode, int numframes) {
+  AORESULT_ASSERT( 0<=pix && pix<AOMW_FLAG_PAINTERS_COUNT );
+  AORESULT_ASSERT( mode==AOMW_FLAG_TRANSITION_WIPE || mode==AOMW_FLAG_TRANSITION_FADE );
+  aomw_flag_trans_pix= pix;
+  aomw_flag_trans_mode= mode;
+  aomw_flag_trans_numframes= numframes<1 ? 1 : numframes;
+  aomw_flag_trans_frame= 1;
+  aomw_flag_trans_numsegs= 0;
+  aomw_flag_trans_done= 0;
+  aomw_flag_trans_generation= aomw_topo_generation();
+
+  // Layout of the new flag
+  int numto;
+  const aomw_flag_span_t * to= aomw_flag_layout(pix, &numto);
+  // Layout of the old flag (if known)
+  int numfrom= 0;
+  const aomw_flag_span_t * from= NULL;
+  if( aomw_flag_shown_pix>=0 && aomw_flag_shown_generation==aomw_topo_generation() ) from= aomw_flag_layout(aomw_flag_shown_pix, &numfrom);
+
+  // Walk both span lists in parallel (both cover the entire chain)
+  int fix=0, tix=0;
+  while( tix<numto ) {
+    aomw_flag_seg_t * seg= &aomw_flag_trans_segs[aomw_flag_trans_numsegs];
+    seg->to  = &to[tix];
+    seg->tix0= to[tix].tix0;
+    seg->tix1= to[tix].tix1;
+    if( from!=NULL && from[fix].tix0>seg->tix0 ) seg->tix0= from[fix].tix0;
+    if( from!=NULL && from[fix].tix1<seg->tix1 ) seg->tix1= from[fix].tix1;
+    seg->from= from==NULL ? NULL : &from[fix];
+    // Keep the segment unless both spans are solid with the same color
+    int same= from!=NULL && from[fix].alt==NULL && to[tix].alt==NULL && aomw_flag_samecolor(from[fix].rgb,to[tix].rgb);
+    if( !same && seg->tix0<seg->tix1 ) aomw_flag_trans_numsegs++;
+    // Advance the span(s) that end here
+    if( from!=NULL && from[fix].tix1==seg->tix1 ) fix++;
+    if( to[tix].tix1==seg->tix1 ) tix++;
+  }
+  aomw_flag_trans_rewind();
+}
+
+
+/*!
+    @brief  Performs the next step of the transition started with 
+            aomw_flag_transition_start().
+    @param  budget
+            The maximum number of telegrams this step may send (a budget
+            below 1 is taken as 1).
+    @return aoresult_ok           If painting was successful
+            other error code      if there is a (communications) error
+    @note   Call this e.g. once per animation frame until 
+            aomw_flag_transition_done().
+    @note   When the transition is completed, the new flag is the current
+            flag (for the next transition). While it is in progress, the 
+            current flag is unknown (aomw_flag_current() returns -1), so a
+            transition that is abandoned halfway is not taken as shown.
+    @note   When the topo map changed since the start (a rebuild), the 
+            transition restarts from an unknown flag.
+*/
+aoresult_t aomw_flag_transition_step(int budget) {
+  aoresult_t result;
+  if( aomw_flag_trans_done ) return aoresult_ok;
+  if( budget<1 ) budget= 1;
+  if( aomw_flag_trans_generation!=aomw_topo_generation() ) {
+    // The segments point into layouts of a previous map
+    aomw_flag_shown_pix= -1;
+    aomw_flag_transition_start(aomw_flag_trans_pix, aomw_flag_trans_mode, aomw_flag_trans_numframes);
+  }
+  // Weight of the new color in this frame (fixed point, 256 is 1.0)
+  int32_t w= aomw_flag_trans_mode==AOMW_FLAG_TRANSITION_FADE ? aomw_flag_trans_frame*256/aomw_flag_trans_numframes : 256;
+  while( budget>0 ) {
+    if( !aomw_flag_trans_seek() ) {
+      // All changed triplets sent; next frame or done
+      if( aomw_flag_trans_frame<aomw_flag_trans_numframes && aomw_flag_trans_mode==AOMW_FLAG_TRANSITION_FADE ) {
+        aomw_flag_trans_frame++;
+        aomw_flag_trans_rewind();
+        return aoresult_ok; // next frame in next step
+      }
+      aomw_flag_trans_done= 1;
+      aomw_flag_shown_pix= aomw_flag_trans_pix;
+      aomw_flag_shown_generation= aomw_topo_generation();
+      return aoresult_ok;
+    }
+    // Send the changed triplet under the cursor
+    const aomw_flag_seg_t * seg= &aomw_flag_trans_segs[aomw_flag_trans_six];
+    const aomw_topo_rgb_t * rgb1= seg->from==NULL ? &aomw_topo_off : aomw_flag_spancolor(seg->from,aomw_flag_trans_tix);
+    const aomw_topo_rgb_t * rgb2= aomw_flag_spancolor(seg->to,aomw_flag_trans_tix);
+    aomw_topo_rgb_t rgb;
+    rgb.r= rgb1->r + ( ((int32_t)rgb2->r-rgb1->r)*w >> 8 );
+    rgb.g= rgb1->g + ( ((int32_t)rgb2->g-rgb1->g)*w >> 8 );
+    rgb.b= rgb1->b + ( ((int32_t)rgb2->b-rgb1->b)*w >> 8 );
+    rgb.name= rgb2->name;
+    aomw_flag_shown_pix= -1; // the chain is now between two flags
+    result= aomw_topo_settriplet(aomw_flag_trans_tix, &rgb);
+    if( result!=aoresult_ok ) { aomw_flag_trans_done= 1; aomw_flag_shown_pix= -1; return result; }
+    aomw_flag_trans_tix++;
+    budget--;
+  }
+  return aoresult_ok;
+}
+
+
+/*!
+    @brief  Returns if the transition started with 
+            aomw_flag_transition_start() is completed.
+    @return 1   if no more step is needed
+            0   if another aomw_flag_transition_step() is needed
+*/
+int aomw_flag_transition_done() {
+  return aomw_flag_trans_done;
+}
+
+
+/*!
+    @brief  Returns the stock flag currently shown on the chain.
+    @return The painter index [0..aomw_flag_count) of the current flag,
+            or -1 when unknown.
+    @note   Set by the stock painters and completed transitions.
+*/
+int aomw_flag_current() {
+  if( aomw_flag_shown_generation!=aomw_topo_generation() ) return -1;
+  return aomw_flag_shown_pix;
+}
@@ -23,6 +23,48 @@
 
 
 #include <aoresult.h>   // aoresult_t
+#include <aomw_topo.h>  // aomw_topo_rgb_t
+
+
+// A flag is a series of bands, from the start of the chain to the end.
+// Most bands get a proportional `share` of the triplets (three equal shares 
+// for a tricolor). A band with a `fixed` count is a detail (eg a star); 
+// details are only painted when the chain has at least `mindetail` triplets.
+// A band with an `alt` color is a pattern alternating `rgb` and `alt`.
+typedef struct aomw_flag_band_s {
+  const aomw_topo_rgb_t * rgb;   // color of the band
+  const aomw_topo_rgb_t * alt;   // NULL for a solid band, else the band alternates rgb and alt
+  uint8_t                 fixed; // >0 for a detail band: its number of triplets
+  uint8_t                 share; // for non-detail bands: relative share of the remaining triplets
+} aomw_flag_band_t;
+#define AOMW_FLAG_SOLID(rgb,share)        { rgb, NULL, 0, share }
+#define AOMW_FLAG_PATTERN(rgb,alt,share)  { rgb, alt,  0, share }
+#define AOMW_FLAG_DETAIL(rgb,fixed)       { rgb, NULL, fixed, 0 }
+// Maximum number of bands in a flag
+#define AOMW_FLAG_MAXBANDS 8
+
+
+// The (constant) description of a flag
+typedef struct aomw_flag_s {
+  const char *             name;      // eg "dutch"
+  const aomw_flag_band_t * bands;     // the bands of the flag
+  uint8_t                  numbands;  // 1..AOMW_FLAG_MAXBANDS
+  uint8_t                  mindetail; // minimal number of triplets (excluding MCU board) to show detail bands
+} aomw_flag_t;
+#define AOMW_FLAG_NUMBANDS(bands) ( (int)(sizeof(bands)/sizeof((bands)[0])) )
+
+
+// A flag resolved to the current topo: triplets tix0<=tix<tix1 get rgb (alternated with alt when not NULL)
+typedef struct aomw_flag_span_s {
+  uint16_t                tix0;
+  uint16_t                tix1;
+  const aomw_topo_rgb_t * rgb;
+  const aomw_topo_rgb_t * alt;
+} aomw_flag_span_t;
+// Resolves `flag` for the current topo into at most AOMW_FLAG_MAXBANDS `spans`; returns the number of spans.
+int aomw_flag_resolve( const aomw_flag_t * flag, aomw_flag_span_t * spans );
+// Paints `flag` over the entire chain
+aoresult_t aomw_flag_paint( const aomw_flag_t * flag );
 
 
 // Painter use topo to draw the flag over the entire chain
@@ -51,6 +93,20 @@ typedef aoresult_t (*aocmd_flag_painter_t)( );
 int                  aomw_flag_count();
 const char *         aomw_flag_name(int pix);
 aocmd_flag_painter_t aomw_flag_painter(int pix);
+const aomw_flag_t *  aomw_flag_flag(int pix);
+// Returns the layout of flag `pix`; cached, only resolved again when the topo map changed.
+const aomw_flag_span_t * aomw_flag_layout(int pix, int * numspans);
+
+
+// Transition from the current flag to flag `pix`, only sending telegrams for triplets that change color
+#define AOMW_FLAG_TRANSITION_WIPE 0 // changed triplets switch once, in tix order
+#define AOMW_FLAG_TRANSITION_FADE 1 // changed triplets crossfade in `numframes` frames
+void       aomw_flag_transition_start(int pix, int mode, int numframes);
+// Sends at most `budget` telegrams for the transition; call until aomw_flag_transition_done().
+aoresult_t aomw_flag_transition_step(int budget);
+int        aomw_flag_transition_done();
+// Returns the stock flag currently shown (-1 if unknown)
+int        aomw_flag_current();
 
 
 #endif
@@ -0,0 +1,263 @@
+// aomw_fx.cpp - parametric effects (chase, rainbow, breathing, sparkle, gradient) rendered into the topo framebuffer
+/*****************************************************************************
+ * Copyright 2024 by ams OSRAM AG                                            *
+ * All rights are reserved.                                                  *
+ *                                                                           *
+ * IMPORTANT - PLEASE READ CAREFULLY BEFORE COPYING, INSTALLING OR USING     *
+ * THE SOFTWARE.                                                             *
+ *                                                                           *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS       *
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT         *
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS         *
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT  *
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,     *
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT          *
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,     *
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY     *
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT       *
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE     *
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.      *
+ *****************************************************************************/
+#include <Arduino.h>    // micros()
+#include <aomw_topo.h> // aomw_topo_fb_set()
+#include <aomw_fx.h>   // own
+
+
+// The effects engine renders one effect (aomw_fx_t) into the topo 
+// framebuffer. A frame is rendered for one moment in time; every triplet 
+// in the region gets a color computed from its offset in the region and 
+// from the phase of the effect (time modulo period). All math is integer
+// (fixed point): phases and weights are 0..1024 ("pro-kibi", like the topo
+// dim level) and hues are 0..1535 (six sectors of 256).
+//
+// Rendering a frame may take longer than the application can afford in one
+// step, so aomw_fx_render() has a time budget. When the budget is used up,
+// render returns 0 and the next call continues the same frame (the time 
+// is latched at the start of a frame). When render returns 1 the frame is
+// complete and the application flushes (aomw_fx_flush()).
+//
+// The framebuffer only marks triplets that change. The engine additionally
+// records spans of changed triplets (merged when close), so an application
+// can see what a frame touched; a static effect (e.g. a gradient without 
+// period) has no spans after its first frame, and a flush sends nothing.
+
+
+#define AOMW_FX_CHECKEVERY 16 // Number of triplets rendered between budget checks
+#define AOMW_FX_SPANGAP     4 // Changed triplets this close to the last span extend that span
+
+
+static aomw_fx_t        aomw_fx_fx;                          // The effect being rendered
+static uint16_t         aomw_fx_tix0;                        // Region of the current frame (resolved tix0)
+static uint16_t         aomw_fx_tix1;                        // Region of the current frame (resolved tix1)
+static uint16_t         aomw_fx_cursor;                      // Next triplet to render; tix1 when the frame is complete
+static uint32_t         aomw_fx_ms;                          // Time of the current frame
+static uint16_t         aomw_fx_phase;                       // Phase of the current frame 0..1023
+static aomw_topo_rgb_t  aomw_fx_frame_rgb;                   // Per frame color (breathing)
+static int              aomw_fx_numspans_;                   // Number of dirty spans
+static aomw_fx_span_t   aomw_fx_spans[AOMW_FX_MAXSPANS];     // Dirty spans (ascending, within one frame)
+
+
+// Blends: returns a*w/1024 + b*(1024-w)/1024, per component.
+static void aomw_fx_blend( aomw_topo_rgb_t * rgb, const aomw_topo_rgb_t * a, const aomw_topo_rgb_t * b, int w ) {
+  rgb->r= b->r + (((int32_t)a->r - b->r) * w >> 10);
+  rgb->g= b->g + (((int32_t)a->g - b->g) * w >> 10);
+  rgb->b= b->b + (((int32_t)a->b - b->b) * w >> 10);
+}
+
+
+// Converts a hue (0..1535) to a fully saturated color in the topo brightness range.
+static void aomw_fx_hue( aomw_topo_rgb_t * rgb, int hue ) {
+  int x= hue & 0xFF;                           // position in sector 0..255
+  uint16_t up  = (x<<7) | (x>>1);              // 0..0x7FFF rising
+  uint16_t down= AOMW_TOPO_BRIGHTNESS_MAX-up;  // 0x7FFF..0 falling
+  uint16_t max = AOMW_TOPO_BRIGHTNESS_MAX;
+  switch( hue>>8 ) {
+    case 0 : rgb->r=max;  rgb->g=up;   rgb->b=0;    break; // red to yellow
+    case 1 : rgb->r=down; rgb->g=max;  rgb->b=0;    break; // yellow to green
+    case 2 : rgb->r=0;    rgb->g=max;  rgb->b=up;   break; // green to cyan
+    case 3 : rgb->r=0;    rgb->g=down; rgb->b=max;  break; // cyan to blue
+    case 4 : rgb->r=up;   rgb->g=0;    rgb->b=max;  break; // blue to magenta
+    default: rgb->r=max;  rgb->g=0;    rgb->b=down; break; // magenta to red
+  }
+}
+
+
+// Hashes triplet tix and pattern number n to 0..255 (for sparkle).
+static int aomw_fx_hash( uint32_t tix, uint32_t n ) {
+  uint32_t h= tix*0x9E3779B1UL ^ n*0x85EBCA77UL;
+  h^= h>>15; h*= 0x2C1B3C6DUL; h^= h>>12;
+  return h & 0xFF;
+}
+
+
+// Records that triplet tix changed: extends the last span when close, else appends a span (when full, the last span grows).
+static void aomw_fx_touch( uint16_t tix ) {
+  aomw_fx_span_t * last= aomw_fx_numspans_>0 ? &aomw_fx_spans[aomw_fx_numspans_-1] : NULL;
+  if( last!=NULL && last->tix0<=tix && tix<=last->tix1+AOMW_FX_SPANGAP ) {
+    if( tix>=last->tix1 ) last->tix1= tix+1;
+    return;
+  }
+  // Frames rendered without flush in between revisit triplets
+  for( int six=0; six<aomw_fx_numspans_; six++ ) {
+    if( aomw_fx_spans[six].tix0<=tix && tix<aomw_fx_spans[six].tix1 ) return;
+  }
+  if( aomw_fx_numspans_<AOMW_FX_MAXSPANS ) {
+    aomw_fx_spans[aomw_fx_numspans_].tix0= tix;
+    aomw_fx_spans[aomw_fx_numspans_].tix1= tix+1;
+    aomw_fx_numspans_++;
+    return;
+  }
+  if( tix<last->tix0 ) last->tix0= tix;
+  if( tix>=last->tix1 ) last->tix1= tix+1;
+}
+
+
+// Computes the color of the triplet at offset `off` in the region (of `len` triplets).
+static void aomw_fx_color( aomw_topo_rgb_t * rgb, int off, int len ) {
+  const aomw_fx_t * fx= &aomw_fx_fx;
+  switch( fx->kind ) {
+    case AOMW_FX_CHASE: {
+      int size= fx->size>0 ? fx->size : 1;
+      int head= (int32_t)aomw_fx_phase * len >> 10;
+      int dist= (head - off + len) % len; // distance behind the head
+      if( dist<size ) aomw_fx_blend(rgb, &fx->rgb1, &fx->rgb2, (size-dist)*1024/size );
+      else *rgb= fx->rgb2;
+      break;
+    }
+    case AOMW_FX_RAINBOW: {
+      int wave= fx->size>0 ? fx->size : len;
+      int hue= ( (int32_t)off*1536/wave + (int32_t)aomw_fx_phase*1536/1024 ) % 1536;
+      aomw_fx_hue(rgb, hue);
+      break;
+    }
+    case AOMW_FX_BREATHING:
+      *rgb= aomw_fx_frame_rgb;
+      break;
+    case AOMW_FX_SPARKLE: {
+      uint32_t pattern= fx->period_ms>0 ? aomw_fx_ms/fx->period_ms : aomw_fx_ms;
+      *rgb= aomw_fx_hash(off,pattern) < fx->size ? fx->rgb1 : fx->rgb2;
+      break;
+    }
+    case AOMW_FX_GRADIENT: {
+      int w;
+      if( fx->period_ms==0 ) {
+        w= len>1 ? (int32_t)off*1024/(len-1) : 0;
+      } else {
+        int pos= ( (int32_t)off*1024/len + aomw_fx_phase ) % 1024 * 2; // 0..2046
+        w= pos<1024 ? pos : 2047-pos; // back and forth, no jump
+      }
+      aomw_fx_blend(rgb, &fx->rgb2, &fx->rgb1, w );
+      break;
+    }
+    default:
+      *rgb= aomw_topo_off;
+      break;
+  }
+}
+
+
+// Latches time and computes the per frame constants.
+static void aomw_fx_frame_start( uint32_t ms ) {
+  const aomw_fx_t * fx= &aomw_fx_fx;
+  uint16_t num= aomw_topo_numtriplets();
+  if( num>AOMW_TOPO_MAXTRIPLETS ) num= AOMW_TOPO_MAXTRIPLETS; // the framebuffer size
+  aomw_fx_tix1= fx->tix1==0 || fx->tix1>num ? num : fx->tix1;
+  aomw_fx_tix0= fx->tix0<aomw_fx_tix1 ? fx->tix0 : aomw_fx_tix1;
+  aomw_fx_cursor= aomw_fx_tix0;
+  aomw_fx_ms= ms;
+  aomw_fx_phase= fx->period_ms>0 ? (ms % fx->period_ms) * 1024 / fx->period_ms : 0;
+  if( fx->kind==AOMW_FX_BREATHING ) {
+    int tri= aomw_fx_phase<512 ? aomw_fx_phase*2 : (1023-aomw_fx_phase)*2; // 0..1022..0
+    aomw_fx_blend(&aomw_fx_frame_rgb, &fx->rgb1, &fx->rgb2, tri*tri>>10 ); // squared: slow near dark
+  }
+}
+
+
+/*!
+    @brief  Starts an effect.
+    @param  fx
+            The description of the effect; it is copied.
+    @note   The next aomw_fx_render() starts a new frame.
+    @note   The dirty spans are cleared; the framebuffer is not (the first
+            frame only changes triplets that differ from the previous effect).
+*/
+void aomw_fx_start( const aomw_fx_t * fx ) {
+  aomw_fx_fx= *fx;
+  aomw_fx_tix0= 0;
+  aomw_fx_tix1= 0;
+  aomw_fx_cursor= 0; // cursor==tix1: frame complete, next render starts a frame
+  aomw_fx_numspans_= 0;
+}
+
+
+/*!
+    @brief  Renders the frame for time `ms` into the topo framebuffer, or 
+            a part of it when the time budget runs out.
+    @param  ms
+            The time of the frame (typically millis()); only used when a 
+            new frame starts (the previous one was complete).
+    @param  budget_us
+            Maximum time to spend (micro seconds); 0 for no limit. The 
+            budget is checked every 16 triplets, so it may be exceeded by 
+            the time of 16 triplets.
+    @return 1 if the frame is complete, 0 if a next call must continue it.
+    @note   Only writes the framebuffer (aomw_topo_fb_set()); it does not
+            send telegrams, see aomw_fx_flush().
+    @note   Only available after aomw_topo_build(); the region is clipped 
+            to the number of triplets (and the framebuffer size).
+*/
+int aomw_fx_render( uint32_t ms, uint32_t budget_us ) {
+  if( aomw_fx_cursor>=aomw_fx_tix1 ) aomw_fx_frame_start(ms);
+  uint32_t t0= micros();
+  int len= aomw_fx_tix1-aomw_fx_tix0;
+  while( aomw_fx_cursor<aomw_fx_tix1 ) {
+    aomw_topo_rgb_t rgb;
+    aomw_fx_color(&rgb, aomw_fx_cursor-aomw_fx_tix0, len);
+    if( aomw_topo_fb_set(aomw_fx_cursor, &rgb) ) aomw_fx_touch(aomw_fx_cursor);
+    aomw_fx_cursor++;
+    if( budget_us>0 && (aomw_fx_cursor-aomw_fx_tix0)%AOMW_FX_CHECKEVERY==0 && micros()-t0>=budget_us ) break;
+  }
+  return aomw_fx_cursor>=aomw_fx_tix1;
+}
+
+
+/*!
+    @brief  Returns the number of dirty spans: the spans of triplets that
+            were changed by aomw_fx_render() since the last aomw_fx_flush().
+    @return The number of spans (0..AOMW_FX_MAXSPANS).
+    @note   Changed triplets that are close are merged in one span, and 
+            when there are more than AOMW_FX_MAXSPANS spans, the last one 
+            grows; so spans may include unchanged triplets, but all 
+            changed triplets are in a span.
+*/
+int aomw_fx_numspans() {
+  return aomw_fx_numspans_;
+}
+
+
+/*!
+    @brief  Returns a dirty span.
+    @param  six
+            The index of the span, 0 <= six < aomw_fx_numspans().
+    @return The span (of logical triplets).
+*/
+const aomw_fx_span_t * aomw_fx_span( int six ) {
+  AORESULT_ASSERT( 0<=six && six<aomw_fx_numspans_ );
+  return &aomw_fx_spans[six];
+}
+
+
+/*!
+    @brief  Sends the triplets that changed, and clears the dirty spans.
+    @return aoresult_ok      if successful
+            other error code if there is a (communications) error
+    @note   This is aomw_topo_fb_flush(); the framebuffer knows exactly 
+            which triplets changed, so one telegram per changed triplet.
+    @note   When there are no dirty spans, nothing is sent.
+*/
+aoresult_t aomw_fx_flush() {
+  if( aomw_fx_numspans_==0 ) return aoresult_ok;
+  aoresult_t result= aomw_topo_fb_flush();
+  if( result==aoresult_ok ) aomw_fx_numspans_= 0;
+  return result;
+}
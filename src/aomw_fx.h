@@ -0,0 +1,70 @@
+// aomw_fx.h - parametric effects (chase, rainbow, breathing, sparkle, gradient) rendered into the topo framebuffer
+/*****************************************************************************
+ * Copyright 2024 by ams OSRAM AG                                            *
+ * All rights are reserved.                                                  *
+ *                                                                           *
+ * IMPORTANT - PLEASE READ CAREFULLY BEFORE COPYING, INSTALLING OR USING     *
+ * THE SOFTWARE.                                                             *
+ *                                                                           *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS       *
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT         *
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS         *
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT  *
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,     *
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT          *
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,     *
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY     *
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT       *
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE     *
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.      *
+ *****************************************************************************/
+#ifndef _AOMW_FX_H_
+#define _AOMW_FX_H_
+
+
+#include <stdint.h>    // uint16_t
+#include <aoresult.h>  // aoresult_t
+#include <aomw_topo.h> // aomw_topo_rgb_t
+
+
+// The effect kinds
+#define AOMW_FX_CHASE     0 // A block of `size` triplets (fading tail) of rgb1 runs over rgb2, one lap per period
+#define AOMW_FX_RAINBOW   1 // A rainbow of `size` triplets (0: the region) scrolls, one hue cycle per period
+#define AOMW_FX_BREATHING 2 // All triplets fade from rgb2 to rgb1 and back, once per period
+#define AOMW_FX_SPARKLE   3 // Random triplets (`size` per 256) flash rgb1 on rgb2; new pattern every period
+#define AOMW_FX_GRADIENT  4 // A gradient from rgb1 to rgb2; it scrolls (back and forth) once per period (0: static)
+
+
+// The description of an effect
+typedef struct aomw_fx_s {
+  int             kind;      // AOMW_FX_xxx
+  aomw_topo_rgb_t rgb1;      // Foreground color (or start color of gradient)
+  aomw_topo_rgb_t rgb2;      // Background color (or end color of gradient)
+  uint16_t        period_ms; // Duration of one cycle
+  uint16_t        size;      // Meaning depends on kind (see AOMW_FX_xxx)
+  uint16_t        tix0;      // Region: first (logical) triplet
+  uint16_t        tix1;      // Region: triplet after last one (0 for aomw_topo_numtriplets())
+} aomw_fx_t;
+
+
+// A span of (logical) triplets tix0<=tix<tix1
+typedef struct aomw_fx_span_s { uint16_t tix0; uint16_t tix1; } aomw_fx_span_t;
+#define AOMW_FX_MAXSPANS 8
+
+
+// Starts effect `fx` (it is copied); the next render starts a frame.
+void aomw_fx_start( const aomw_fx_t * fx );
+// Renders (part of) the frame for time `ms` into the topo framebuffer, for at most `budget_us` (0 for no limit); returns 1 when the frame is complete.
+int aomw_fx_render( uint32_t ms, uint32_t budget_us );
+// Returns the number of dirty spans (triplets changed by render since the last flush).
+int aomw_fx_numspans();
+// Returns dirty span `six`.
+const aomw_fx_span_t * aomw_fx_span( int six );
+// Sends the changed triplets (topo framebuffer flush) and clears the dirty spans.
+aoresult_t aomw_fx_flush();
+
+
+#endif
+
+
+
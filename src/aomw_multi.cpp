@@ -0,0 +1,441 @@
+// aomw_multi.cpp - coordinator that builds and flushes several OSP chains interleaved or in parallel
+/*****************************************************************************
+ * Copyright 2024 by ams OSRAM AG                                            *
+ * All rights are reserved.                                                  *
+ *                                                                           *
+ * IMPORTANT - PLEASE READ CAREFULLY BEFORE COPYING, INSTALLING OR USING     *
+ * THE SOFTWARE.                                                             *
+ *                                                                           *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS       *
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT         *
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS         *
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT  *
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,     *
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT          *
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,     *
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY     *
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT       *
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE     *
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.      *
+ *****************************************************************************/
+#include <Arduino.h>     // micros()
+#include <aomw_topo.h>   // aomw_topo_build_step_ctx()
+#include <aomw_trace.h>  // AOMW_TRACE_ENABLED
+#include <aomw_multi.h>  // own
+#if AOMW_MULTI_PARALLEL && defined(ESP32)
+#include <freertos/FreeRTOS.h> // xTaskCreatePinnedToCore()
+#include <freertos/task.h>
+#include <freertos/semphr.h>   // xSemaphoreCreateCounting()
+#elif AOMW_MULTI_PARALLEL
+#include <pthread.h>           // pthread_create()
+#endif
+
+
+// An installation may consist of several independent OSP chains, each with
+// its own topo context (aomw_topo_ctx_t). Building or flushing them one 
+// after the other makes a chain wait for all chains before it. This 
+// coordinator interleaves them: a build does one step per chain in turn 
+// (a step is about one telegram), and a flush sends a slice of 
+// AOMW_MULTI_SLICE triplets per chain in turn. So all chains progress 
+// together, and a failing chain does not stop the others.
+//
+// Before the coordinator works on a chain, it calls the select function of
+// that chain, which routes the telegrams to the chain (e.g. by switching
+// a chip select or a mux in front of the SPI port). Note that aospi drives
+// one SPI port and blocks until a telegram is sent, so interleaved 
+// telegrams are not sent in parallel; the wall time is the sum of the 
+// chains. Chains that share one bus (select NULL) still benefit from the 
+// interleaving: each chain completes at about the same time.
+//
+// In parallel mode, a build or flush runs every chain in a thread of its 
+// own: a FreeRTOS task on ESP32 (chain `cix` on core cix%cores) or a 
+// pthread on Linux (e.g. a host build with mocked transports). The select
+// function is then called in the thread of the chain, and must bind that 
+// thread to a transport of its own (e.g. an SPI host per chain, or a 
+// thread local mock), so that the chains send at the same time; the wall 
+// time then approaches that of the slowest chain. The topo contexts are 
+// independent, but the trace ring has a single producer, so parallel mode
+// requires tracing to be disabled. The step-wise build is always 
+// interleaved.
+
+
+#define AOMW_MULTI_JOB_BUILD 0 // The worker of a chain builds it
+#define AOMW_MULTI_JOB_FLUSH 1 // The worker of a chain flushes its framebuffer
+
+
+typedef struct aomw_multi_chain_s {
+  aomw_topo_ctx_t *   ctx;    // The topo context of the chain
+  aomw_multi_select_t select; // Routes telegrams to this chain (NULL if no routing is needed)
+  void *              arg;    // Passed to select
+  aoresult_t          result; // Result of last build or flush
+  uint32_t            us;     // Time spent in last build or flush
+  int                 job;    // The job of the worker (parallel mode), AOMW_MULTI_JOB_XXX
+} aomw_multi_chain_t;
+
+
+static aomw_multi_chain_t aomw_multi_chains[AOMW_MULTI_MAXCHAINS];
+static int                aomw_multi_numchains_;
+static int                aomw_multi_selected = -1; // The chain the telegrams are routed to (-1 for unknown)
+static uint32_t           aomw_multi_t0;            // Start time of the build
+static uint32_t           aomw_multi_wall_us_;      // Wall time of the last build or flush
+static int                aomw_multi_parallel;      // Parallel mode (a thread per chain)
+
+
+// Routes the telegrams to chain `cix` (if not already).
+static void aomw_multi_select( int cix ) {
+  if( cix==aomw_multi_selected ) return;
+  aomw_multi_chain_t * chain= &aomw_multi_chains[cix];
+  if( chain->select!=NULL ) chain->select(cix, chain->arg);
+  aomw_multi_selected= cix;
+}
+
+
+// === parallel mode ========================================================
+
+
+// Does the job of `chain` to completion: routes the telegrams, then builds or flushes the chain.
+static void aomw_multi_work( aomw_multi_chain_t * chain ) {
+  if( chain->select!=NULL ) chain->select(chain-aomw_multi_chains, chain->arg);
+  uint32_t t0= micros();
+  if( chain->job==AOMW_MULTI_JOB_BUILD ) {
+    while( !aomw_topo_build_done_ctx(chain->ctx) ) {
+      aoresult_t result= aomw_topo_build_step_ctx(chain->ctx);
+      if( result!=aoresult_ok ) chain->result= result;
+    }
+  } else {
+    chain->result= aomw_topo_fb_flush_ctx(chain->ctx);
+  }
+  chain->us= micros()-t0;
+}
+
+
+#if AOMW_MULTI_PARALLEL && defined(ESP32)
+
+static SemaphoreHandle_t aomw_multi_done; // Given by each worker when its job is done
+
+// The worker task of a chain
+static void aomw_multi_task( void * arg ) {
+  aomw_multi_work( (aomw_multi_chain_t *)arg );
+  xSemaphoreGive(aomw_multi_done);
+  vTaskDelete(NULL);
+}
+
+// Runs `job` on all chains, each in a task of its own, and waits until all are done.
+static void aomw_multi_run( int job ) {
+  if( aomw_multi_done==NULL ) aomw_multi_done= xSemaphoreCreateCounting(AOMW_MULTI_MAXCHAINS, 0);
+  int numstarted= 0;
+  for( int cix=0; cix<aomw_multi_numchains_; cix++ ) {
+    aomw_multi_chain_t * chain= &aomw_multi_chains[cix];
+    chain->job= job;
+    BaseType_t ok= aomw_multi_done!=NULL && xTaskCreatePinnedToCore(aomw_multi_task, "aomw_multi", AOMW_MULTI_STACK, chain, uxTaskPriorityGet(NULL), NULL, cix%portNUM_PROCESSORS)==pdPASS;
+    if( ok ) numstarted++; else aomw_multi_work(chain); // no task, do the job here
+  }
+  for( int i=0; i<numstarted; i++ ) xSemaphoreTake(aomw_multi_done, portMAX_DELAY);
+}
+
+#elif AOMW_MULTI_PARALLEL
+
+// The worker thread of a chain
+static void * aomw_multi_thread( void * arg ) {
+  aomw_multi_work( (aomw_multi_chain_t *)arg );
+  return NULL;
+}
+
+// Runs `job` on all chains, each in a thread of its own, and waits until all are done.
+static void aomw_multi_run( int job ) {
+  pthread_t threads[AOMW_MULTI_MAXCHAINS];
+  int       started[AOMW_MULTI_MAXCHAINS];
+  for( int cix=0; cix<aomw_multi_numchains_; cix++ ) {
+    aomw_multi_chain_t * chain= &aomw_multi_chains[cix];
+    chain->job= job;
+    started[cix]= pthread_create(&threads[cix], NULL, aomw_multi_thread, chain)==0;
+    if( !started[cix] ) aomw_multi_work(chain); // no thread, do the job here
+  }
+  for( int cix=0; cix<aomw_multi_numchains_; cix++ ) {
+    if( started[cix] ) pthread_join(threads[cix], NULL);
+  }
+}
+
+#else
+
+// Runs `job` on all chains, one after the other (no thread support).
+static void aomw_multi_run( int job ) {
+  for( int cix=0; cix<aomw_multi_numchains_; cix++ ) {
+    aomw_multi_chains[cix].job= job;
+    aomw_multi_work(&aomw_multi_chains[cix]);
+  }
+}
+
+#endif
+
+
+/*!
+    @brief  Enables or disables parallel mode.
+    @param  enable
+            When 1, aomw_multi_build() and aomw_multi_flush() run every 
+            chain in a thread of its own; when 0 they interleave the chains.
+    @return aoresult_ok      if successful
+            aoresult_other   if there is no thread support 
+                             (AOMW_MULTI_PARALLEL is 0), tracing is 
+                             enabled (the trace ring has a single producer),
+                             or a chain has no select function
+    @note   In parallel mode, the select function of a chain is called in
+            the thread of that chain; it must bind that thread to a 
+            transport (SPI port) of its own. With one shared SPI port, use
+            the interleaved mode. Therefore every chain needs a select 
+            function, and AOMW_MULTI_PARALLEL is 0 on ESP32 unless the
+            application defines it (it has per port transports).
+*/
+aoresult_t aomw_multi_parallel_set( int enable ) {
+  if( enable && (!AOMW_MULTI_PARALLEL || AOMW_TRACE_ENABLED) ) return aoresult_other;
+  for( int cix=0; enable && cix<aomw_multi_numchains_; cix++ ) 
+    if( aomw_multi_chains[cix].select==NULL ) return aoresult_other; // would share the one global port
+  aomw_multi_parallel= enable ? 1 : 0;
+  return aoresult_ok;
+}
+
+
+/*!
+    @brief  Returns if parallel mode is enabled.
+    @return 1 if enabled, 0 if the chains are interleaved.
+*/
+int aomw_multi_parallel_get() {
+  return aomw_multi_parallel;
+}
+
+
+// === chains ===============================================================
+
+
+/*!
+    @brief  Removes all chains from the coordinator.
+    @note   The topo contexts are not changed.
+*/
+void aomw_multi_clear() {
+  aomw_multi_numchains_= 0;
+  aomw_multi_selected= -1;
+}
+
+
+/*!
+    @brief  Adds a chain to the coordinator.
+    @param  ctx
+            The topo context of the chain (must stay alive).
+    @param  select
+            Function that routes the telegrams to this chain; NULL when
+            no routing is needed.
+    @param  arg
+            Passed to `select`.
+    @return The chain index, or -1 if there are already 
+            AOMW_MULTI_MAXCHAINS chains, or if `select` is NULL while
+            parallel mode is enabled.
+*/
+int aomw_multi_add( aomw_topo_ctx_t * ctx, aomw_multi_select_t select, void * arg ) {
+  AORESULT_ASSERT( ctx!=NULL );
+  if( aomw_multi_numchains_>=AOMW_MULTI_MAXCHAINS ) return -1;
+  if( aomw_multi_parallel && select==NULL ) return -1; // parallel mode needs a transport per chain
+  int cix= aomw_multi_numchains_++;
+  aomw_multi_chain_t * chain= &aomw_multi_chains[cix];
+  chain->ctx= ctx;
+  chain->select= select;
+  chain->arg= arg;
+  chain->result= aoresult_ok;
+  chain->us= 0;
+  return cix;
+}
+
+
+/*!
+    @brief  Returns the number of chains in the coordinator.
+    @return Number of chains.
+*/
+int aomw_multi_numchains() {
+  return aomw_multi_numchains_;
+}
+
+
+/*!
+    @brief  Returns the topo context of chain `cix`.
+    @param  cix
+            The chain index, 0<=cix<aomw_multi_numchains().
+    @return The topo context (as passed to aomw_multi_add).
+*/
+aomw_topo_ctx_t * aomw_multi_ctx( int cix ) {
+  AORESULT_ASSERT( 0<=cix && cix<aomw_multi_numchains_ );
+  return aomw_multi_chains[cix].ctx;
+}
+
+
+/*!
+    @brief  Starts the builds of all chains.
+    @note   Follow with aomw_multi_build_step() until aomw_multi_build_done().
+*/
+void aomw_multi_build_start() {
+  for( int cix=0; cix<aomw_multi_numchains_; cix++ ) {
+    aomw_multi_chain_t * chain= &aomw_multi_chains[cix];
+    aomw_topo_build_start_ctx(chain->ctx);
+    chain->result= aoresult_ok;
+    chain->us= 0;
+  }
+  aomw_multi_t0= micros();
+  aomw_multi_wall_us_= 0;
+}
+
+
+/*!
+    @brief  Does one build step for every chain whose build is not done.
+    @return aoresult_ok      if all steps succeeded
+            the error of the first chain that failed otherwise
+    @note   A chain that fails is done (see aomw_topo_build_step); its 
+            error is available via aomw_multi_result(). The other chains
+            continue.
+*/
+aoresult_t aomw_multi_build_step() {
+  aoresult_t first= aoresult_ok;
+  aomw_multi_selected= -1; // the application may have routed elsewhere
+  for( int cix=0; cix<aomw_multi_numchains_; cix++ ) {
+    aomw_multi_chain_t * chain= &aomw_multi_chains[cix];
+    if( aomw_topo_build_done_ctx(chain->ctx) ) continue;
+    aomw_multi_select(cix);
+    uint32_t t0= micros();
+    aoresult_t result= aomw_topo_build_step_ctx(chain->ctx);
+    chain->us+= micros()-t0;
+    if( result!=aoresult_ok ) { chain->result= result; if( first==aoresult_ok ) first= result; }
+  }
+  if( aomw_multi_build_done() ) aomw_multi_wall_us_= micros()-aomw_multi_t0;
+  return first;
+}
+
+
+/*!
+    @brief  Returns if the builds of all chains are done.
+    @return 1 if all builds are done, 0 if another step is needed.
+*/
+int aomw_multi_build_done() {
+  for( int cix=0; cix<aomw_multi_numchains_; cix++ ) {
+    if( !aomw_topo_build_done_ctx(aomw_multi_chains[cix].ctx) ) return 0;
+  }
+  return 1;
+}
+
+
+/*!
+    @brief  Builds all chains, interleaved.
+    @return aoresult_ok      if all builds succeeded
+            the error of the first chain that failed otherwise
+    @note   Blocks until all builds are done; see aomw_multi_build_start() 
+            for the step-wise variant.
+    @note   In parallel mode, each chain is built in a thread of its own;
+            the error is then that of the first chain (by index) that failed.
+*/
+aoresult_t aomw_multi_build() {
+  aoresult_t first= aoresult_ok;
+  aomw_multi_build_start();
+  if( aomw_multi_parallel ) {
+    aomw_multi_run(AOMW_MULTI_JOB_BUILD);
+    aomw_multi_selected= -1; // the workers routed
+    for( int cix=0; cix<aomw_multi_numchains_; cix++ ) {
+      if( first==aoresult_ok ) first= aomw_multi_chains[cix].result;
+    }
+    aomw_multi_wall_us_= micros()-aomw_multi_t0;
+    return first;
+  }
+  while( !aomw_multi_build_done() ) {
+    aoresult_t result= aomw_multi_build_step();
+    if( first==aoresult_ok ) first= result;
+  }
+  return first;
+}
+
+
+/*!
+    @brief  Flushes the framebuffers of all chains, interleaved.
+    @return aoresult_ok      if all flushes succeeded
+            the error of the first chain that failed otherwise
+    @note   Sends AOMW_MULTI_SLICE dirty triplets of a chain, then turns 
+            to the next chain, until no chain has dirty triplets. A chain 
+            that fails is skipped for the rest of the flush (its unsent 
+            triplets stay dirty).
+    @note   Chains in sync mode (aomw_topo_sync_set_ctx) get their sync 
+            telegram after all chains are flushed, back to back, so that 
+            the frames of all chains appear (nearly) at the same moment.
+    @note   In parallel mode, each chain is flushed entirely in a thread of
+            its own; the sync telegrams follow when all threads are done.
+*/
+aoresult_t aomw_multi_flush() {
+  aoresult_t first= aoresult_ok;
+  uint32_t t0= micros();
+  aomw_multi_selected= -1; // the application may have routed elsewhere
+  for( int cix=0; cix<aomw_multi_numchains_; cix++ ) {
+    aomw_multi_chains[cix].result= aoresult_ok;
+    aomw_multi_chains[cix].us= 0;
+  }
+  if( aomw_multi_parallel ) {
+    aomw_multi_run(AOMW_MULTI_JOB_FLUSH);
+    for( int cix=0; cix<aomw_multi_numchains_; cix++ ) {
+      if( first==aoresult_ok ) first= aomw_multi_chains[cix].result;
+    }
+  }
+  int busy= !aomw_multi_parallel;
+  while( busy ) {
+    busy= 0;
+    for( int cix=0; cix<aomw_multi_numchains_; cix++ ) {
+      aomw_multi_chain_t * chain= &aomw_multi_chains[cix];
+      if( chain->result!=aoresult_ok || aomw_topo_fb_numdirty_ctx(chain->ctx)==0 ) continue;
+      aomw_multi_select(cix);
+      uint32_t t1= micros();
+      aoresult_t result= aomw_topo_fb_flush_some_ctx(chain->ctx, AOMW_MULTI_SLICE);
+      chain->us+= micros()-t1;
+      if( result!=aoresult_ok ) { chain->result= result; if( first==aoresult_ok ) first= result; continue; }
+      busy= 1;
+    }
+  }
+  for( int cix=0; cix<aomw_multi_numchains_; cix++ ) {
+    aomw_multi_chain_t * chain= &aomw_multi_chains[cix];
+    if( chain->result!=aoresult_ok || !aomw_topo_sync_get_ctx(chain->ctx) ) continue;
+    aomw_multi_select(cix);
+    uint32_t t1= micros();
+    aoresult_t result= aomw_topo_sync_ctx(chain->ctx);
+    chain->us+= micros()-t1;
+    if( result!=aoresult_ok ) { chain->result= result; if( first==aoresult_ok ) first= result; }
+  }
+  aomw_multi_wall_us_= micros()-t0;
+  return first;
+}
+
+
+/*!
+    @brief  Returns the result of the last build or flush of chain `cix`.
+    @param  cix
+            The chain index, 0<=cix<aomw_multi_numchains().
+    @return The result.
+*/
+aoresult_t aomw_multi_result( int cix ) {
+  AORESULT_ASSERT( 0<=cix && cix<aomw_multi_numchains_ );
+  return aomw_multi_chains[cix].result;
+}
+
+
+/*!
+    @brief  Returns the time spent on chain `cix` in the last build or flush.
+    @param  cix
+            The chain index, 0<=cix<aomw_multi_numchains().
+    @return The time in micro seconds.
+    @note   Only counts the build steps (or flush slices) of this chain, 
+            compare with aomw_multi_wall_us().
+*/
+uint32_t aomw_multi_us( int cix ) {
+  AORESULT_ASSERT( 0<=cix && cix<aomw_multi_numchains_ );
+  return aomw_multi_chains[cix].us;
+}
+
+
+/*!
+    @brief  Returns the wall time of the last build or flush.
+    @return The time in micro seconds (0 while a build is not done).
+    @note   For a step-wise build, this is the time from start to done, so
+            it includes the time the application spent between steps.
+*/
+uint32_t aomw_multi_wall_us() {
+  return aomw_multi_wall_us_;
+}
@@ -0,0 +1,88 @@
+// aomw_multi.h - coordinator that builds and flushes several OSP chains interleaved or in parallel
+/*****************************************************************************
+ * Copyright 2024 by ams OSRAM AG                                            *
+ * All rights are reserved.                                                  *
+ *                                                                           *
+ * IMPORTANT - PLEASE READ CAREFULLY BEFORE COPYING, INSTALLING OR USING     *
+ * THE SOFTWARE.                                                             *
+ *                                                                           *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS       *
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT         *
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS         *
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT  *
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,     *
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT          *
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,     *
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY     *
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT       *
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE     *
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.      *
+ *****************************************************************************/
+#ifndef _AOMW_MULTI_H_
+#define _AOMW_MULTI_H_
+
+
+#include <stdint.h>     // uint32_t
+#include <aoresult.h>   // aoresult_t
+#include <aomw_topo.h>  // aomw_topo_ctx_t
+
+
+// Maximum number of chains
+#define AOMW_MULTI_MAXCHAINS 4
+// Number of triplets a flush sends for one chain before it turns to the next chain
+#define AOMW_MULTI_SLICE     8
+// Parallel mode (a thread per chain) is available on Linux (pthreads, e.g. extras/aomw_host). On ESP32 (FreeRTOS tasks, spread
+// over the cores) define it as 1 only when every chain has a transport (SPI port) of its own; the stock aospi drives one port.
+#ifndef AOMW_MULTI_PARALLEL
+#if defined(__linux__)
+#define AOMW_MULTI_PARALLEL  1
+#else
+#define AOMW_MULTI_PARALLEL  0
+#endif
+#endif
+// Stack size (bytes) of a worker task in parallel mode (ESP32)
+#define AOMW_MULTI_STACK     4096
+
+
+// Routes the telegrams (aoosp/aospi) to chain `cix` (e.g. switches a chip select or mux); `arg` as passed to aomw_multi_add().
+// In parallel mode it is called in the thread of the chain, and must bind that thread to the transport of the chain.
+typedef void (*aomw_multi_select_t)( int cix, void * arg );
+
+
+// Removes all chains.
+void aomw_multi_clear();
+// Adds the chain with topo context `ctx`; `select` (may be NULL, not in parallel mode) routes telegrams to it. Returns chain index, or -1 when full (or refused).
+int aomw_multi_add( aomw_topo_ctx_t * ctx, aomw_multi_select_t select, void * arg );
+// Returns the number of chains.
+int aomw_multi_numchains();
+// Returns the topo context of chain `cix`.
+aomw_topo_ctx_t * aomw_multi_ctx( int cix );
+
+
+// Starts the builds of all chains.
+void aomw_multi_build_start();
+// Does one build step on every chain that is not yet done; returns the first error (the other chains continue).
+aoresult_t aomw_multi_build_step();
+// Returns if the builds of all chains are done.
+int aomw_multi_build_done();
+// Builds all chains, interleaved (or in parallel); returns aoresult_ok when all builds succeed, else the first error.
+aoresult_t aomw_multi_build();
+// Flushes the framebuffers of all chains, interleaved in slices (or in parallel); returns aoresult_ok when all succeed, else the first error.
+aoresult_t aomw_multi_flush();
+
+
+// Enables (or disables) parallel mode: build and flush run each chain in its own thread. Fails without thread support, with tracing enabled, or when a chain has no select.
+aoresult_t aomw_multi_parallel_set( int enable );
+// Returns if parallel mode is enabled.
+int aomw_multi_parallel_get();
+
+
+// Returns the result of the last build or flush of chain `cix`.
+aoresult_t aomw_multi_result( int cix );
+// Returns the time (us) spent on chain `cix` in the last build or flush.
+uint32_t aomw_multi_us( int cix );
+// Returns the wall time (us) of the last build or flush (of all chains).
+uint32_t aomw_multi_wall_us();
+
+
+#endif
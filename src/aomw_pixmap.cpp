@@ -0,0 +1,333 @@
+// aomw_pixmap.cpp - spatial map of triplets (pixels) for 2D/3D effects
+/*****************************************************************************
+ * Copyright 2024 by ams OSRAM AG                                            *
+ * All rights are reserved.                                                  *
+ *                                                                           *
+ * IMPORTANT - PLEASE READ CAREFULLY BEFORE COPYING, INSTALLING OR USING     *
+ * THE SOFTWARE.                                                             *
+ *                                                                           *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS       *
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT         *
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS         *
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT  *
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,     *
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT          *
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,     *
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY     *
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT       *
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE     *
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.      *
+ *****************************************************************************/
+#include <Arduino.h>       // Serial.printf
+#include <aomw_eeprom.h>   // aomw_eeprom_read()
+#include <aomw_topo.h>     // aomw_topo_settriplet()
+#include <aomw_pixmap.h>   // own
+
+
+// The topo module addresses triplets by a linear index (tix). Panels are
+// often a 2D (or 3D) arrangement of triplets, wired in rows or snake wise.
+// This module maps each tix to a position (x,y,z) in a grid of 
+// width*height*depth cells, and has a reverse lookup table from grid cell 
+// to tix. Both lookups are O(1), and the reverse table is row major, so an
+// effect can traverse the panel in spatial order by walking the table.
+//
+// The forward table (tix to xyz) is either a caller supplied table (e.g. 
+// const, defined at compile time, in flash), or generated in RAM (matrix 
+// generator, EEPROM). The reverse table is always computed, in RAM.
+//
+// EEPROM format (all bytes):
+//
+//   offset  size  field
+//   0       1     magic 'P'
+//   1       1     version (AOMW_PIXMAP_EEPROM_VERSION)
+//   2       1     width
+//   3       1     height
+//   4       1     depth
+//   5       1     kind: 0 for explicit list, else flags (AOMW_PIXMAP_FLAGS_xxx) for a matrix (kind 0x80 is a matrix without flags)
+//   6       1     numpixels (explicit list) or tix0 (matrix)
+//   7       3*N   explicit list only: x, y, z per pixel (tix 0..numpixels-1)
+//   ..      1     checksum: all bytes (including this one) sum to 0 (mod 256)
+
+
+#define AOMW_PIXMAP_EEPROM_VERSION 1
+#define AOMW_PIXMAP_EEPROM_MATRIX  0x80 // Kind bit that marks a matrix (without it, kind 0 is the explicit list)
+
+
+static aomw_pixmap_xyz_t         aomw_pixmap_xyz_ram[AOMW_PIXMAP_MAXPIXELS];  // The forward table, when generated
+static const aomw_pixmap_xyz_t * aomw_pixmap_xyz_ = aomw_pixmap_xyz_ram;     // The forward table in use (RAM or caller's table)
+static uint16_t                  aomw_pixmap_numpixels_;                      // Number of entries in aomw_pixmap_xyz_
+static uint8_t                   aomw_pixmap_width_;                          // Grid size
+static uint8_t                   aomw_pixmap_height_;
+static uint8_t                   aomw_pixmap_depth_;
+static uint16_t                  aomw_pixmap_grid_[AOMW_PIXMAP_MAXCELLS];     // The reverse table (cell to tix)
+
+
+// Fills the reverse table from the forward table (skipping tix before tix0); fails when a position is outside the grid or used twice.
+static aoresult_t aomw_pixmap_reverse( uint16_t tix0 ) {
+  int numcells= aomw_pixmap_width_ * aomw_pixmap_height_ * aomw_pixmap_depth_;
+  for( int cix=0; cix<numcells; cix++ ) aomw_pixmap_grid_[cix]= AOMW_PIXMAP_NONE;
+  for( uint16_t tix=tix0; tix<aomw_pixmap_numpixels_; tix++ ) {
+    const aomw_pixmap_xyz_t * xyz= &aomw_pixmap_xyz_[tix];
+    if( xyz->x>=aomw_pixmap_width_ || xyz->y>=aomw_pixmap_height_ || xyz->z>=aomw_pixmap_depth_ ) return aoresult_other;
+    int cix= (xyz->z*aomw_pixmap_height_ + xyz->y)*aomw_pixmap_width_ + xyz->x;
+    if( aomw_pixmap_grid_[cix]!=AOMW_PIXMAP_NONE ) return aoresult_other;
+    aomw_pixmap_grid_[cix]= tix;
+  }
+  return aoresult_ok;
+}
+
+
+// Empties the map (e.g. after a failed install).
+static void aomw_pixmap_clear() {
+  aomw_pixmap_xyz_= aomw_pixmap_xyz_ram;
+  aomw_pixmap_numpixels_= 0;
+  aomw_pixmap_width_= 0;
+  aomw_pixmap_height_= 0;
+  aomw_pixmap_depth_= 0;
+}
+
+
+// Checks the grid size and sets it.
+static aoresult_t aomw_pixmap_setsize( uint8_t width, uint8_t height, uint8_t depth ) {
+  if( width==0 || height==0 || depth==0 ) return aoresult_other;
+  if( width*height*depth > AOMW_PIXMAP_MAXCELLS ) return aoresult_outofmem;
+  aomw_pixmap_width_= width;
+  aomw_pixmap_height_= height;
+  aomw_pixmap_depth_= depth;
+  return aoresult_ok;
+}
+
+
+/*!
+    @brief  Installs a map where triplet tix is at position xyz[tix], and 
+            computes the reverse lookup table.
+    @param  xyz
+            The positions, one per triplet; the table is not copied, so it 
+            must be static (typically a const table, defined at compile time).
+    @param  numpixels
+            The number of entries in `xyz`.
+    @param  width
+            The size of the grid in x direction (1..255).
+    @param  height
+            The size of the grid in y direction (1..255).
+    @param  depth
+            The size of the grid in z direction (1 for a 2D grid).
+    @return aoresult_ok          if successful
+            aoresult_outofmem    if the grid has more than AOMW_PIXMAP_MAXCELLS cells
+            aoresult_other       if a position is outside the grid, or used twice
+    @note   When the install fails, the map is empty.
+    @note   The map is independent of the topo map, but for aomw_pixmap_set()
+            every tix must be less than aomw_topo_numtriplets().
+*/
+aoresult_t aomw_pixmap_install( const aomw_pixmap_xyz_t * xyz, uint16_t numpixels, uint8_t width, uint8_t height, uint8_t depth ) {
+  aomw_pixmap_clear();
+  aoresult_t result= aomw_pixmap_setsize(width,height,depth);
+  if( result!=aoresult_ok ) { aomw_pixmap_clear(); return result; }
+  aomw_pixmap_xyz_= xyz;
+  aomw_pixmap_numpixels_= numpixels;
+  result= aomw_pixmap_reverse(0);
+  if( result!=aoresult_ok ) aomw_pixmap_clear();
+  return result;
+}
+
+
+/*!
+    @brief  Generates (in RAM) the map of a rectangular matrix of 
+            `width` x `height` triplets.
+    @param  width
+            The number of triplets in a row.
+    @param  height
+            The number of rows.
+    @param  tix0
+            The tix of the first triplet of the matrix (e.g. to skip the 
+            triplets on the MCU board); triplets before it are in no cell.
+    @param  flags
+            Combination of AOMW_PIXMAP_FLAGS_xxx: SERPENTINE (every other 
+            row runs in the other direction), COLUMNS (the triplets run in 
+            columns), FLIPX (first triplet is right), FLIPY (first triplet
+            is at the bottom).
+    @return aoresult_ok          if successful
+            aoresult_outofmem    if the matrix has too many triplets or cells
+    @note   Triplets before tix0 get position (0,0,0) in the forward table,
+            but are not in the reverse table; check with aomw_pixmap_tix().
+*/
+aoresult_t aomw_pixmap_matrix( uint8_t width, uint8_t height, uint16_t tix0, int flags ) {
+  aomw_pixmap_clear();
+  aoresult_t result= aomw_pixmap_setsize(width,height,1);
+  if( result!=aoresult_ok ) { aomw_pixmap_clear(); return result; }
+  if( tix0+width*height > AOMW_PIXMAP_MAXPIXELS ) { aomw_pixmap_clear(); return aoresult_outofmem; }
+  // Lines are rows (or columns); a line has `linelen` triplets
+  int numlines= flags & AOMW_PIXMAP_FLAGS_COLUMNS ? width : height;
+  int linelen = flags & AOMW_PIXMAP_FLAGS_COLUMNS ? height : width;
+  for( uint16_t tix=0; tix<tix0; tix++ ) aomw_pixmap_xyz_ram[tix]= {0,0,0};
+  for( int line=0; line<numlines; line++ ) {
+    for( int pos=0; pos<linelen; pos++ ) {
+      int along= (flags & AOMW_PIXMAP_FLAGS_SERPENTINE) && (line%2==1) ? linelen-1-pos : pos;
+      int x= flags & AOMW_PIXMAP_FLAGS_COLUMNS ? line : along;
+      int y= flags & AOMW_PIXMAP_FLAGS_COLUMNS ? along : line;
+      if( flags & AOMW_PIXMAP_FLAGS_FLIPX ) x= width-1-x;
+      if( flags & AOMW_PIXMAP_FLAGS_FLIPY ) y= height-1-y;
+      aomw_pixmap_xyz_t * xyz= &aomw_pixmap_xyz_ram[tix0 + line*linelen + pos];
+      xyz->x= x;
+      xyz->y= y;
+      xyz->z= 0;
+    }
+  }
+  aomw_pixmap_numpixels_= tix0 + width*height;
+  result= aomw_pixmap_reverse(tix0);
+  if( result!=aoresult_ok ) aomw_pixmap_clear();
+  return result;
+}
+
+
+/*!
+    @brief  Loads the map from an EEPROM connected to an I2C bridge.
+    @param  addr
+            The address of the OSP node with the I2C bridge.
+    @param  daddr7
+            The 7-bit I2C device address of the EEPROM.
+    @param  raddr
+            The (register) address in the EEPROM where the map starts.
+    @return aoresult_ok          if successful
+            aoresult_other       if the EEPROM content is not a (valid) map
+            aoresult_outofmem    if the map is too large, or does not end
+                                 below EEPROM address 256
+            other error code if there is a (communications) error
+    @note   See the top of this file for the EEPROM format.
+    @note   EEPROM addresses are 8 bit, so an explicit list from `raddr` 0
+            has at most 82 pixels.
+    @note   When the load fails, the map is empty.
+*/
+aoresult_t aomw_pixmap_eeprom_load( uint16_t addr, uint8_t daddr7, uint8_t raddr ) {
+  aomw_pixmap_clear();
+  // Header
+  uint8_t hdr[7];
+  if( raddr + sizeof hdr + 1 > 256 ) return aoresult_outofmem; // EEPROM addresses are 8 bit
+  aoresult_t result= aomw_eeprom_read(addr, daddr7, raddr, hdr, sizeof hdr);
+  if( result!=aoresult_ok ) return result;
+  if( hdr[0]!='P' || hdr[1]!=AOMW_PIXMAP_EEPROM_VERSION ) return aoresult_other;
+  uint8_t sum= 0;
+  for( int i=0; i<(int)sizeof hdr; i++ ) sum+= hdr[i];
+  // Explicit list (read into RAM forward table)
+  int numpixels= 0;
+  if( !(hdr[5] & AOMW_PIXMAP_EEPROM_MATRIX) ) {
+    numpixels= hdr[6];
+    if( numpixels>AOMW_PIXMAP_MAXPIXELS ) return aoresult_outofmem;
+    if( raddr + sizeof hdr + 3*numpixels + 1 > 256 ) return aoresult_outofmem; // EEPROM addresses are 8 bit
+    result= aomw_eeprom_read(addr, daddr7, raddr+sizeof hdr, (uint8_t*)aomw_pixmap_xyz_ram, 3*numpixels);
+    if( result!=aoresult_ok ) return result;
+    for( int i=0; i<3*numpixels; i++ ) sum+= ((uint8_t*)aomw_pixmap_xyz_ram)[i];
+  }
+  // Checksum
+  uint8_t check;
+  result= aomw_eeprom_read(addr, daddr7, raddr+sizeof hdr+3*numpixels, &check, 1);
+  if( result!=aoresult_ok ) return result;
+  if( (uint8_t)(sum+check)!=0 ) return aoresult_other;
+  // Install
+  if( hdr[5] & AOMW_PIXMAP_EEPROM_MATRIX ) {
+    if( hdr[4]!=1 ) return aoresult_other;
+    return aomw_pixmap_matrix(hdr[2], hdr[3], hdr[6], hdr[5] & ~AOMW_PIXMAP_EEPROM_MATRIX);
+  }
+  return aomw_pixmap_install(aomw_pixmap_xyz_ram, numpixels, hdr[2], hdr[3], hdr[4]);
+}
+
+
+/*!
+    @brief  Returns the width of the grid (size in x direction).
+    @return The width.
+*/
+uint8_t aomw_pixmap_width() {
+  return aomw_pixmap_width_;
+}
+
+
+/*!
+    @brief  Returns the height of the grid (size in y direction).
+    @return The height.
+*/
+uint8_t aomw_pixmap_height() {
+  return aomw_pixmap_height_;
+}
+
+
+/*!
+    @brief  Returns the depth of the grid (size in z direction).
+    @return The depth; 1 for a 2D grid.
+*/
+uint8_t aomw_pixmap_depth() {
+  return aomw_pixmap_depth_;
+}
+
+
+/*!
+    @brief  Returns the number of triplets in the map.
+    @return The number of triplets, they have tix 0..aomw_pixmap_numpixels()-1.
+*/
+uint16_t aomw_pixmap_numpixels() {
+  return aomw_pixmap_numpixels_;
+}
+
+
+/*!
+    @brief  Returns the position of triplet `tix`.
+    @param  tix
+            The index of the triplet, 0 <= tix < aomw_pixmap_numpixels().
+    @return The position (x,y,z) in the grid.
+    @note   O(1), a table lookup.
+*/
+const aomw_pixmap_xyz_t * aomw_pixmap_xyz( uint16_t tix ) {
+  AORESULT_ASSERT( tix<aomw_pixmap_numpixels_ );
+  return &aomw_pixmap_xyz_[tix];
+}
+
+
+/*!
+    @brief  Returns the triplet at a position in the grid.
+    @param  x
+            The x coordinate (column).
+    @param  y
+            The y coordinate (row).
+    @param  z
+            The z coordinate (layer), default 0.
+    @return The tix of the triplet at (x,y,z), or AOMW_PIXMAP_NONE when 
+            the position is outside the grid or the cell has no triplet.
+    @note   O(1), a table lookup.
+*/
+uint16_t aomw_pixmap_tix( int x, int y, int z ) {
+  if( x<0 || x>=aomw_pixmap_width_ || y<0 || y>=aomw_pixmap_height_ || z<0 || z>=aomw_pixmap_depth_ ) return AOMW_PIXMAP_NONE;
+  return aomw_pixmap_grid_[(z*aomw_pixmap_height_ + y)*aomw_pixmap_width_ + x];
+}
+
+
+/*!
+    @brief  Returns the reverse lookup table.
+    @return The table; the tix of cell (x,y,z) is at index 
+            (z*height+y)*width+x, cells without triplet have 
+            AOMW_PIXMAP_NONE.
+    @note   The table is row major, so walking it visits the triplets in
+            spatial order (without index computations per pixel).
+*/
+const uint16_t * aomw_pixmap_grid() {
+  return aomw_pixmap_grid_;
+}
+
+
+/*!
+    @brief  Sets the triplet at a position in the grid to `rgb`.
+    @param  x
+            The x coordinate (column).
+    @param  y
+            The y coordinate (row).
+    @param  z
+            The z coordinate (layer), 0 for a 2D grid.
+    @param  rgb
+            A topo color.
+    @return aoresult_ok      if successful (also when there is no triplet at x,y,z)
+            other error code if there is a (communications) error
+    @note   Uses aomw_topo_settriplet(), so the topo dim level applies.
+*/
+aoresult_t aomw_pixmap_set( int x, int y, int z, const aomw_topo_rgb_t * rgb ) {
+  uint16_t tix= aomw_pixmap_tix(x,y,z);
+  if( tix==AOMW_PIXMAP_NONE ) return aoresult_ok;
+  return aomw_topo_settriplet(tix,rgb);
+}
@@ -0,0 +1,75 @@
+// aomw_pixmap.h - spatial map of triplets (pixels) for 2D/3D effects
+/*****************************************************************************
+ * Copyright 2024 by ams OSRAM AG                                            *
+ * All rights are reserved.                                                  *
+ *                                                                           *
+ * IMPORTANT - PLEASE READ CAREFULLY BEFORE COPYING, INSTALLING OR USING     *
+ * THE SOFTWARE.                                                             *
+ *                                                                           *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS       *
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT         *
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS         *
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT  *
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,     *
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT          *
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,     *
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY     *
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT       *
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE     *
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.      *
+ *****************************************************************************/
+#ifndef _AOMW_PIXMAP_H_
+#define _AOMW_PIXMAP_H_
+
+
+#include <stdint.h>     // uint16_t
+#include <aoresult.h>   // aoresult_t
+#include <aomw_topo.h>  // aomw_topo_rgb_t
+
+
+#define AOMW_PIXMAP_MAXPIXELS  200    // Max number of pixels (triplets) in the map
+#define AOMW_PIXMAP_MAXCELLS   512    // Max number of grid cells (width*height*depth) in the reverse lookup table
+#define AOMW_PIXMAP_NONE       0xFFFF // "tix" of a grid cell without pixel
+
+
+// The position of a pixel (triplet) in the grid
+typedef struct aomw_pixmap_xyz_s { uint8_t x; uint8_t y; uint8_t z; } aomw_pixmap_xyz_t;
+
+
+// Flags for aomw_pixmap_matrix()
+#define AOMW_PIXMAP_FLAGS_SERPENTINE 0x01 // Every other row (column) runs in reverse direction
+#define AOMW_PIXMAP_FLAGS_COLUMNS    0x02 // Pixels run in columns (instead of rows)
+#define AOMW_PIXMAP_FLAGS_FLIPX      0x04 // First pixel is at the right
+#define AOMW_PIXMAP_FLAGS_FLIPY      0x08 // First pixel is at the bottom
+
+
+// Installs a map where triplet tix is at xyz[tix] (table is not copied, so it can be a const table in flash); builds reverse lookup.
+aoresult_t aomw_pixmap_install( const aomw_pixmap_xyz_t * xyz, uint16_t numpixels, uint8_t width, uint8_t height, uint8_t depth );
+// Generates (in RAM) the map of a `width` x `height` matrix, first pixel is tix `tix0`; flags AOMW_PIXMAP_FLAGS_xxx.
+aoresult_t aomw_pixmap_matrix( uint8_t width, uint8_t height, uint16_t tix0, int flags );
+// Loads the map from an EEPROM (see aomw_pixmap.cpp for the format) into RAM.
+aoresult_t aomw_pixmap_eeprom_load( uint16_t addr, uint8_t daddr7, uint8_t raddr );
+
+
+// Returns the width of the grid.
+uint8_t aomw_pixmap_width();
+// Returns the height of the grid.
+uint8_t aomw_pixmap_height();
+// Returns the depth of the grid (1 for a 2D grid).
+uint8_t aomw_pixmap_depth();
+// Returns the number of triplets in the map; they have tix 0..aomw_pixmap_numpixels()-1.
+uint16_t aomw_pixmap_numpixels();
+// Returns the position of triplet `tix`; O(1).
+const aomw_pixmap_xyz_t * aomw_pixmap_xyz( uint16_t tix );
+// Returns the triplet at position (x,y,z), or AOMW_PIXMAP_NONE; O(1).
+uint16_t aomw_pixmap_tix( int x, int y, int z=0 );
+// Returns the reverse lookup table: tix of cell (x,y,z) is at index (z*height+y)*width+x; row major, for traversal in spatial order.
+const uint16_t * aomw_pixmap_grid();
+// Sets the triplet at position (x,y,z) to `rgb` (does nothing for cells without pixel).
+aoresult_t aomw_pixmap_set( int x, int y, int z, const aomw_topo_rgb_t * rgb );
+
+
+#endif
+
+
+
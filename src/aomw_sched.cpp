@@ -0,0 +1,378 @@
+// aomw_sched.cpp - cooperative scheduler for periodic and background tasks
+/*****************************************************************************
+ * Copyright 2024 by ams OSRAM AG                                            *
+ * All rights are reserved.                                                  *
+ *                                                                           *
+ * IMPORTANT - PLEASE READ CAREFULLY BEFORE COPYING, INSTALLING OR USING     *
+ * THE SOFTWARE.                                                             *
+ *                                                                           *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS       *
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT         *
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS         *
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT  *
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,     *
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT          *
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,     *
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY     *
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT       *
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE     *
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.      *
+ *****************************************************************************/
+#include <Arduino.h>      // micros()
+#include <stdint.h>       // intptr_t
+#include <aomw_topo.h>    // aomw_topo_build_step()
+#include <aomw_tscript.h> // aomw_tscript_playframe()
+#include <aomw_flag.h>    // aomw_flag_transition_step()
+#include <aomw_fx.h>      // aomw_fx_render()
+#include <aomw_sched.h>   // own
+
+
+// The modules in this library that need time (topo build, tscript, flag 
+// transitions) offer start/step/done or frame functions; each call does a
+// small amount of work. This scheduler interleaves such steps. 
+//
+// A _periodic_ task (period>0) is released every period; it should finish 
+// within its deadline (relative to the release, 0 means "one period"). 
+// From all released tasks the one with the highest priority runs first 
+// (equal priorities: earliest deadline first).
+//
+// A _background_ task (period 0) runs whenever no periodic task is 
+// released, but only if its worst observed run time fits before the next
+// release of any periodic task. So a long step (e.g. an EEPROM access or 
+// a build step) does not delay a frame. Background tasks with the same 
+// priority take turns. A background task that never fits (its longest 
+// run exceeds every gap between releases) would starve; after waiting 
+// AOMW_SCHED_MAXWAIT_US it runs anyway, at the first moment no periodic 
+// task is released (which may delay a frame).
+//
+// The scheduler is cooperative: a task is never preempted. The accounting
+// (runs, total and max run time, deadline misses) helps sizing periods.
+
+
+typedef struct aomw_sched_task_s {
+  const char *      name;        // For dump
+  aomw_sched_func_t func;        // The work
+  void *            arg;         // Passed to func
+  uint32_t          period_us;   // 0 for background tasks
+  uint32_t          deadline_us; // Relative to release
+  int               prio;        // Higher runs first
+  int               enabled;     // Disabled tasks are not run
+  int               waiting;     // Background: the task was passed over since wait_us, because it did not fit
+  uint32_t          wait_us;     // Background: time the task was first passed over (valid when waiting)
+  uint32_t          release_us;  // Time of next release (periodic tasks)
+  // accounting
+  uint32_t          runs;        // Number of runs
+  uint32_t          misses;      // Number of runs that finished after the deadline (or skipped releases)
+  uint32_t          total_us;    // Total run time
+  uint32_t          max_us;      // Longest run time
+  uint32_t          ewma_us;     // Moving average of the run time (weight 1/8 for a new run)
+  aoresult_t        result;      // Result of last run
+  // auto period (see aomw_sched_autoperiod)
+  int               auto_util;   // Target utilization in percent; 0 when the period is fixed
+  int               auto_numtriplets; // Triplets per frame to provision for (0: measured run time only)
+  uint32_t          auto_min_us; // Lower bound for the period
+  uint32_t          auto_max_us; // Upper bound for the period
+} aomw_sched_task_t;
+
+
+static aomw_sched_task_t aomw_sched_tasks[AOMW_SCHED_MAXTASKS];
+static int               aomw_sched_numtasks;
+static int               aomw_sched_current_ = -1; // The task that is running
+static int               aomw_sched_lastbg = -1;   // The background task that ran last (for taking turns)
+
+
+/*!
+    @brief  Adds a task to the scheduler.
+    @param  name
+            Name of the task (for aomw_sched_dump); not copied.
+    @param  func
+            The function that does one step of work.
+    @param  arg
+            Passed to `func`.
+    @param  period_us
+            The period in micro seconds; 0 for a background task.
+    @param  deadline_us
+            For periodic tasks, the time (relative to the release) by which
+            the task must be finished; 0 means one period.
+    @param  prio
+            Priority, higher runs first.
+    @return The task id (to enable/disable), or -1 if there are already
+            AOMW_SCHED_MAXTASKS tasks.
+    @note   The task is enabled; a periodic task is released immediately.
+*/
+int aomw_sched_add( const char * name, aomw_sched_func_t func, void * arg, uint32_t period_us, uint32_t deadline_us, int prio ) {
+  if( aomw_sched_numtasks>=AOMW_SCHED_MAXTASKS ) return -1;
+  int tid= aomw_sched_numtasks++;
+  aomw_sched_task_t * task= &aomw_sched_tasks[tid];
+  task->name= name;
+  task->func= func;
+  task->arg= arg;
+  task->period_us= period_us;
+  task->deadline_us= deadline_us==0 ? period_us : deadline_us;
+  task->prio= prio;
+  task->runs= 0;
+  task->misses= 0;
+  task->total_us= 0;
+  task->max_us= 0;
+  task->ewma_us= 0;
+  task->result= aoresult_ok;
+  task->auto_util= 0;
+  task->enabled= 0;
+  task->waiting= 0;
+  aomw_sched_enable(tid,1);
+  return tid;
+}
+
+
+/*!
+    @brief  Enables or disables a task.
+    @param  tid
+            The task id (as returned by aomw_sched_add).
+    @param  enable
+            1 to enable, 0 to disable.
+    @note   When a periodic task gets enabled, it is released immediately.
+*/
+void aomw_sched_enable( int tid, int enable ) {
+  AORESULT_ASSERT( 0<=tid && tid<aomw_sched_numtasks );
+  aomw_sched_task_t * task= &aomw_sched_tasks[tid];
+  if( enable && !task->enabled ) { task->release_us= micros(); task->waiting= 0; }
+  task->enabled= enable;
+}
+
+
+/*!
+    @brief  Returns the id of the task that is running.
+    @return Task id, or -1 when called outside a task.
+    @note   Allows a task to disable itself: 
+            aomw_sched_enable(aomw_sched_current(),0).
+*/
+int aomw_sched_current() {
+  return aomw_sched_current_;
+}
+
+
+// Sets the period (and deadline) of an auto period task from its measured run time and the predicted telegram cost.
+static void aomw_sched_autoperiod_update( aomw_sched_task_t * task ) {
+  uint32_t need_us= task->ewma_us;
+  if( task->auto_numtriplets>0 ) {
+    uint32_t predict_us= aomw_topo_predict_us(task->auto_numtriplets);
+    if( predict_us>need_us ) need_us= predict_us;
+  }
+  uint32_t period_us= (uint64_t)need_us * 100 / task->auto_util;
+  if( period_us<task->auto_min_us ) period_us= task->auto_min_us;
+  if( period_us>task->auto_max_us ) period_us= task->auto_max_us;
+  // Next release moves with the period (the current one is already scheduled)
+  task->release_us+= period_us - task->period_us;
+  task->period_us= period_us;
+  task->deadline_us= period_us;
+}
+
+
+/*!
+    @brief  Lets the scheduler choose the period of a periodic task: the 
+            highest rate that the task (and the chain) sustains.
+    @param  tid
+            The task id (as returned by aomw_sched_add), a periodic task.
+    @param  numtriplets
+            The number of triplets a frame of the task sends (at most), to
+            provision for with the telegram cost measured by topo (see 
+            aomw_topo_predict_us); 0 to only use the measured run time.
+    @param  util
+            The target utilization in percent (1..100): the period is the
+            expected run time * 100 / util. 0 switches auto period off 
+            (the period stays at its last value).
+    @param  min_us
+            The shortest period (highest frame rate) allowed.
+    @param  max_us
+            The longest period allowed.
+    @note   After every run, the period is recomputed from a moving 
+            average of the task's run time, and - when numtriplets>0 - 
+            at least the predicted time to send that many triplets. So 
+            on a long chain the rate goes down before frames overrun, and 
+            on a short chain it goes up to min_us. The deadline is one 
+            period.
+*/
+void aomw_sched_autoperiod( int tid, int numtriplets, int util, uint32_t min_us, uint32_t max_us ) {
+  AORESULT_ASSERT( 0<=tid && tid<aomw_sched_numtasks );
+  AORESULT_ASSERT( 0<=util && util<=100 && 0<min_us && min_us<=max_us );
+  aomw_sched_task_t * task= &aomw_sched_tasks[tid];
+  AORESULT_ASSERT( task->period_us>0 );
+  task->auto_util= util;
+  task->auto_numtriplets= numtriplets;
+  task->auto_min_us= min_us;
+  task->auto_max_us= max_us;
+  if( util>0 ) aomw_sched_autoperiod_update(task);
+}
+
+
+// Runs task `tid` and does the accounting; `release_us` is the release time (periodic tasks).
+static aoresult_t aomw_sched_run( int tid, uint32_t release_us ) {
+  aomw_sched_task_t * task= &aomw_sched_tasks[tid];
+  aomw_sched_current_= tid;
+  uint32_t t0= micros();
+  aoresult_t result= task->func(task->arg);
+  uint32_t t1= micros();
+  aomw_sched_current_= -1;
+  task->waiting= 0;
+  uint32_t us= t1-t0;
+  task->runs++;
+  task->total_us+= us;
+  if( us>task->max_us ) task->max_us= us;
+  task->ewma_us= task->ewma_us==0 ? us : task->ewma_us + ((int32_t)(us-task->ewma_us) >> 3);
+  task->result= result;
+  if( task->period_us>0 && t1-release_us>task->deadline_us ) task->misses++;
+  if( task->auto_util>0 ) aomw_sched_autoperiod_update(task);
+  return result;
+}
+
+
+/*!
+    @brief  Runs at most one task.
+    @return The result of the task that ran, or aoresult_ok if none ran.
+    @note   Call this continuously, e.g. from loop().
+    @note   From the periodic tasks that are released, the one with the 
+            highest priority runs (equal priorities: earliest deadline).
+            When a task fell behind more than a period, the missed 
+            releases are skipped (and counted as misses).
+    @note   When no periodic task is released, a background task runs, 
+            but only if its longest run so far fits before the next 
+            release, or if it waited for that AOMW_SCHED_MAXWAIT_US.
+*/
+aoresult_t aomw_sched_step() {
+  uint32_t now= micros();
+  // Find most urgent released periodic task, and the time till the first next release
+  int      best= -1;
+  uint32_t slack= UINT32_MAX;
+  for( int tid=0; tid<aomw_sched_numtasks; tid++ ) {
+    aomw_sched_task_t * task= &aomw_sched_tasks[tid];
+    if( !task->enabled || task->period_us==0 ) continue;
+    int32_t until= (int32_t)(task->release_us-now); // wrap-around safe
+    if( until>0 ) { if( (uint32_t)until<slack ) slack= until; continue; }
+    if( best<0 ) { best= tid; continue; }
+    aomw_sched_task_t * cur= &aomw_sched_tasks[best];
+    if( task->prio>cur->prio ) { best= tid; continue; }
+    if( task->prio==cur->prio && (int32_t)(task->release_us+task->deadline_us - (cur->release_us+cur->deadline_us))<0 ) best= tid;
+  }
+  if( best>=0 ) {
+    aomw_sched_task_t * task= &aomw_sched_tasks[best];
+    uint32_t release_us= task->release_us;
+    task->release_us+= task->period_us;
+    while( (int32_t)(task->release_us-now)<=0 ) { task->release_us+= task->period_us; task->misses++; } // skip missed releases
+    return aomw_sched_run(best, release_us);
+  }
+  // Find a background task that fits in the slack (highest priority, take turns)
+  for( int i=1; i<=aomw_sched_numtasks; i++ ) {
+    int tid= (aomw_sched_lastbg+i) % aomw_sched_numtasks;
+    aomw_sched_task_t * task= &aomw_sched_tasks[tid];
+    if( !task->enabled || task->period_us>0 ) continue;
+    if( task->max_us>=slack ) { // does not fit before the next release
+      if( !task->waiting ) { task->waiting= 1; task->wait_us= now; }
+      if( now-task->wait_us<AOMW_SCHED_MAXWAIT_US ) continue; // after waiting that long it runs anyway
+    }
+    if( best<0 || task->prio>aomw_sched_tasks[best].prio ) best= tid;
+  }
+  if( best>=0 ) {
+    aomw_sched_lastbg= best;
+    return aomw_sched_run(best, now);
+  }
+  return aoresult_ok;
+}
+
+
+/*!
+    @brief  Resets the run-time accounting (runs, misses, run times) of all tasks.
+*/
+void aomw_sched_stats_reset() {
+  for( int tid=0; tid<aomw_sched_numtasks; tid++ ) {
+    aomw_sched_task_t * task= &aomw_sched_tasks[tid];
+    task->runs= 0;
+    task->misses= 0;
+    task->total_us= 0;
+    task->max_us= 0;
+    task->ewma_us= 0;
+  }
+}
+
+
+/*!
+    @brief  Prints on Serial the run-time accounting of all tasks.
+    @note   One line per task: id, name, enabled, priority, period 
+            (marked auto, see aomw_sched_autoperiod) and deadline (or "bg"), runs, deadline misses, average and max 
+            run time, and result of last run.
+*/
+void aomw_sched_dump() {
+  for( int tid=0; tid<aomw_sched_numtasks; tid++ ) {
+    aomw_sched_task_t * task= &aomw_sched_tasks[tid];
+    Serial.printf("task %d %-10s %s prio %d ", tid, task->name, task->enabled?"on ":"off", task->prio );
+    if( task->period_us==0 ) Serial.printf("bg ");
+    else Serial.printf("period %luus%s deadline %luus ", (unsigned long)task->period_us, task->auto_util>0?" (auto)":"", (unsigned long)task->deadline_us );
+    uint32_t avg= task->runs==0 ? 0 : task->total_us/task->runs;
+    Serial.printf("runs %lu misses %lu avg %luus max %luus (%s)\n", (unsigned long)task->runs, (unsigned long)task->misses, (unsigned long)avg, (unsigned long)task->max_us, aoresult_to_str(task->result) );
+  }
+}
+
+
+// === adapters ===============================================================
+
+
+/*!
+    @brief  Adapter, background task that steps the topo build.
+    @param  arg
+            Not used.
+    @return The result of aomw_topo_build_step().
+    @note   aomw_topo_build_start() must have been called. When the build
+            is done, the task disables itself. Typically the application
+            enables the frame tasks at that moment.
+*/
+aoresult_t aomw_sched_task_topobuild( void * arg ) {
+  (void)arg;
+  aoresult_t result= aomw_topo_build_step();
+  if( aomw_topo_build_done() ) aomw_sched_enable(aomw_sched_current(),0);
+  return result;
+}
+
+
+/*!
+    @brief  Adapter, periodic task that plays one tscript frame.
+    @param  arg
+            Not used.
+    @return The result of aomw_tscript_playframe().
+    @note   A script must have been installed with aomw_tscript_install().
+*/
+aoresult_t aomw_sched_task_tscript( void * arg ) {
+  (void)arg;
+  return aomw_tscript_playframe();
+}
+
+
+/*!
+    @brief  Adapter, periodic task that steps a flag transition.
+    @param  arg
+            The telegram budget per step, cast to (void*)(intptr_t); 
+            0 for unlimited.
+    @return The result of aomw_flag_transition_step().
+    @note   Does nothing when there is no transition in progress; start one
+            with aomw_flag_transition_start().
+*/
+aoresult_t aomw_sched_task_flagtransition( void * arg ) {
+  int budget= (int)(intptr_t)arg;
+  if( aomw_flag_transition_done() ) return aoresult_ok;
+  return aomw_flag_transition_step( budget==0 ? INT16_MAX : budget );
+}
+
+
+/*!
+    @brief  Adapter, periodic task that renders an effect and flushes it.
+    @param  arg
+            The render time budget in micro seconds, cast to 
+            (void*)(intptr_t); 0 for unlimited.
+    @return The result of aomw_fx_flush() (aoresult_ok when the frame is 
+            not yet complete).
+    @note   An effect must have been started with aomw_fx_start(). When 
+            the budget runs out, the frame is continued in the next period.
+*/
+aoresult_t aomw_sched_task_fx( void * arg ) {
+  uint32_t budget_us= (uint32_t)(intptr_t)arg;
+  if( !aomw_fx_render(millis(),budget_us) ) return aoresult_ok;
+  return aomw_fx_flush();
+}
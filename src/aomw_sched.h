@@ -0,0 +1,68 @@
+// aomw_sched.h - cooperative scheduler for periodic and background tasks
+/*****************************************************************************
+ * Copyright 2024 by ams OSRAM AG                                            *
+ * All rights are reserved.                                                  *
+ *                                                                           *
+ * IMPORTANT - PLEASE READ CAREFULLY BEFORE COPYING, INSTALLING OR USING     *
+ * THE SOFTWARE.                                                             *
+ *                                                                           *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS       *
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT         *
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS         *
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT  *
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,     *
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT          *
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,     *
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY     *
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT       *
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE     *
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.      *
+ *****************************************************************************/
+#ifndef _AOMW_SCHED_H_
+#define _AOMW_SCHED_H_
+
+
+#include <stdint.h>    // uint32_t
+#include <aoresult.h>  // aoresult_t
+
+
+// Maximum number of tasks
+#define AOMW_SCHED_MAXTASKS 8
+// A background task that does not fit before the next release for this long, runs anyway (so that it does not starve)
+#define AOMW_SCHED_MAXWAIT_US 100000
+
+
+// A task is a function that does a small amount of work (e.g. one step of a start/step/done state machine).
+typedef aoresult_t (*aomw_sched_func_t)( void * arg );
+
+
+// Adds a task; period 0 makes it a background task. Returns task id, or -1 when there is no slot.
+int aomw_sched_add( const char * name, aomw_sched_func_t func, void * arg, uint32_t period_us, uint32_t deadline_us, int prio );
+// Enables (or disables) task `tid`; an enabled periodic task is released immediately.
+void aomw_sched_enable( int tid, int enable );
+// Lets the scheduler pick the period of periodic task `tid` (highest sustainable rate, util percent, min_us..max_us); util 0 switches it off.
+void aomw_sched_autoperiod( int tid, int numtriplets, int util, uint32_t min_us, uint32_t max_us );
+// Returns the id of the task that is running (-1 if none); lets a task disable itself.
+int aomw_sched_current();
+// Runs at most one task: the most urgent due periodic task, else a background task if it fits before the next release.
+aoresult_t aomw_sched_step();
+// Resets the run-time accounting of all tasks.
+void aomw_sched_stats_reset();
+// Prints on Serial the run-time accounting of all tasks.
+void aomw_sched_dump();
+
+
+// Adapter: background task that steps the topo build (aomw_topo_build_start() must have been called); disables itself when done.
+aoresult_t aomw_sched_task_topobuild( void * arg );
+// Adapter: periodic task that plays one tscript frame (a script must have been installed).
+aoresult_t aomw_sched_task_tscript( void * arg );
+// Adapter: periodic task that steps a flag transition; `arg` is the telegram budget per step (cast to intptr_t, 0 for unlimited).
+aoresult_t aomw_sched_task_flagtransition( void * arg );
+// Adapter: periodic task that renders an effect (aomw_fx_start() must have been called) and flushes complete frames; `arg` is the render budget in us (cast to intptr_t, 0 for unlimited).
+aoresult_t aomw_sched_task_fx( void * arg );
+
+
+#endif
+
+
+
@@ -0,0 +1,237 @@
+// aomw_stream.cpp - binary streaming of frames from a host into the topo framebuffer
+/*****************************************************************************
+ * Copyright 2024 by ams OSRAM AG                                            *
+ * All rights are reserved.                                                  *
+ *                                                                           *
+ * IMPORTANT - PLEASE READ CAREFULLY BEFORE COPYING, INSTALLING OR USING     *
+ * THE SOFTWARE.                                                             *
+ *                                                                           *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS       *
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT         *
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS         *
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT  *
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,     *
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT          *
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,     *
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY     *
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT       *
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE     *
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.      *
+ *****************************************************************************/
+#include <Arduino.h>      // Serial, millis()
+#include <aocmd.h>        // aocmd_cint_register()
+#include <aomw_topo.h>    // aomw_topo_fb_set()
+#include <aomw_stream.h>  // own
+
+
+// Driving a show from a host with text commands ("topo pwm") costs a 
+// command line per triplet, and parsing. In streaming mode, the host sends
+// binary frames over the same serial link, and each frame goes straight 
+// into the topo framebuffer, which is then flushed (so only changed 
+// triplets are sent to the chain). The format of a frame:
+//
+//   offset  size  field
+//   0       1     sync AOMW_STREAM_SYNC (0xA5)
+//   1       1     flags AOMW_STREAM_FLAGS_XXX
+//   2       2     count N, number of colors (0 ends the stream)
+//   4       2     tix0, the (logical) triplet of the first color
+//   6       6*N   colors r, g, b (LE16 each, 0..7FFF), or
+//           3*N   colors r, g, b (8 bit each) with AOMW_STREAM_FLAGS_RGB8
+//   ..      2     CRC-16/CCITT (poly 0x1021, init 0xFFFF) over all preceding bytes
+//
+// Multi byte values are little endian. Per frame the receiver sends back 
+// one acknowledge byte (AOMW_STREAM_ACK_XXX); the host should wait for it
+// before sending the next frame, which is the flow control (the serial
+// receive buffer is small). After an error the receiver hunts for the next
+// sync byte. See extras/aomw_stream_send.py for a host side tool.
+
+
+#define AOMW_STREAM_HDRSIZE 6
+#define AOMW_STREAM_BUFSIZE (AOMW_STREAM_HDRSIZE + 6*AOMW_STREAM_MAXCOUNT + 2)
+
+
+static uint8_t  aomw_stream_buf[AOMW_STREAM_BUFSIZE]; // The frame being received
+static int      aomw_stream_pos;     // Number of bytes in aomw_stream_buf; 0 when hunting for sync
+static int      aomw_stream_len;     // Size of the frame (known once the header is received)
+static uint32_t aomw_stream_frames;  // Number of frames set
+static uint32_t aomw_stream_dropped; // Number of frames dropped
+
+
+// Returns the CRC-16/CCITT of `len` bytes at `buf`.
+static uint16_t aomw_stream_crc( const uint8_t * buf, int len ) {
+  uint16_t crc= 0xFFFF;
+  for( int i=0; i<len; i++ ) {
+    crc ^= (uint16_t)buf[i] << 8;
+    for( int b=0; b<8; b++ ) crc= crc & 0x8000 ? (crc<<1) ^ 0x1021 : crc<<1;
+  }
+  return crc;
+}
+
+
+/*!
+    @brief  Resets the receiver and its statistics.
+    @note   The receiver hunts for the next sync byte.
+*/
+void aomw_stream_reset() {
+  aomw_stream_pos= 0;
+  aomw_stream_len= 0;
+  aomw_stream_frames= 0;
+  aomw_stream_dropped= 0;
+}
+
+
+// Sets the colors of the received frame in the framebuffer, and flushes it; returns the acknowledge.
+static int aomw_stream_apply() {
+  const uint8_t * buf= aomw_stream_buf;
+  int      flags= buf[1];
+  uint16_t count= buf[2] | buf[3]<<8;
+  uint16_t tix0= buf[4] | buf[5]<<8;
+  const uint8_t * p= buf+AOMW_STREAM_HDRSIZE;
+  for( uint16_t i=0; i<count; i++ ) {
+    aomw_topo_rgb_t rgb;
+    if( flags & AOMW_STREAM_FLAGS_RGB8 ) {
+      rgb.r= p[0]<<7 | p[0]>>1;
+      rgb.g= p[1]<<7 | p[1]>>1;
+      rgb.b= p[2]<<7 | p[2]>>1;
+      p+= 3;
+    } else {
+      rgb.r= (p[0] | p[1]<<8) & AOMW_TOPO_BRIGHTNESS_MAX;
+      rgb.g= (p[2] | p[3]<<8) & AOMW_TOPO_BRIGHTNESS_MAX;
+      rgb.b= (p[4] | p[5]<<8) & AOMW_TOPO_BRIGHTNESS_MAX;
+      p+= 6;
+    }
+    aomw_topo_fb_set(tix0+i, &rgb);
+  }
+  aomw_stream_frames++;
+  if( count==0 ) return AOMW_STREAM_ACK_END;
+  if( flags & AOMW_STREAM_FLAGS_NOFLUSH ) return AOMW_STREAM_ACK_OK;
+  return aomw_topo_fb_flush()==aoresult_ok ? AOMW_STREAM_ACK_OK : AOMW_STREAM_ACK_FLUSH;
+}
+
+
+/*!
+    @brief  Feeds one received byte to the receiver.
+    @param  byte
+            The received byte.
+    @return 0 when the byte does not complete a frame, otherwise the 
+            acknowledge for the frame (AOMW_STREAM_ACK_XXX).
+    @note   A complete frame is set in the framebuffer and flushed (unless
+            it has AOMW_STREAM_FLAGS_NOFLUSH).
+    @note   A frame with a bad header (unknown flags, or triplets out of
+            range) is rejected as soon as the header is in; the receiver
+            then hunts for the next sync byte.
+*/
+int aomw_stream_feed( uint8_t byte ) {
+  if( aomw_stream_pos==0 && byte!=AOMW_STREAM_SYNC ) return 0; // hunting
+  aomw_stream_buf[aomw_stream_pos++]= byte;
+  if( aomw_stream_pos==AOMW_STREAM_HDRSIZE ) {
+    int      flags= aomw_stream_buf[1];
+    uint16_t count= aomw_stream_buf[2] | aomw_stream_buf[3]<<8;
+    uint16_t tix0= aomw_stream_buf[4] | aomw_stream_buf[5]<<8;
+    if( (flags & ~(AOMW_STREAM_FLAGS_RGB8|AOMW_STREAM_FLAGS_NOFLUSH)) || count>AOMW_STREAM_MAXCOUNT || tix0+count>aomw_topo_numtriplets() ) {
+      aomw_stream_pos= 0;
+      aomw_stream_dropped++;
+      return AOMW_STREAM_ACK_RANGE;
+    }
+    aomw_stream_len= AOMW_STREAM_HDRSIZE + count*(flags & AOMW_STREAM_FLAGS_RGB8 ? 3 : 6) + 2;
+  }
+  if( aomw_stream_pos<AOMW_STREAM_HDRSIZE || aomw_stream_pos<aomw_stream_len ) return 0;
+  // Frame complete
+  aomw_stream_pos= 0;
+  uint16_t crc= aomw_stream_buf[aomw_stream_len-2] | aomw_stream_buf[aomw_stream_len-1]<<8;
+  if( crc!=aomw_stream_crc(aomw_stream_buf,aomw_stream_len-2) ) { aomw_stream_dropped++; return AOMW_STREAM_ACK_CRC; }
+  return aomw_stream_apply();
+}
+
+
+/*!
+    @brief  Feeds all bytes available on Serial to the receiver.
+    @return 1 when the end frame was received (remaining bytes are left 
+            on Serial), 0 otherwise.
+    @note   Writes the acknowledge of every completed frame to Serial.
+*/
+int aomw_stream_poll() {
+  while( Serial.available()>0 ) {
+    int ack= aomw_stream_feed( Serial.read() );
+    if( ack==0 ) continue;
+    Serial.write( (uint8_t)ack );
+    if( ack==AOMW_STREAM_ACK_END ) return 1;
+  }
+  return 0;
+}
+
+
+/*!
+    @brief  Runs the receiver until the end frame or a time-out.
+    @param  timeout_ms
+            The receiver stops when no byte arrived for this long.
+    @return 1 when the end frame was received, 0 on time-out.
+    @note   Blocks; the Serial link is in binary mode during this call.
+*/
+int aomw_stream_run( uint32_t timeout_ms ) {
+  uint32_t last= millis();
+  while( 1 ) {
+    if( Serial.available()>0 ) {
+      if( aomw_stream_poll() ) return 1;
+      last= millis();
+    } else if( millis()-last > timeout_ms ) {
+      return 0;
+    }
+  }
+}
+
+
+/*!
+    @brief  Returns the statistics of the receiver.
+    @param  frames
+            Output: the number of frames set (since the last reset).
+    @param  dropped
+            Output: the number of frames dropped (CRC or range errors).
+*/
+void aomw_stream_stats( uint32_t * frames, uint32_t * dropped ) {
+  *frames= aomw_stream_frames;
+  *dropped= aomw_stream_dropped;
+}
+
+
+// === command handler ======================================================
+
+
+// The handler for the "stream" command
+static void aomw_stream_cmd( int argc, char * argv[] ) {
+  int timeout= 5000;
+  if( argc>2 ) { Serial.printf("ERROR: 'stream' has too many args\n" ); return; }
+  if( argc==2 ) {
+    bool ok= aocmd_cint_parse_dec(argv[1],&timeout) ;
+    if( !ok || timeout<1 || timeout>60000 ) { Serial.printf("ERROR: 'stream' expects <timeout> (1..60000), not '%s'\n",argv[1] ); return; }
+  }
+  if( aomw_topo_numtriplets()==0 ) { Serial.printf("ERROR: 'stream' needs a 'topo build' first\n" ); return; }
+  aomw_stream_reset();
+  if( argv[0][0]!='@' ) Serial.printf("stream: binary mode until end frame or %dms idle\n", timeout );
+  int end= aomw_stream_run(timeout);
+  uint32_t frames, dropped;
+  aomw_stream_stats(&frames,&dropped);
+  if( argv[0][0]!='@' ) Serial.printf("\nstream: %s, %lu frames, %lu dropped\n", end?"ended":"time-out", (unsigned long)frames, (unsigned long)dropped );
+}
+
+
+// The long help text for the "stream" command.
+static const char aomw_stream_cmd_longhelp[] = 
+  "SYNTAX: stream [ <timeout> ]\n"
+  "- switches the serial link to binary mode, for frames from a host\n"
+  "- each frame is set in the topo framebuffer, and flushed\n"
+  "- ends with an end frame, or when no byte arrives for <timeout> ms (default 5000)\n"
+  "- frame format in aomw_stream.cpp; host tool in extras/aomw_stream_send.py\n"
+  "NOTES:\n"
+  "- needs a 'topo build' first\n"
+  "- supports @-prefix to suppress output\n"
+;
+
+
+/*!
+    @brief  Registers the "stream" command with the command interpreter.
+    @return Number of remaining registration slots (or -1 if registration failed).
+*/
+int aomw_stream_cmd_register() {
+  return aocmd_cint_register(aomw_stream_cmd, "stream", "binary frames from a host", aomw_stream_cmd_longhelp);
+}
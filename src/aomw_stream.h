@@ -0,0 +1,58 @@
+// aomw_stream.h - binary streaming of frames from a host into the topo framebuffer
+/*****************************************************************************
+ * Copyright 2024 by ams OSRAM AG                                            *
+ * All rights are reserved.                                                  *
+ *                                                                           *
+ * IMPORTANT - PLEASE READ CAREFULLY BEFORE COPYING, INSTALLING OR USING     *
+ * THE SOFTWARE.                                                             *
+ *                                                                           *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS       *
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT         *
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS         *
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT  *
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,     *
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT          *
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,     *
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY     *
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT       *
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE     *
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.      *
+ *****************************************************************************/
+#ifndef _AOMW_STREAM_H_
+#define _AOMW_STREAM_H_
+
+
+#include <stdint.h>     // uint8_t
+#include <aomw_topo.h>  // AOMW_TOPO_MAXTRIPLETS
+
+
+// A frame: sync, flags, count (LE16), tix0 (LE16), count colors, CRC-16 (LE16) over all preceding bytes (see aomw_stream.cpp).
+#define AOMW_STREAM_SYNC          0xA5 // First byte of a frame
+#define AOMW_STREAM_FLAGS_RGB8    0x01 // Colors are 3 bytes (8 bit per component) instead of 6 (15 bit per component, LE16)
+#define AOMW_STREAM_FLAGS_NOFLUSH 0x02 // Only set the framebuffer; a later frame flushes (for frames split over several packets)
+#define AOMW_STREAM_MAXCOUNT      AOMW_TOPO_MAXTRIPLETS // Max number of colors in one frame
+// Acknowledge byte the receiver sends back per frame
+#define AOMW_STREAM_ACK_OK        'K'  // Frame set (and flushed)
+#define AOMW_STREAM_ACK_END       'Z'  // End of stream (frame with count 0)
+#define AOMW_STREAM_ACK_CRC       'C'  // CRC error, frame dropped
+#define AOMW_STREAM_ACK_RANGE     'R'  // Triplets out of range (or flags unknown), frame dropped
+#define AOMW_STREAM_ACK_FLUSH     'F'  // Flush failed (telegram error)
+
+
+// Resets the receiver (hunts for the next sync byte) and its statistics.
+void aomw_stream_reset();
+// Feeds one received byte; returns the acknowledge byte (AOMW_STREAM_ACK_XXX) when it completes a frame, else 0.
+int aomw_stream_feed( uint8_t byte );
+// Feeds all bytes available on Serial, and writes the acknowledges; returns 1 when the end frame was received.
+int aomw_stream_poll();
+// Runs the receiver until the end frame, or until no byte arrived for `timeout_ms`; returns 1 for end frame, 0 for timeout.
+int aomw_stream_run( uint32_t timeout_ms );
+// Returns the number of frames set, and the number of frames dropped (CRC or range errors) since the last reset.
+void aomw_stream_stats( uint32_t * frames, uint32_t * dropped );
+
+
+// Registers the "stream" command with the command interpreter.
+int aomw_stream_cmd_register();
+
+
+#endif
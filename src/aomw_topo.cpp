@@ -18,9 +18,15 @@
  * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE     *
  * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.      *
  *****************************************************************************/
-#include <Arduino.h>    // Serial.printf
+#include <Arduino.h>    // Serial.printf, micros()
+#include <stdarg.h>     // va_list
+#include <string.h>     // memset
+#include <limits.h>     // INT_MAX
+#include <aospi.h>      // aospi_txcount_get()
 #include <aoosp.h>      // aoosp_send_identify()
 #include <aocmd.h>      // aocmd_cint_register()
+#include <aomw_trace.h> // AOMW_TRACE()
+#include <aomw_eeprom.h> // aomw_eeprom_read()
 #include <aomw_topo.h>  // own
 
 
@@ -61,56 +67,198 @@
 // chain ready for pwm telegrams via aomw_topo_settriplet().
 
 
-#define AOMW_TOPO_MAXNODES       100 // Theoretical max is 1000 (addr space of OSP)
-#define AOMW_TOPO_MAXTRIPLETS    200 // Theoretical max is 3000 (3 triplets on 1000 SAIDs)
-#define AOMW_TOPO_MAXI2CBRIDGES    5 // Theoretical max is 1000 (every one of the 1000 SAIDs)
-#define AOMW_TOPO_CHAN_NONE     0xFF // channel id used internally when there are no channels (ie for RGBI)
+// All state is in a context (aomw_topo_ctx_t, see the header); these functions take it as first argument.
+// AOMW_TOPO_MAXNODES, AOMW_TOPO_MAXI2CBRIDGES and AOMW_TOPO_MAXTRIPLETS are defined in the header (they size the context).
+// AOMW_TOPO_CHAN_NONE (channel id used internally when there are no channels, ie for RGBI) is defined in the header.
 
 
-static int      aomw_topo_loop_;                                   // Chain has direction loop (1) or bidir (0)
-static uint16_t aomw_topo_last_;                                   // The address of the last node (response from INIT telegram)
+// The default context, used by the functions without _ctx suffix.
+aomw_topo_ctx_t aomw_topo_ctx_default;
 
-static uint16_t aomw_topo_numnodes_;                               // The number of nodes in the chain (at the end of scan must be equal to aomw_topo_last_)
-static uint32_t aomw_topo_node_id_[AOMW_TOPO_MAXNODES];            // The identity reported by the node
-static uint8_t  aomw_topo_node_numtriplets_[AOMW_TOPO_MAXNODES];   // Number of triplets in that node (RGBI: 1, SAID: 3 or 2)
-static uint16_t aomw_topo_node_triplet1_[AOMW_TOPO_MAXNODES];      // The triplet index of the first triplet of this node
 
-static uint16_t aomw_topo_numtriplets_;                            // Number of triplets in the chain
-static uint16_t aomw_topo_triplet_addr_[AOMW_TOPO_MAXTRIPLETS];    // The address of the node this triplet belongs to
-static uint8_t  aomw_topo_triplet_chan_[AOMW_TOPO_MAXTRIPLETS];    // The channel of the node this triplet is connected to (AOMW_TOPO_CHAN_NONE for RGBI)
+// Points the tables back to RAM (before a build or import fills them).
+static void aomw_topo_useram( aomw_topo_ctx_t * ctx ) {
+  ctx->ids = ctx->ids_ram;
+  ctx->node_rec = ctx->node_rec_ram;
+  ctx->node_triplet1s = ctx->node_triplet1s_ram;
+  ctx->triplet_addr = ctx->triplet_addr_ram;
+  ctx->triplet_chan = ctx->triplet_chan_ram;
+  ctx->i2cbridge_addr = ctx->i2cbridge_addr_ram;
+}
+
+
+// The node tables are compact, since a chain typically has only a few distinct
+// node ids. Per node there is a 16 bit record (AOMW_TOPO_REC_xxx in the header)
+// with an index in the table of distinct ids, the number of triplets, the live
+// channels and flags.
+// The first triplet of a node is the sum of the triplet counts of the nodes 
+// before it; that sum is stored for every 16th node (AOMW_TOPO_TRIPLET1_STRIDE),
+// so that deriving it costs at most 15 additions. Slot 0 of node_rec is 
+// unused (addresses start at 1) and has 0 triplets, as the sum requires.
+
+
+// Returns the id of node `addr` from its record.
+static uint32_t aomw_topo_rec_id( aomw_topo_ctx_t * ctx, uint16_t addr ) {
+  return ctx->ids[ ctx->node_rec[addr] & AOMW_TOPO_REC_IDIX ];
+}
+
+
+// Returns the number of triplets of node `addr` from its record.
+static uint8_t aomw_topo_rec_numtriplets( aomw_topo_ctx_t * ctx, uint16_t addr ) {
+  return (ctx->node_rec[addr] & AOMW_TOPO_REC_NUMTRIPLETS) >> AOMW_TOPO_REC_NUMTRIPLETS_SHIFT;
+}
+
+
+// Returns the channel of each triplet of the node with record `rec` in `chans` (AOMW_TOPO_CHAN_NONE for RGBI); returns the number of triplets.
+static uint8_t aomw_topo_rec_chans( uint16_t rec, uint8_t chans[3] ) {
+  uint8_t numtriplets= (rec & AOMW_TOPO_REC_NUMTRIPLETS) >> AOMW_TOPO_REC_NUMTRIPLETS_SHIFT;
+  uint8_t chanmask= (rec & AOMW_TOPO_REC_CHANMASK) >> AOMW_TOPO_REC_CHANMASK_SHIFT;
+  if( chanmask==0 ) { // RGBI
+    for( uint8_t i=0; i<numtriplets; i++ ) chans[i]= AOMW_TOPO_CHAN_NONE;
+    return numtriplets;
+  }
+  uint8_t num= 0;
+  for( uint8_t chan=0; chan<3; chan++ ) if( chanmask & (1<<chan) ) chans[num++]= chan;
+  return num;
+}
+
+
+// Returns the index of the first triplet of node `addr`: the nearest stored sum plus the triplet counts of the nodes in between.
+static uint16_t aomw_topo_rec_triplet1( aomw_topo_ctx_t * ctx, uint16_t addr ) {
+  uint16_t tix= ctx->node_triplet1s[addr/AOMW_TOPO_TRIPLET1_STRIDE];
+  for( uint16_t a=addr-addr%AOMW_TOPO_TRIPLET1_STRIDE; a<addr; a++ ) tix+= aomw_topo_rec_numtriplets(ctx,a);
+  return tix;
+}
+
+
+// Returns the index of `id` in the RAM id table, adding it when new; returns -1 when the table is full.
+static int aomw_topo_rec_idix( aomw_topo_ctx_t * ctx, uint32_t id ) {
+  for( int idix=0; idix<ctx->numids; idix++ ) 
+    if( ctx->ids_ram[idix]==id ) return idix;
+  if( ctx->numids>=AOMW_TOPO_MAXIDS ) return -1;
+  ctx->ids_ram[ctx->numids]= id;
+  return ctx->numids++;
+}
+
+
+// Clients (flag, tscript, ...) address triplets with a _logical_ tix. By 
+// default it equals the _physical_ tix (the order in the chain), but a remap
+// (aomw_topo_remap_xxx) permutes the logical order, e.g. for boards that are
+// wired in reverse. The remap is baked into tables per logical tix, so 
+// aomw_topo_settriplet() costs the same with or without remap; without 
+// remap the logical tables are the physical tables. The framebuffer is 
+// indexed by physical tix, so that a flush sends in chain order.
+
+
+// Clears the framebuffer (all off, nothing dirty); matches a chain after reset.
+static void aomw_topo_fb_clear( aomw_topo_ctx_t * ctx ) {
+  memset(ctx->fb, 0, sizeof ctx->fb);
+  memset(ctx->fb_dirty, 0, sizeof ctx->fb_dirty);
+  ctx->power_fb_ua= 0;
+  ctx->power_generation= ctx->generation;
+  ctx->fb_dim= ctx->dim;
+  memset(ctx->power_sent_ua, 0, sizeof ctx->power_sent_ua);
+  ctx->power_chain_ua= 0;
+}
+
+
+// Recomputes the logical tables and the inverse from ctx->remap_l2p.
+static void aomw_topo_remap_apply( aomw_topo_ctx_t * ctx ) {
+  ctx->remap_isidentity= 1;
+  for( uint16_t ltix=0; ltix<ctx->remap_num; ltix++ ) {
+    uint16_t ptix= ctx->remap_l2p[ltix];
+    ctx->remap_p2l[ptix]= ltix;
+    if( ptix!=ltix ) ctx->remap_isidentity= 0;
+  }
+  if( ctx->remap_isidentity ) {
+    ctx->ltriplet_addr= ctx->triplet_addr;
+    ctx->ltriplet_chan= ctx->triplet_chan;
+    return;
+  }
+  for( uint16_t ltix=0; ltix<ctx->remap_num; ltix++ ) {
+    uint16_t ptix= ctx->remap_l2p[ltix];
+    ctx->ltriplet_addr_ram[ltix]= ctx->triplet_addr[ptix];
+    ctx->ltriplet_chan_ram[ltix]= ctx->triplet_chan[ptix];
+  }
+  ctx->ltriplet_addr= ctx->ltriplet_addr_ram;
+  ctx->ltriplet_chan= ctx->ltriplet_chan_ram;
+}
+
+
+// The map is cleared: the remap becomes the identity over the new (empty) map, so a build that fails does not leave 
+// a remap of the old map. The entries of remap_l2p (for remap_keepnum triplets) are kept, so that a build of that size restores them.
+static void aomw_topo_remap_clear( aomw_topo_ctx_t * ctx ) {
+  ctx->remap_num= ctx->numtriplets; // 0
+  ctx->remap_isidentity= 1;
+  ctx->ltriplet_addr= ctx->triplet_addr;
+  ctx->ltriplet_chan= ctx->triplet_chan;
+}
 
-static uint16_t aomw_topo_numi2cbridges_;                          // Number of I2C bridges in the chain (SAIDs with OTP flag)
-static uint16_t aomw_topo_i2cbridge_addr_[AOMW_TOPO_MAXI2CBRIDGES];// The address of the node this i2c bridge belongs to
+
+// Bakes the remap when the map is complete. The remap is kept when the number of triplets did not change, otherwise it is reset (and the framebuffer cleared).
+static void aomw_topo_remap_bake( aomw_topo_ctx_t * ctx ) {
+  uint16_t num= ctx->numtriplets;
+  if( num!=ctx->remap_keepnum ) {
+    for( uint16_t tix=0; tix<num; tix++ ) ctx->remap_l2p[tix]= tix;
+    aomw_topo_fb_clear(ctx);
+  }
+  ctx->remap_num= num;
+  ctx->remap_keepnum= num;
+  aomw_topo_remap_apply(ctx);
+}
 
 
 // === data model observers =================================================
 
 
+/*!
+    @brief  Returns the generation of the "topology map".
+    @param  ctx
+            The context (the chain) to operate on.
+    @return Generation counter.
+    @note   The counter increments every time a build clears the map, and 
+            again when the build has completed the map. Clients that cache 
+            something derived from the map (eg a flag layout) store the 
+            generation with it; the cache is stale when the generation 
+            differs.
+    @note   The generation is never 0, so clients can use 0 for "not cached".
+*/
+uint32_t aomw_topo_generation_ctx( aomw_topo_ctx_t * ctx ) {
+  return ctx->generation;
+}
+
+
 /*!
     @brief  Returns if the current OSP chain has direction Loop (or BiDir).
+    @param  ctx
+            The context (the chain) to operate on.
     @return 1  if the current OSP chain has direction Loop.
             0  if the current OSP chain has direction BiDir.
     @note   Only available after aomw_topo_build() - or start/step.
     @note   This is part of what is known as the OSP chain "topology map".
 */
-int aomw_topo_loop() {
-  return aomw_topo_loop_;
+int aomw_topo_loop_ctx( aomw_topo_ctx_t * ctx ) {
+  return ctx->loop;
 }
 
 
 /*!
     @brief  Returns the number of nodes in the scanned OSP chain.
+    @param  ctx
+            The context (the chain) to operate on.
     @return Number of OSP nodes in the scanned chain.
     @note   Only available after aomw_topo_build() - or start/step.
     @note   This is part of what is known as the OSP chain "topology map".
 */
-uint16_t aomw_topo_numnodes() {
-  return aomw_topo_numnodes_;
+uint16_t aomw_topo_numnodes_ctx( aomw_topo_ctx_t * ctx ) {
+  return ctx->numnodes;
 }
 
 
 /*!
     @brief  Returns the identity of OSP node at address `addr`.
+    @param  ctx
+            The context (the chain) to operate on.
     @param  addr
             The address of the OSP node.
     @return The identity (as reported by telegram 07/IDENTIFY).
@@ -118,15 +266,17 @@ uint16_t aomw_topo_numnodes() {
     @note   addr is 1-based, so 1 <= addr <= aomw_topo_numnodes().
     @note   This is part of what is known as the OSP chain "topology map".
 */
-uint32_t aomw_topo_node_id( uint16_t addr ) {
-  AORESULT_ASSERT( 1<=addr && addr<=aomw_topo_numnodes_ );
-  return aomw_topo_node_id_[addr]; // skip slot 0
+uint32_t aomw_topo_node_id_ctx( aomw_topo_ctx_t * ctx, uint16_t addr ) {
+  AORESULT_ASSERT( 1<=addr && addr<=ctx->numnodes );
+  return aomw_topo_rec_id(ctx, addr); // skip slot 0
 }
 
 
 /*!
     @brief  Returns the number of triplets (RGB modules) connected to 
             the OSP node at address `addr`.
+    @param  ctx
+            The context (the chain) to operate on.
     @param  addr
             The address of the OSP node.
     @return The number of triplets. Typically 1 for RGBI's and 3 for SAID's
@@ -135,15 +285,17 @@ uint32_t aomw_topo_node_id( uint16_t addr ) {
     @note   addr is 1-based, so 1 <= addr <= aomw_topo_numnodes().
     @note   This is part of what is known as the OSP chain "topology map".
 */
-uint8_t aomw_topo_node_numtriplets( uint16_t addr ) {
-  AORESULT_ASSERT( 1<=addr && addr<=aomw_topo_numnodes_ );
-  return aomw_topo_node_numtriplets_[addr]; // skip slot 0
+uint8_t aomw_topo_node_numtriplets_ctx( aomw_topo_ctx_t * ctx, uint16_t addr ) {
+  AORESULT_ASSERT( 1<=addr && addr<=ctx->numnodes );
+  return aomw_topo_rec_numtriplets(ctx, addr); // skip slot 0
 }
 
 
 /*!
     @brief  Returns the index of the first triplet (RGB module) driven by 
             OSP node at address `addr`.
+    @param  ctx
+            The context (the chain) to operate on.
     @param  addr
             The address of the OSP node.
     @return Index of the first triplet.
@@ -152,27 +304,86 @@ uint8_t aomw_topo_node_numtriplets( uint16_t addr ) {
     @note   If a node has more than 1 triplet, see aomw_topo_node_numtriplets(),
             the next ones are consecutively numbered.
     @note   This is part of what is known as the OSP chain "topology map".
+    @note   Not stored per node, but derived from the triplet counts of 
+            at most 15 preceding nodes.
+*/
+uint16_t aomw_topo_node_triplet1_ctx( aomw_topo_ctx_t * ctx, uint16_t addr ) {
+  AORESULT_ASSERT( 1<=addr && addr<=ctx->numnodes );
+  return aomw_topo_rec_triplet1(ctx, addr); // skip slot 0
+}
+
+
+/*!
+    @brief  Returns the channels of the OSP node at address `addr` that 
+            drive a triplet (the "live" channels).
+    @param  ctx
+            The context (the chain) to operate on.
+    @param  addr
+            The address of the OSP node.
+    @return Bit c is set when channel c drives a triplet. Typically 0x07 
+            for a SAID, 0x03 for a SAID with I2C bridge, but less when 
+            channels are clustered (OTP) or overridden (see 
+            aomw_topo_chanmask_override). 0 for an RGBI (no channels).
+    @note   Only available after aomw_topo_build() - or start/step.
+    @note   addr is 1-based, so 1 <= addr <= aomw_topo_numnodes().
+    @note   Stored in the node record; for an imported snapshot or a 
+            fixed topology it is derived from the triplet table.
+*/
+uint8_t aomw_topo_node_chanmask_ctx( aomw_topo_ctx_t * ctx, uint16_t addr ) {
+  AORESULT_ASSERT( 1<=addr && addr<=ctx->numnodes );
+  return (ctx->node_rec[addr] & AOMW_TOPO_REC_CHANMASK) >> AOMW_TOPO_REC_CHANMASK_SHIFT;
+}
+
+
+#define AOMW_TOPO_CHANMASK_OVERRIDE 0x80 // Flag in ctx->chanmask_override: the entry is set
+
+
+/*!
+    @brief  Overrides which channels of the SAID at address `addr` drive a 
+            triplet, for the next builds.
+    @param  ctx
+            The context (the chain) to operate on.
+    @param  addr
+            The address of the OSP node, 1 <= addr < AOMW_TOPO_MAXNODES.
+    @param  mask
+            Bit c set when channel c drives a triplet (so 0..AOMW_TOPO_CHANMASK_ALL),
+            or AOMW_TOPO_CHANMASK_AUTO to use the OTP configuration again.
+    @return aoresult_ok           if successful
+            aoresult_sys_cmdargs  if `addr` or `mask` is out of range
+    @note   For configurations the OTP does not tell, eg a board that does 
+            not populate all channels; the build then sends no telegrams to 
+            those channels, and gives them no triplet index.
+    @note   A channel 2 that is an I2C bridge (OTP) never drives a triplet.
+    @note   Has no effect on nodes that are not a SAID, and is not used 
+            when the build skips identifying (snapshot or fixed topology).
 */
-uint16_t aomw_topo_node_triplet1( uint16_t addr ) {
-  AORESULT_ASSERT( 1<=addr && addr<=aomw_topo_numnodes_ );
-  return aomw_topo_node_triplet1_[addr]; // skip slot 0
+aoresult_t aomw_topo_chanmask_override_ctx( aomw_topo_ctx_t * ctx, uint16_t addr, uint8_t mask ) {
+  if( addr<1 || addr>=AOMW_TOPO_MAXNODES ) return aoresult_sys_cmdargs;
+  if( mask==AOMW_TOPO_CHANMASK_AUTO ) { ctx->chanmask_override[addr]= 0; return aoresult_ok; }
+  if( mask & ~AOMW_TOPO_CHANMASK_ALL ) return aoresult_sys_cmdargs;
+  ctx->chanmask_override[addr]= AOMW_TOPO_CHANMASK_OVERRIDE | mask;
+  return aoresult_ok;
 }
 
 
 /*!
     @brief  Returns the number of triplets (RGB modules) in the scanned 
             OSP chain.
+    @param  ctx
+            The context (the chain) to operate on.
     @return Number of triplets in the scanned chain.
     @note   Only available after aomw_topo_build() - or start/step.
     @note   This is part of what is known as the OSP chain "topology map".
 */
-uint16_t aomw_topo_numtriplets() {
-  return aomw_topo_numtriplets_;
+uint16_t aomw_topo_numtriplets_ctx( aomw_topo_ctx_t * ctx ) {
+  return ctx->numtriplets;
 }
 
 
 /*!
     @brief  Returns the address of the OSP node that drives triplet `tix`.
+    @param  ctx
+            The context (the chain) to operate on.
     @param  tix
             The index of the triplet.
     @return The OSP address of the triplet.
@@ -186,14 +397,16 @@ uint16_t aomw_topo_numtriplets() {
             the addr and channel (see aomw_topo_triplet_chan) are needed.
     @note   This is part of what is known as the OSP chain "topology map".
 */
-uint16_t aomw_topo_triplet_addr( uint16_t tix ) {
-  AORESULT_ASSERT( tix<aomw_topo_numtriplets_ );
-  return aomw_topo_triplet_addr_[tix];
+uint16_t aomw_topo_triplet_addr_ctx( aomw_topo_ctx_t * ctx, uint16_t tix ) {
+  AORESULT_ASSERT( tix<ctx->numtriplets );
+  return ctx->triplet_addr[tix];
 }
 
 
 /*!
     @brief  Returns 1 if triplet `tix` is driven by an OSP node with channels.
+    @param  ctx
+            The context (the chain) to operate on.
     @param  tix
             The index of the triplet.
     @return 1 iff the the triplet is on a channel of an OSP node.
@@ -206,15 +419,17 @@ uint16_t aomw_topo_triplet_addr( uint16_t tix ) {
             In the latter case, this function returns 1.
     @note   This is part of what is known as the OSP chain "topology map".
 */
-int aomw_topo_triplet_onchan( uint16_t tix ) {
-  AORESULT_ASSERT( tix<aomw_topo_numtriplets_ );
-  return aomw_topo_triplet_chan_[tix] != AOMW_TOPO_CHAN_NONE;
+int aomw_topo_triplet_onchan_ctx( aomw_topo_ctx_t * ctx, uint16_t tix ) {
+  AORESULT_ASSERT( tix<ctx->numtriplets );
+  return ctx->triplet_chan[tix] != AOMW_TOPO_CHAN_NONE;
 }
 
 
 /*!
     @brief  Returns the channel triplet `tix` is attached to in case the
             triplet is driven by an OSP node with channels.
+    @param  ctx
+            The context (the chain) to operate on.
     @param  tix
             The index of the triplet.
     @return The channel of a node.
@@ -228,28 +443,32 @@ int aomw_topo_triplet_onchan( uint16_t tix ) {
     @note   Only defined when aomw_topo_triplet_onchan(tix).       
     @note   This is part of what is known as the OSP chain "topology map".
 */
-uint8_t aomw_topo_triplet_chan( uint16_t tix ) {
-  AORESULT_ASSERT( tix<aomw_topo_numtriplets_ );
-  AORESULT_ASSERT( aomw_topo_triplet_chan_[tix] != AOMW_TOPO_CHAN_NONE );
-  return aomw_topo_triplet_chan_[tix];
+uint8_t aomw_topo_triplet_chan_ctx( aomw_topo_ctx_t * ctx, uint16_t tix ) {
+  AORESULT_ASSERT( tix<ctx->numtriplets );
+  AORESULT_ASSERT( ctx->triplet_chan[tix] != AOMW_TOPO_CHAN_NONE );
+  return ctx->triplet_chan[tix];
 }
 
 
 /*!
     @brief  Returns the number of I2C bridges in the scanned chain.
+    @param  ctx
+            The context (the chain) to operate on.
     @return Number of I2C bridges in the scanned OSP chain.
     @note   Only available after aomw_topo_build() - or start/step.
     @note   SAIDs can have an I2C bridge, if configured as such in their OTP.
     @note   This is part of what is known as the OSP chain "topology map".
 */
-uint16_t aomw_topo_numi2cbridges() {
-  return aomw_topo_numi2cbridges_;
+uint16_t aomw_topo_numi2cbridges_ctx( aomw_topo_ctx_t * ctx ) {
+  return ctx->numi2cbridges;
 }
 
 
 /*!
     @brief  Returns the address of the OSP node that has I2C bridge 
             with index `iix`.
+    @param  ctx
+            The context (the chain) to operate on.
     @param  iix
             The index of the I2C bridge.
     @return The OSP address of the I2C bridge.
@@ -257,135 +476,753 @@ uint16_t aomw_topo_numi2cbridges() {
     @note   iix is 0-based, so , 0 <= iix < aomw_topo_numi2cbridges().
     @note   This is part of what is known as the OSP chain "topology map".
 */
-uint16_t aomw_topo_i2cbridge_addr( uint16_t iix ) {
-  AORESULT_ASSERT( iix<aomw_topo_numi2cbridges_ );
- return aomw_topo_i2cbridge_addr_[iix];
+uint16_t aomw_topo_i2cbridge_addr_ctx( aomw_topo_ctx_t * ctx, uint16_t iix ) {
+  AORESULT_ASSERT( iix<ctx->numi2cbridges );
+ return ctx->i2cbridge_addr[iix];
 }
 
 
 // === data model dump ======================================================
 
 
+// The dump functions do not print field by field, but format into a buffer (ctx->dump_buf), which is written to Serial in large chunks.
+
+
+// Writes the dump buffer to Serial (blocking) and empties it.
+static void aomw_topo_dump_flush( aomw_topo_ctx_t * ctx ) {
+  if( ctx->dump_len>0 ) Serial.write((const uint8_t*)ctx->dump_buf, ctx->dump_len);
+  ctx->dump_len= 0;
+  ctx->dump_pos= 0;
+}
+
+
+// Appends formatted text to the dump buffer; flushes it first when the text does not fit.
+static void aomw_topo_dump_printf( aomw_topo_ctx_t * ctx, const char * format, ...) {
+  va_list args;
+  for( int attempt=0; attempt<2; attempt++ ) {
+    int size= AOMW_TOPO_DUMP_BUFSIZE - ctx->dump_len;
+    va_start(args, format);
+    int len= vsnprintf(ctx->dump_buf+ctx->dump_len, size, format, args);
+    va_end(args);
+    if( len<0 ) return;
+    if( len<size ) { ctx->dump_len+= len; return; }
+    ctx->dump_buf[ctx->dump_len]= '\0'; // undo partial text
+    if( ctx->dump_len==0 ) { ctx->dump_len= size-1; aomw_topo_dump_flush(ctx); return; } // text larger than buffer: truncated
+    aomw_topo_dump_flush(ctx);
+  }
+}
+
+
 /*!
     @brief  Prints on Serial a summary of the "topology map".
+    @param  ctx
+            The context (the chain) to operate on.
     @note   Only available after aomw_topo_build() - or start/step.
 */
-void aomw_topo_dump_summary() {
-  Serial.printf("nodes(N) 1..%d, ", aomw_topo_numnodes_ );
-  Serial.printf("triplets(T) 0..%d, ", aomw_topo_numtriplets_ - 1 );
-  if( aomw_topo_numi2cbridges_ == 0 ) 
-    Serial.printf("i2cbridges(I) none, " );
+void aomw_topo_dump_summary_ctx( aomw_topo_ctx_t * ctx ) {
+  aomw_topo_dump_printf(ctx, "nodes(N) 1..%d, ", ctx->numnodes );
+  aomw_topo_dump_printf(ctx, "triplets(T) 0..%d, ", ctx->numtriplets - 1 );
+  if( ctx->numi2cbridges == 0 ) 
+    aomw_topo_dump_printf(ctx, "i2cbridges(I) none, " );
   else
-    Serial.printf("i2cbridges(I) 0..%d, ", aomw_topo_numi2cbridges_-1 );
-  Serial.printf("dir %s\n", aomw_topo_loop()?"loop":"bidir");
+    aomw_topo_dump_printf(ctx, "i2cbridges(I) 0..%d, ", ctx->numi2cbridges-1 );
+  aomw_topo_dump_printf(ctx, "dir %s\n", aomw_topo_loop_ctx(ctx)?"loop":"bidir");
+  aomw_topo_dump_flush(ctx);
 }
 
 
 /*!
     @brief  Prints on Serial a list of nodes from the "topology map".
+    @param  ctx
+            The context (the chain) to operate on.
     @note   Only available after aomw_topo_build() - or start/step.
 */
-void aomw_topo_dump_nodes() {
+void aomw_topo_dump_nodes_ctx( aomw_topo_ctx_t * ctx ) {
   uint16_t iix = 0;
-  for( uint16_t addr=1; addr<=aomw_topo_numnodes_; addr++ ) {
-    Serial.printf("N%03X (%08lX)", addr,aomw_topo_node_id(addr) );
-    for( uint16_t tix=aomw_topo_node_triplet1(addr); tix<aomw_topo_node_triplet1(addr)+aomw_topo_node_numtriplets(addr); tix++ )
-      Serial.printf(" T%d",tix);
-    if( iix<aomw_topo_numi2cbridges_ && aomw_topo_i2cbridge_addr(iix)==addr ) { Serial.printf(" I%d",iix); iix++; }
-    Serial.printf("\n");
+  uint16_t tix1 = 0; // first triplet of addr, accumulated instead of derived per node
+  for( uint16_t addr=1; addr<=ctx->numnodes; addr++ ) {
+    aomw_topo_dump_printf(ctx, "N%03X (%08lX)", addr,aomw_topo_node_id_ctx(ctx, addr) );
+    uint16_t numtriplets= aomw_topo_rec_numtriplets(ctx, addr);
+    for( uint16_t tix=tix1; tix<tix1+numtriplets; tix++ )
+      aomw_topo_dump_printf(ctx, " T%d",tix);
+    tix1+= numtriplets;
+    if( ctx->node_rec[addr] & AOMW_TOPO_REC_I2CBRIDGE ) { aomw_topo_dump_printf(ctx, " I%d",iix); iix++; }
+    aomw_topo_dump_printf(ctx, "\n");
   }
+  aomw_topo_dump_flush(ctx);
 }
 
 
 /*!
     @brief  Prints on Serial a list of triplets from the "topology map".
+    @param  ctx
+            The context (the chain) to operate on.
     @note   Only available after aomw_topo_build() - or start/step.
 */
-void aomw_topo_dump_triplets() {
-  for( uint16_t tix=0; tix<aomw_topo_numtriplets_; tix++ ) {
-    uint16_t addr = aomw_topo_triplet_addr_[tix];
-    Serial.printf("T%d N%03X", tix, addr );
-    if( aomw_topo_triplet_onchan(tix) ) Serial.printf(".C%d", aomw_topo_triplet_chan(tix) );
-    Serial.printf("\n");
+void aomw_topo_dump_triplets_ctx( aomw_topo_ctx_t * ctx ) {
+  for( uint16_t tix=0; tix<ctx->numtriplets; tix++ ) {
+    uint16_t addr = ctx->triplet_addr[tix];
+    aomw_topo_dump_printf(ctx, "T%d N%03X", tix, addr );
+    if( aomw_topo_triplet_onchan_ctx(ctx, tix) ) aomw_topo_dump_printf(ctx, ".C%d", aomw_topo_triplet_chan_ctx(ctx, tix) );
+    aomw_topo_dump_printf(ctx, "\n");
   }
+  aomw_topo_dump_flush(ctx);
 }
 
 
 /*!
     @brief  Prints on Serial a list of I2C bridges from the "topology map".
+    @param  ctx
+            The context (the chain) to operate on.
+    @note   Only available after aomw_topo_build() - or start/step.
+*/
+void aomw_topo_dump_i2cbridges_ctx( aomw_topo_ctx_t * ctx ) {
+  for( uint16_t iix=0; iix<ctx->numi2cbridges; iix++ ) {
+    aomw_topo_dump_printf(ctx, "I%d N%03X\n", iix,aomw_topo_i2cbridge_addr_ctx(ctx, iix) );
+  }
+  aomw_topo_dump_flush(ctx);
+}
+
+
+// The CSV dump consists of lines; ctx->dumpcsv_lix is the index of the next line to format.
+// Layout: header+nodes, header+triplets, header+i2cbridges, header+summary.
+
+
+// Formats CSV line `lix` into `buf` (of `size` bytes); returns length as snprintf, or -1 when `lix` is past the last line.
+static int aomw_topo_dumpcsv_line( aomw_topo_ctx_t * ctx, int lix, char * buf, int size ) {
+  if( lix==0 ) return snprintf(buf, size, "#N,addr,id,numtriplets,triplet1\n");
+  lix-= 1;
+  if( lix<ctx->numnodes ) {
+    uint16_t addr= lix+1;
+    return snprintf(buf, size, "N,%d,%08lX,%d,%d\n", addr, (unsigned long)aomw_topo_rec_id(ctx, addr), aomw_topo_rec_numtriplets(ctx, addr), aomw_topo_rec_triplet1(ctx, addr) ); // skip slot 0
+  }
+  lix-= ctx->numnodes;
+  if( lix==0 ) return snprintf(buf, size, "#T,tix,addr,chan\n");
+  lix-= 1;
+  if( lix<ctx->numtriplets ) {
+    if( ctx->triplet_chan[lix]==AOMW_TOPO_CHAN_NONE ) return snprintf(buf, size, "T,%d,%d,\n", lix, ctx->triplet_addr[lix] );
+    return snprintf(buf, size, "T,%d,%d,%d\n", lix, ctx->triplet_addr[lix], ctx->triplet_chan[lix] );
+  }
+  lix-= ctx->numtriplets;
+  if( lix==0 ) return snprintf(buf, size, "#I,iix,addr\n");
+  lix-= 1;
+  if( lix<ctx->numi2cbridges ) return snprintf(buf, size, "I,%d,%d\n", lix, ctx->i2cbridge_addr[lix] );
+  lix-= ctx->numi2cbridges;
+  if( lix==0 ) return snprintf(buf, size, "#S,numnodes,numtriplets,numi2cbridges,loop,generation\n");
+  if( lix==1 ) return snprintf(buf, size, "S,%d,%d,%d,%d,%lu\n", ctx->numnodes, ctx->numtriplets, ctx->numi2cbridges, ctx->loop, (unsigned long)ctx->generation );
+  return -1;
+}
+
+
+/*!
+    @brief  This function is part of the incremental CSV dump of the
+            "topology map". Call this once, then follow up with 
+            aomw_topo_dumpcsv_step() until aomw_topo_dumpcsv_done().
+    @param  ctx
+            The context (the chain) to operate on.
+    @note   The CSV has a record type in the first column: N (node), 
+            T (triplet), I (I2C bridge) or S (summary). Lines starting
+            with # are headers naming the columns of the following records.
+    @note   Do not call other dump functions on the same context while
+            a CSV dump is in progress; they share its buffer.
+*/
+void aomw_topo_dumpcsv_start_ctx( aomw_topo_ctx_t * ctx ) {
+  ctx->dump_len= 0;
+  ctx->dump_pos= 0;
+  ctx->dumpcsv_lix= 0;
+}
+
+
+// Formats the next lines when the dump buffer is drained, then writes what Serial accepts without blocking (or all, when `block`).
+static void aomw_topo_dumpcsv_write( aomw_topo_ctx_t * ctx, int block ) {
+  // Refill buffer with whole lines when it is drained
+  if( ctx->dump_pos==ctx->dump_len ) {
+    ctx->dump_len= 0;
+    ctx->dump_pos= 0;
+    while( 1 ) {
+      int size= AOMW_TOPO_DUMP_BUFSIZE - ctx->dump_len;
+      int len= aomw_topo_dumpcsv_line(ctx, ctx->dumpcsv_lix, ctx->dump_buf+ctx->dump_len, size);
+      if( len<0 || len>=size ) break; // no more lines, or line does not fit (lines are much shorter than the buffer)
+      ctx->dump_len+= len;
+      ctx->dumpcsv_lix++;
+    }
+  }
+  // Write what Serial accepts without blocking (all, blocking, when `block`)
+  int len= ctx->dump_len - ctx->dump_pos;
+  if( !block ) {
+    int room= Serial.availableForWrite();
+    if( len>room ) len= room;
+  }
+  if( len>0 ) {
+    Serial.write((const uint8_t*)ctx->dump_buf+ctx->dump_pos, len);
+    ctx->dump_pos+= len;
+  }
+}
+
+
+/*!
+    @brief  This function is part of the incremental CSV dump.
+            Call this until aomw_topo_dumpcsv_done(), but after 
+            aomw_topo_dumpcsv_start().
+    @param  ctx
+            The context (the chain) to operate on.
+    @note   Formats lines into the dump buffer, and only writes as many 
+            characters as Serial can accept without blocking 
+            (Serial.availableForWrite()). So this is cheap to call from
+            the main loop.
+    @note   When Serial reports no room (some cores always report 0), a 
+            step writes nothing; aomw_topo_dumpcsv() does not depend on it.
+*/
+void aomw_topo_dumpcsv_step_ctx( aomw_topo_ctx_t * ctx ) {
+  aomw_topo_dumpcsv_write(ctx, 0);
+}
+
+
+/*!
+    @brief  This function is part of the incremental CSV dump.
+            Call this after aomw_topo_dumpcsv_step(), to determine if
+            another step() is needed.
+    @param  ctx
+            The context (the chain) to operate on.
+    @return 1   if all lines are written
+            0   if another aomw_topo_dumpcsv_step() is needed
+*/
+int aomw_topo_dumpcsv_done_ctx( aomw_topo_ctx_t * ctx ) {
+  return ctx->dump_pos==ctx->dump_len && aomw_topo_dumpcsv_line(ctx, ctx->dumpcsv_lix,NULL,0)<0;
+}
+
+
+/*!
+    @brief  Prints on Serial the "topology map" in CSV format.
+    @param  ctx
+            The context (the chain) to operate on.
+    @note   Blocking variant of aomw_topo_dumpcsv_start(), 
+            aomw_topo_dumpcsv_step() and aomw_topo_dumpcsv_done(): it 
+            writes every buffer with a blocking Serial.write(), so it 
+            does not spin when Serial.availableForWrite() reports 0.
+*/
+void aomw_topo_dumpcsv_ctx( aomw_topo_ctx_t * ctx ) {
+  aomw_topo_dumpcsv_start_ctx(ctx);
+  while( !aomw_topo_dumpcsv_done_ctx(ctx) ) {
+    aomw_topo_dumpcsv_write(ctx, 1);
+    yield();
+  }
+}
+
+
+// === hash and diff ========================================================
+
+
+// The hash of the map is FNV-1a (32 bit) over id and number of triplets of 
+// all nodes (in address order). It is "rolling": the build updates it for 
+// each identified node. For a diff, the node records of the previous map 
+// are saved (when a build starts, or a map is imported or installed).
+
+
+#define AOMW_TOPO_HASH_INIT  0x811C9DC5 // FNV-1a offset basis
+#define AOMW_TOPO_HASH_PRIME 0x01000193 // FNV-1a prime
+
+
+// Returns `hash` extended with the node `id`/`numtriplets`/`chanmask`.
+// The mask is only hashed when it is not the plain one (channels 0 up to numtriplets), so hashes of chains without overrides or clusters are unchanged.
+static uint32_t aomw_topo_hash_node( uint32_t hash, uint32_t id, uint8_t numtriplets, uint8_t chanmask ) {
+  uint8_t bytes[6] = { (uint8_t)id, (uint8_t)(id>>8), (uint8_t)(id>>16), (uint8_t)(id>>24), numtriplets, chanmask };
+  int num= chanmask==0 || chanmask==(1<<numtriplets)-1 ? 5 : 6;
+  for( int i=0; i<num; i++ ) hash= (hash ^ bytes[i]) * AOMW_TOPO_HASH_PRIME;
+  return hash;
+}
+
+
+// Recomputes the hash from the node tables (after the tables are replaced instead of built).
+static void aomw_topo_hash_compute( aomw_topo_ctx_t * ctx ) {
+  ctx->hash= AOMW_TOPO_HASH_INIT;
+  for( uint16_t addr=1; addr<=ctx->numnodes; addr++ ) // skip slot 0
+    ctx->hash= aomw_topo_hash_node(ctx->hash, aomw_topo_rec_id(ctx, addr), aomw_topo_rec_numtriplets(ctx, addr), aomw_topo_node_chanmask_ctx(ctx, addr) ); 
+}
+
+
+// Saves the node records of the current map as previous map (before the map is replaced).
+static void aomw_topo_prev_save( aomw_topo_ctx_t * ctx ) {
+  ctx->prev_numnodes= ctx->numnodes;
+  ctx->prev_numtriplets= ctx->numtriplets;
+  ctx->prev_hash= ctx->hash;
+  ctx->prev_numids= ctx->numids; // a fixed topology may have more ids than saved; aomw_topo_diff_node() treats those as changed
+  for( uint16_t idix=0; idix<ctx->numids && idix<AOMW_TOPO_MAXIDS; idix++ ) 
+    ctx->prev_ids[idix]= ctx->ids[idix];
+  for( uint16_t addr=1; addr<=ctx->numnodes && addr<AOMW_TOPO_MAXNODES; addr++ ) 
+    ctx->prev_node_rec[addr]= ctx->node_rec[addr]; // skip slot 0
+}
+
+
+/*!
+    @brief  Returns a hash of the "topology map" (ids, triplet counts and 
+            live channels of all nodes).
+    @param  ctx
+            The context (the chain) to operate on.
+    @return The hash.
+    @note   Unlike aomw_topo_generation(), which changes on every build, 
+            the hash only changes when the chain changes. So it can be 
+            stored (e.g. in EEPROM) to detect changes across power cycles.
+    @note   Only available after aomw_topo_build() - or start/step.
+*/
+uint32_t aomw_topo_hash_ctx( aomw_topo_ctx_t * ctx ) {
+  return ctx->hash;
+}
+
+
+/*!
+    @brief  Compares the "topology map" with the previous one; the map 
+            that was there before the last build, import or install.
+    @param  ctx
+            The context (the chain) to operate on.
+    @param  diff
+            Output parameter, receives the summary of the differences.
+    @return aoresult_ok          if successful
+            aoresult_outargnull  if `diff` is NULL
+    @note   Nodes are compared by address: a node present in both maps 
+            with a different id, triplet count or live channels (see 
+            aomw_topo_node_chanmask) is "retyped", a node only
+            in the new map is "added", only in the old map "removed". 
+            aomw_topo_diff_node() tells which applies to a node.
+    @note   diff->firsttix is the first triplet whose address or channel
+            differs, so triplets from there on are shifted (or gone);
+            AOMW_TOPO_DIFF_NOTIX if no triplet changed.
+    @note   Runs in O(N), N being the number of nodes.
+*/
+aoresult_t aomw_topo_diff_ctx( aomw_topo_ctx_t * ctx, aomw_topo_diff_t * diff ) {
+  if( diff==0 ) return aoresult_outargnull;
+  uint16_t numboth= ctx->numnodes<ctx->prev_numnodes ? ctx->numnodes : ctx->prev_numnodes;
+  diff->changed= ctx->hash!=ctx->prev_hash || ctx->numnodes!=ctx->prev_numnodes;
+  diff->numadded= ctx->numnodes - numboth;
+  diff->numremoved= ctx->prev_numnodes - numboth;
+  diff->numretyped= 0;
+  diff->firstaddr= 0;
+  diff->firsttix= AOMW_TOPO_DIFF_NOTIX;
+  uint16_t tix= 0; // triplet index of node addr (same in both maps, up to the first node with a different triplet count)
+  for( uint16_t addr=1; addr<=numboth; addr++ ) {
+    if( aomw_topo_diff_node_ctx(ctx, addr)==AOMW_TOPO_DIFF_RETYPED ) {
+      diff->numretyped++;
+      if( diff->firstaddr==0 ) diff->firstaddr= addr;
+    }
+    uint8_t chans[3];
+    uint8_t numtriplets= aomw_topo_rec_chans(ctx->node_rec[addr], chans);
+    if( diff->firsttix==AOMW_TOPO_DIFF_NOTIX ) {
+      // Compare the channels of the triplets of this node; from the first difference, triplets change channel or move to another node
+      uint8_t prev_chans[3];
+      uint8_t prev_numtriplets= addr<AOMW_TOPO_MAXNODES ? aomw_topo_rec_chans(ctx->prev_node_rec[addr], prev_chans) : 0; 
+      uint8_t numsame= 0;
+      if( addr<AOMW_TOPO_MAXNODES ) // not saved, assume changed
+        while( numsame<numtriplets && numsame<prev_numtriplets && chans[numsame]==prev_chans[numsame] ) numsame++;
+      if( numsame<numtriplets || numsame<prev_numtriplets ) diff->firsttix= tix+numsame;
+    }
+    tix+= numtriplets;
+  }
+  if( diff->firstaddr==0 && numboth<( ctx->numnodes>ctx->prev_numnodes ? ctx->numnodes : ctx->prev_numnodes) ) diff->firstaddr= numboth+1;
+  if( diff->firsttix==AOMW_TOPO_DIFF_NOTIX && ctx->numtriplets!=ctx->prev_numtriplets ) diff->firsttix= tix; // chain got longer or shorter
+  return aoresult_ok;
+}
+
+
+/*!
+    @brief  Tells how node `addr` differs between the previous and the
+            current "topology map" (see aomw_topo_diff()).
+    @param  ctx
+            The context (the chain) to operate on.
+    @param  addr
+            The address of the node, 1 <= addr, and addr is at most the 
+            number of nodes in the current or the previous map.
+    @return AOMW_TOPO_DIFF_SAME, AOMW_TOPO_DIFF_ADDED, 
+            AOMW_TOPO_DIFF_REMOVED or AOMW_TOPO_DIFF_RETYPED.
+*/
+int aomw_topo_diff_node_ctx( aomw_topo_ctx_t * ctx, uint16_t addr ) {
+  AORESULT_ASSERT( 1<=addr && (addr<=ctx->numnodes || addr<=ctx->prev_numnodes) );
+  if( addr>ctx->prev_numnodes ) return AOMW_TOPO_DIFF_ADDED;
+  if( addr>ctx->numnodes ) return AOMW_TOPO_DIFF_REMOVED;
+  if( addr>=AOMW_TOPO_MAXNODES ) return AOMW_TOPO_DIFF_RETYPED; // previous record not saved, assume changed
+  uint16_t prev_idix= ctx->prev_node_rec[addr] & AOMW_TOPO_REC_IDIX;
+  if( prev_idix>=AOMW_TOPO_MAXIDS ) return AOMW_TOPO_DIFF_RETYPED; // previous id not saved, assume changed
+  if( aomw_topo_rec_id(ctx, addr)!=ctx->prev_ids[prev_idix] ) return AOMW_TOPO_DIFF_RETYPED;
+  if( (ctx->node_rec[addr] ^ ctx->prev_node_rec[addr]) & (AOMW_TOPO_REC_NUMTRIPLETS|AOMW_TOPO_REC_CHANMASK) ) return AOMW_TOPO_DIFF_RETYPED;
+  return AOMW_TOPO_DIFF_SAME;
+}
+
+
+// === snapshot =============================================================
+
+
+// A snapshot is a binary blob with the topology map. It can be exported 
+// after a build, and imported (e.g. at production provisioning, or 
+// precomputed by host tools from the BOM) so that the next build does not
+// need to identify all nodes. All multi-byte fields are little endian.
+//
+//   offset  size  field
+//   0       4     magic "AOTP"
+//   4       1     version (AOMW_TOPO_SNAPSHOT_VERSION)
+//   5       1     loop (1) or bidir (0)
+//   6       2     numnodes
+//   8       2     numtriplets
+//   10      2     numi2cbridges
+//   12      5*N   per node (addr 1..numnodes): id (4), numtriplets (1)
+//   ..      3*T   per triplet (tix 0..numtriplets-1): addr (2), chan (1, 0xFF for none)
+//   ..      2*I   per I2C bridge (iix 0..numi2cbridges-1): addr (2)
+//   ..      4     CRC-32 (as zlib crc32) over all preceding bytes
+
+
+#define AOMW_TOPO_SNAPSHOT_VERSION 1
+
+
+// Computes CRC-32 (reflected, polynomial 0xEDB88320, as zlib crc32) over `len` bytes of `buf`.
+static uint32_t aomw_topo_snapshot_crc( const uint8_t * buf, int len ) {
+  uint32_t crc= 0xFFFFFFFF;
+  for( int i=0; i<len; i++ ) {
+    crc^= buf[i];
+    for( int bit=0; bit<8; bit++ ) crc= (crc>>1) ^ (0xEDB88320 & (0-(crc&1)));
+  }
+  return ~crc;
+}
+
+
+// Little endian helpers for the snapshot blob
+static void     aomw_topo_snapshot_put16( uint8_t * buf, uint16_t val ) { buf[0]=val; buf[1]=val>>8; }
+static void     aomw_topo_snapshot_put32( uint8_t * buf, uint32_t val ) { aomw_topo_snapshot_put16(buf,val); aomw_topo_snapshot_put16(buf+2,val>>16); }
+static uint16_t aomw_topo_snapshot_get16( const uint8_t * buf ) { return buf[0] | (uint16_t)buf[1]<<8; }
+static uint32_t aomw_topo_snapshot_get32( const uint8_t * buf ) { return aomw_topo_snapshot_get16(buf) | (uint32_t)aomw_topo_snapshot_get16(buf+2)<<16; }
+
+
+// Returns the size of a snapshot with the given counts.
+static int aomw_topo_snapshot_size_( int numnodes, int numtriplets, int numi2cbridges ) {
+  return 12 + 5*numnodes + 3*numtriplets + 2*numi2cbridges + 4;
+}
+
+
+/*!
+    @brief  Returns the number of bytes aomw_topo_snapshot_export() needs
+            for the current "topology map".
+    @param  ctx
+            The context (the chain) to operate on.
+    @return Size in bytes.
+*/
+int aomw_topo_snapshot_size_ctx( aomw_topo_ctx_t * ctx ) {
+  return aomw_topo_snapshot_size_(ctx->numnodes, ctx->numtriplets, ctx->numi2cbridges);
+}
+
+
+/*!
+    @brief  Exports the "topology map" as a versioned, checksummed binary
+            blob (snapshot).
+    @param  ctx
+            The context (the chain) to operate on.
+    @param  buf
+            Buffer to write the snapshot to.
+    @param  size
+            The size of `buf` in bytes.
+    @param  len
+            Output parameter, receives the number of bytes written 
+            (aomw_topo_snapshot_size()).
+    @return aoresult_ok          if successful
+            aoresult_outargnull  if `len` is NULL
+            aoresult_outofmem    if `buf` is too small
     @note   Only available after aomw_topo_build() - or start/step.
+    @note   See the top of this section for the layout of the blob.
+*/
+aoresult_t aomw_topo_snapshot_export_ctx( aomw_topo_ctx_t * ctx, uint8_t * buf, int size, int * len ) {
+  if( len==0 ) return aoresult_outargnull;
+  *len= 0;
+  int need= aomw_topo_snapshot_size_ctx(ctx);
+  if( buf==0 || size<need ) return aoresult_outofmem;
+  // Header
+  uint8_t * p= buf;
+  p[0]='A'; p[1]='O'; p[2]='T'; p[3]='P';
+  p[4]= AOMW_TOPO_SNAPSHOT_VERSION;
+  p[5]= ctx->loop ? 1 : 0;
+  aomw_topo_snapshot_put16(p+6, ctx->numnodes);
+  aomw_topo_snapshot_put16(p+8, ctx->numtriplets);
+  aomw_topo_snapshot_put16(p+10, ctx->numi2cbridges);
+  p+= 12;
+  // Tables
+  for( uint16_t addr=1; addr<=ctx->numnodes; addr++ ) {
+    aomw_topo_snapshot_put32(p, aomw_topo_rec_id(ctx, addr)); // skip slot 0
+    p[4]= aomw_topo_rec_numtriplets(ctx, addr);
+    p+= 5;
+  }
+  for( uint16_t tix=0; tix<ctx->numtriplets; tix++ ) {
+    aomw_topo_snapshot_put16(p, ctx->triplet_addr[tix]);
+    p[2]= ctx->triplet_chan[tix];
+    p+= 3;
+  }
+  for( uint16_t iix=0; iix<ctx->numi2cbridges; iix++ ) {
+    aomw_topo_snapshot_put16(p, ctx->i2cbridge_addr[iix]);
+    p+= 2;
+  }
+  // Checksum
+  aomw_topo_snapshot_put32(p, aomw_topo_snapshot_crc(buf,p-buf) );
+  p+= 4;
+  AORESULT_ASSERT( p-buf==need );
+  *len= need;
+  return aoresult_ok;
+}
+
+
+/*!
+    @brief  Imports a snapshot (as made by aomw_topo_snapshot_export) into
+            the "topology map".
+    @param  ctx
+            The context (the chain) to operate on.
+    @param  buf
+            The snapshot.
+    @param  len
+            The size of the snapshot in bytes.
+    @return aoresult_ok          if successful
+            aoresult_comparefail if the length or checksum is wrong
+            aoresult_other       if magic or version is wrong, or the tables are inconsistent
+            aoresult_outofmem    if the snapshot does not fit in the map
+    @note   After a successful import, the map is available (observers work),
+            and the next aomw_topo_build() skips identifying the nodes; it
+            only checks that the chain has the imported number of nodes
+            and direction, and then configures the chain as usual. Later 
+            builds scan again.
+    @note   The whole snapshot is validated before the map is touched;
+            when the import fails, the map is left unchanged.
 */
-void aomw_topo_dump_i2cbridges() {
-  for( uint16_t iix=0; iix<aomw_topo_numi2cbridges_; iix++ ) {
-    Serial.printf("I%d N%03X\n", iix,aomw_topo_i2cbridge_addr(iix) );
+aoresult_t aomw_topo_snapshot_import_ctx( aomw_topo_ctx_t * ctx, const uint8_t * buf, int len ) {
+  // Check envelope
+  if( buf==0 || len<12+4 ) return aoresult_comparefail;
+  if( buf[0]!='A' || buf[1]!='O' || buf[2]!='T' || buf[3]!='P' ) return aoresult_other;
+  if( buf[4]!=AOMW_TOPO_SNAPSHOT_VERSION ) return aoresult_other;
+  int numnodes= aomw_topo_snapshot_get16(buf+6);
+  int numtriplets= aomw_topo_snapshot_get16(buf+8);
+  int numi2cbridges= aomw_topo_snapshot_get16(buf+10);
+  if( len!=aomw_topo_snapshot_size_(numnodes,numtriplets,numi2cbridges) ) return aoresult_comparefail;
+  if( aomw_topo_snapshot_get32(buf+len-4)!=aomw_topo_snapshot_crc(buf,len-4) ) return aoresult_comparefail;
+  if( numnodes>=AOMW_TOPO_MAXNODES || numtriplets>AOMW_TOPO_MAXTRIPLETS || numi2cbridges>AOMW_TOPO_MAXI2CBRIDGES ) return aoresult_outofmem;
+  const uint8_t * nodes= buf+12;
+  const uint8_t * triplets= nodes+5*numnodes;
+  const uint8_t * bridges= triplets+3*numtriplets;
+  // Validate nodes: triplet counts add up, distinct ids fit
+  uint32_t ids[AOMW_TOPO_MAXIDS];
+  int numids= 0;
+  int triplet1= 0;
+  for( int addr=1; addr<=numnodes; addr++ ) {
+    const uint8_t * p= nodes+5*(addr-1);
+    uint32_t id= aomw_topo_snapshot_get32(p);
+    int idix= 0;
+    while( idix<numids && ids[idix]!=id ) idix++;
+    if( idix==numids ) { if( numids>=AOMW_TOPO_MAXIDS ) return aoresult_outofmem; ids[numids++]= id; }
+    if( p[4] > AOMW_TOPO_REC_NUMTRIPLETS>>AOMW_TOPO_REC_NUMTRIPLETS_SHIFT ) return aoresult_other;
+    // Validate the node's triplets: in node order, ascending channels 0..2, or one triplet without channel (RGBI)
+    for( int i=0; i<p[4]; i++ ) {
+      if( triplet1+i>=numtriplets ) return aoresult_other;
+      const uint8_t * t= triplets+3*(triplet1+i);
+      if( aomw_topo_snapshot_get16(t)!=addr ) return aoresult_other;
+      uint8_t chan= t[2];
+      if( chan==AOMW_TOPO_CHAN_NONE ) { if( p[4]!=1 ) return aoresult_other; continue; }
+      if( chan>2 ) return aoresult_other;
+      if( i>0 && chan<=t[-1] ) return aoresult_other;
+    }
+    triplet1+= p[4];
+  }
+  if( triplet1!=numtriplets ) return aoresult_other;
+  // Validate I2C bridges: in node order, channel 2 of a bridge is not a triplet
+  int prev= 0;
+  for( int iix=0; iix<numi2cbridges; iix++ ) {
+    int addr= aomw_topo_snapshot_get16(bridges+2*iix);
+    if( addr<=prev || addr>numnodes ) return aoresult_other;
+    prev= addr;
+  }
+  for( int tix=0, iix=0; tix<numtriplets; tix++ ) {
+    int addr= aomw_topo_snapshot_get16(triplets+3*tix);
+    while( iix<numi2cbridges && aomw_topo_snapshot_get16(bridges+2*iix)<addr ) iix++;
+    if( iix<numi2cbridges && aomw_topo_snapshot_get16(bridges+2*iix)==addr && triplets[3*tix+2]==2 ) return aoresult_other;
+  }
+  // Snapshot is valid; replace the map
+  aomw_topo_prev_save(ctx);
+  aomw_topo_useram(ctx);
+  ctx->numids= 0;
+  triplet1= 0;
+  for( uint16_t addr=1; addr<=numnodes; addr++ ) {
+    const uint8_t * p= nodes+5*(addr-1);
+    int idix= aomw_topo_rec_idix(ctx, aomw_topo_snapshot_get32(p)); // skip slot 0
+    AORESULT_ASSERT( idix>=0 );
+    if( addr%AOMW_TOPO_TRIPLET1_STRIDE==0 ) ctx->node_triplet1s_ram[addr/AOMW_TOPO_TRIPLET1_STRIDE]= triplet1;
+    ctx->node_rec_ram[addr]= AOMW_TOPO_REC_MAKE(idix, p[4], 0, 0); // channels are added from the triplet table
+    triplet1+= p[4];
   }
+  for( uint16_t tix=0; tix<numtriplets; tix++ ) {
+    const uint8_t * p= triplets+3*tix;
+    uint16_t addr= aomw_topo_snapshot_get16(p);
+    ctx->triplet_addr_ram[tix]= addr;
+    ctx->triplet_chan_ram[tix]= p[2];
+    if( p[2]!=AOMW_TOPO_CHAN_NONE ) ctx->node_rec_ram[addr]|= (1<<p[2]) << AOMW_TOPO_REC_CHANMASK_SHIFT;
+  }
+  for( uint16_t iix=0; iix<numi2cbridges; iix++ ) {
+    uint16_t addr= aomw_topo_snapshot_get16(bridges+2*iix);
+    ctx->i2cbridge_addr_ram[iix]= addr;
+    ctx->node_rec_ram[addr]|= AOMW_TOPO_REC_I2CBRIDGE;
+  }
+  // Commit
+  ctx->loop= buf[5];
+  ctx->last= numnodes;
+  ctx->numnodes= numnodes;
+  ctx->numtriplets= numtriplets;
+  ctx->numi2cbridges= numi2cbridges;
+  ctx->preloaded= 1;
+  aomw_topo_hash_compute(ctx);
+  aomw_topo_remap_bake(ctx);
+  ctx->generation++; // map is complete
+  return aoresult_ok;
+}
+
+
+/*!
+    @brief  Returns if the map was imported by aomw_topo_snapshot_import()
+            (or is fixed), in which case the next build skips identifying 
+            the nodes.
+    @note   Once a build has verified an imported map, it is no longer 
+            preloaded; later builds scan the chain again.
+    @param  ctx
+            The context (the chain) to operate on.
+    @return 1 if preloaded, 0 otherwise.
+*/
+int aomw_topo_snapshot_preloaded_ctx( aomw_topo_ctx_t * ctx ) {
+  return ctx->preloaded;
+}
+
+
+// === fixed topology =======================================================
+
+
+/*!
+    @brief  Installs a fixed topology, declared at compile time with 
+            AOMW_TOPO_FIXED(), as the "topology map".
+    @param  ctx
+            The context (the chain) to operate on.
+    @param  fixed
+            The fixed topology; its tables typically live in flash.
+    @note   The tables are not copied; the map refers to them, so they 
+            must be static. The RAM map tables are not used, but the 
+            limits (AOMW_TOPO_MAXNODES, AOMW_TOPO_MAXTRIPLETS) still apply,
+            since the remap and framebuffer tables are in RAM; 
+            AOMW_TOPO_FIXED() checks them at compile time.
+    @note   Like after aomw_topo_snapshot_import(), the next build skips
+            identifying; it only verifies the chain length and direction,
+            and configures the chain. When verification fails, the build returns 
+            aoresult_comparefail, and a next build scans (into RAM).
+*/
+void aomw_topo_fixed_install_ctx( aomw_topo_ctx_t * ctx, const aomw_topo_fixed_t * fixed ) {
+  // The remap, logical triplet and framebuffer tables are in RAM, sized for the limits
+  AORESULT_ASSERT( fixed->numnodes<AOMW_TOPO_MAXNODES && fixed->numtriplets<=AOMW_TOPO_MAXTRIPLETS );
+  aomw_topo_prev_save(ctx);
+  ctx->ids = fixed->ids;
+  ctx->node_rec = fixed->node_rec;
+  ctx->node_triplet1s = fixed->node_triplet1s;
+  ctx->triplet_addr = fixed->triplet_addr;
+  ctx->triplet_chan = fixed->triplet_chan;
+  ctx->i2cbridge_addr = fixed->i2cbridge_addr;
+  ctx->numnodes = fixed->numnodes;
+  ctx->numids = fixed->numids;
+  ctx->numtriplets = fixed->numtriplets;
+  ctx->numi2cbridges = fixed->numi2cbridges;
+  ctx->loop = fixed->loop;
+  ctx->last = fixed->numnodes;
+  ctx->preloaded = 1;
+  aomw_topo_hash_compute(ctx);
+  aomw_topo_remap_bake(ctx);
+  ctx->generation++; // map is complete
 }
 
 
 // === topo build helpers ===================================================
 
 
-static aoresult_t aomw_topo_node_identify(uint16_t addr) {
+// A SAID has three channels, each normally driving an RGB triplet. The 
+// customer OTP (byte 0x0D) configures other uses of the channels: with 
+// I2C_BRIDGE_EN the pins of channel 2 are an I2C bus; with CH_CLUSTERING 
+// channels are wired in parallel and driven by the registers of the first 
+// channel of the cluster. The build reads this byte once per SAID, and only
+// records triplets for the live channels, so that flushes, fills and the 
+// current configuration send no telegrams to channels that drive nothing.
+// Other bits (SYNC_PIN_EN, STAR_NET_EN) do not take channels. Configurations
+// that OTP can not tell (unpopulated channels, a haptic actuator) are set 
+// with aomw_topo_chanmask_override().
+#define AOMW_TOPO_OTP_CHANCFG_ADDR      0x0D // OTP byte with the channel configuration
+#define AOMW_TOPO_OTP_CHANCFG_I2CEN     0x08 // I2C_BRIDGE_EN: channel 2 is an I2C bridge
+#define AOMW_TOPO_OTP_CHANCFG_CLUSTER   0xC0 // CH_CLUSTERING: 0 none, 1 ch0+ch1, 2 ch1+ch2, 3 ch0+ch1+ch2
+#define AOMW_TOPO_OTP_CHANCFG_CLUSTER_SHIFT 6
+
+
+// Returns the live channels (mask) of a SAID from its OTP channel configuration byte (I2C bridge not yet removed).
+static uint8_t aomw_topo_chanmask_otp( uint8_t otp ) {
+  static const uint8_t masks[4] = { 0x07, 0x05, 0x03, 0x01 }; // The cluster is driven by its first channel
+  return masks[ (otp & AOMW_TOPO_OTP_CHANCFG_CLUSTER) >> AOMW_TOPO_OTP_CHANCFG_CLUSTER_SHIFT ];
+}
+
+
+static aoresult_t aomw_topo_node_identify( aomw_topo_ctx_t * ctx, uint16_t addr ) {
   // Get the id of the node
   uint32_t id;
+  AOMW_TRACE(AOMW_TRACE_TYPE_IDENTIFY, addr, 0xFF, 0, 0, 0);
   aoresult_t result = aoosp_send_identify( addr, &id );
   if( result!=aoresult_ok ) return result;
   // Record the node's id (if there is still space)
-  aomw_topo_numnodes_++; // 1-based, so pre-increment
-  AORESULT_ASSERT(addr==aomw_topo_numnodes_);
-  if( aomw_topo_numnodes_>=AOMW_TOPO_MAXNODES ) return aoresult_outofmem;
-  aomw_topo_node_id_[aomw_topo_numnodes_] = id;
-  aomw_topo_node_triplet1_[aomw_topo_numnodes_] = aomw_topo_numtriplets_;
+  ctx->numnodes++; // 1-based, so pre-increment
+  AORESULT_ASSERT(addr==ctx->numnodes);
+  if( ctx->numnodes>=AOMW_TOPO_MAXNODES ) return aoresult_outofmem;
+  int idix= aomw_topo_rec_idix(ctx, id);
+  if( idix<0 ) return aoresult_outofmem;
+  if( ctx->numnodes%AOMW_TOPO_TRIPLET1_STRIDE==0 ) ctx->node_triplet1s_ram[ctx->numnodes/AOMW_TOPO_TRIPLET1_STRIDE] = ctx->numtriplets;
+  uint8_t numtriplets= 0;
+  uint8_t chanmask= 0; // RGBI: no channels
+  uint16_t flags= 0;
   // Register the triplets of the node
   if( AOOSP_IDENTIFY_IS_RGBI(id) ) { // RGBI: one triplet, no channel.
     // Record the triplet's address and channel (if there is still space)
-    if( aomw_topo_numtriplets_>=AOMW_TOPO_MAXTRIPLETS ) return aoresult_outofmem;
-    aomw_topo_triplet_addr_[aomw_topo_numtriplets_] = addr;
-    aomw_topo_triplet_chan_[aomw_topo_numtriplets_] = AOMW_TOPO_CHAN_NONE;
-    aomw_topo_numtriplets_++;
-    aomw_topo_node_numtriplets_[aomw_topo_numnodes_] = 1;
-  } else if( AOOSP_IDENTIFY_IS_SAID(id) ) { // SAID: three triplets, or two plus I2C bridge
-    // Record the channel 0 triplet's address and channel (if there is still space)
-    if( aomw_topo_numtriplets_>=AOMW_TOPO_MAXTRIPLETS ) return aoresult_outofmem;
-    aomw_topo_triplet_addr_[aomw_topo_numtriplets_] = addr;
-    aomw_topo_triplet_chan_[aomw_topo_numtriplets_] = 0;
-    aomw_topo_numtriplets_++;
-    // Record the channel 1 triplet's address and channel (if there is still space)
-    if( aomw_topo_numtriplets_>=AOMW_TOPO_MAXTRIPLETS ) return aoresult_outofmem;
-    aomw_topo_triplet_addr_[aomw_topo_numtriplets_] = addr;
-    aomw_topo_triplet_chan_[aomw_topo_numtriplets_] = 1;
-    aomw_topo_numtriplets_++;
-    // Is channel 2 of this SAID wired for I2C?
-    // todo: also inspect other config bits to skip channels (haptic, sync, star, clustering?)
-    int isbridge;
-    result = aoosp_exec_i2cenable_get(addr, &isbridge );
+    if( ctx->numtriplets>=AOMW_TOPO_MAXTRIPLETS ) return aoresult_outofmem;
+    ctx->triplet_addr_ram[ctx->numtriplets] = addr;
+    ctx->triplet_chan_ram[ctx->numtriplets] = AOMW_TOPO_CHAN_NONE;
+    ctx->numtriplets++;
+    numtriplets= 1;
+  } else if( AOOSP_IDENTIFY_IS_SAID(id) ) { // SAID: a triplet per live channel, channel 2 may be an I2C bridge
+    // Read the channel configuration once (I2C bridge, clustering) from OTP
+    uint8_t otp;
+    AOMW_TRACE(AOMW_TRACE_TYPE_I2CENABLE, addr, 0xFF, 0, 0, 0);
+    result = aoosp_send_readotp(addr, AOMW_TOPO_OTP_CHANCFG_ADDR, &otp, 1);
     if( result!=aoresult_ok ) return result;
-    if( isbridge ) {
+    chanmask= aomw_topo_chanmask_otp(otp);
+    if( ctx->chanmask_override[addr] & AOMW_TOPO_CHANMASK_OVERRIDE ) chanmask= ctx->chanmask_override[addr] & AOMW_TOPO_CHANMASK_ALL;
+    if( otp & AOMW_TOPO_OTP_CHANCFG_I2CEN ) {
       // Record the I2C bridge's address (if there is still space)
-      if( aomw_topo_numi2cbridges_>=AOMW_TOPO_MAXI2CBRIDGES ) return aoresult_outofmem;
-      aomw_topo_i2cbridge_addr_[aomw_topo_numi2cbridges_] = addr;
-      aomw_topo_numi2cbridges_ ++;
-      aomw_topo_node_numtriplets_[aomw_topo_numnodes_] = 2;
-    } else {
-      // Record the channel 2 triplet's address and channel (if there is still space)
-      if( aomw_topo_numtriplets_>=AOMW_TOPO_MAXTRIPLETS ) return aoresult_outofmem;
-      aomw_topo_triplet_addr_[aomw_topo_numtriplets_] = addr;
-      aomw_topo_triplet_chan_[aomw_topo_numtriplets_] = 2;
-      aomw_topo_numtriplets_++;
-      aomw_topo_node_numtriplets_[aomw_topo_numnodes_] = 3;
+      if( ctx->numi2cbridges>=AOMW_TOPO_MAXI2CBRIDGES ) return aoresult_outofmem;
+      ctx->i2cbridge_addr_ram[ctx->numi2cbridges] = addr;
+      ctx->numi2cbridges ++;
+      flags |= AOMW_TOPO_REC_I2CBRIDGE;
+      chanmask &= ~(1<<2); // channel 2 pins are the I2C bus, even with an override
+    }
+    // Record the address and channel of the triplet on each live channel (if there is still space)
+    for( uint8_t chan=0; chan<3; chan++ ) {
+      if( !(chanmask & (1<<chan)) ) continue;
+      if( ctx->numtriplets>=AOMW_TOPO_MAXTRIPLETS ) return aoresult_outofmem;
+      ctx->triplet_addr_ram[ctx->numtriplets] = addr;
+      ctx->triplet_chan_ram[ctx->numtriplets] = chan;
+      ctx->numtriplets++;
+      numtriplets++;
     }
   } else { // Unknown id
     return aoresult_sys_id; // Or shall we ignore the node, instead of giving error
   }
+  ctx->node_rec_ram[ctx->numnodes] = AOMW_TOPO_REC_MAKE(idix, numtriplets, chanmask, flags);
+  ctx->hash= aomw_topo_hash_node(ctx->hash, id, numtriplets, chanmask);
   return aoresult_ok;
 }
 
 
-static aoresult_t aomw_topo_node_enablecrc(uint16_t addr) {
+static aoresult_t aomw_topo_node_enablecrc( aomw_topo_ctx_t * ctx, uint16_t addr ) {
   aoresult_t result;
-  if( AOOSP_IDENTIFY_IS_RGBI(aomw_topo_node_id_[addr]) ) {
+  uint32_t id= aomw_topo_rec_id(ctx, addr);
+  if( AOOSP_IDENTIFY_IS_RGBI(id) ) {
+    AOMW_TRACE(AOMW_TRACE_TYPE_SETSETUP, addr, 0xFF, AOOSP_SETUP_FLAGS_RGBI_DFLT | AOOSP_SETUP_FLAGS_CRCEN, 0, 0);
     result= aoosp_send_setsetup(addr, AOOSP_SETUP_FLAGS_RGBI_DFLT | AOOSP_SETUP_FLAGS_CRCEN );
-  } else if( AOOSP_IDENTIFY_IS_SAID(aomw_topo_node_id_[addr]) ) {
+  } else if( AOOSP_IDENTIFY_IS_SAID(id) ) {
+    AOMW_TRACE(AOMW_TRACE_TYPE_SETSETUP, addr, 0xFF, AOOSP_SETUP_FLAGS_SAID_DFLT | AOOSP_SETUP_FLAGS_CRCEN, 0, 0);
     result= aoosp_send_setsetup(addr, AOOSP_SETUP_FLAGS_SAID_DFLT | AOOSP_SETUP_FLAGS_CRCEN );
   } else {
     result= aoresult_sys_id; // Or shall we ignore the node, instead of giving error
@@ -394,9 +1231,10 @@ static aoresult_t aomw_topo_node_enablecrc(uint16_t addr) {
 }
 
 
-static aoresult_t aomw_topo_i2cbridge_power(int iix) {
+static aoresult_t aomw_topo_i2cbridge_power( aomw_topo_ctx_t * ctx, int iix ) {
   // Supply current to I2C pads (channel 2)
-  return aoosp_send_setcurchn( aomw_topo_i2cbridge_addr_[iix], /*chan*/2, AOOSP_CURCHN_FLAGS_DEFAULT,  4, 4, 4);
+  AOMW_TRACE(AOMW_TRACE_TYPE_SETCURCHN, ctx->i2cbridge_addr[iix], 2, AOOSP_CURCHN_FLAGS_DEFAULT, 4<<8|4, 4);
+  return aoosp_send_setcurchn( ctx->i2cbridge_addr[iix], /*chan*/2, AOOSP_CURCHN_FLAGS_DEFAULT,  4, 4, 4);
 }
 
 
@@ -405,6 +1243,8 @@ static aoresult_t aomw_topo_i2cbridge_power(int iix) {
             in all OSP nodes (to ~10mA), not to be changed by client code. 
             However SAIDs have some flags in the CURRENT register, like
             AOOSP_CURCHN_FLAGS_DITHER, that can be changed by this function.
+    @param  ctx
+            The context (the chain) to operate on.
     @param  addr
             The address of the OSP node.
     @param  flags
@@ -414,8 +1254,10 @@ static aoresult_t aomw_topo_i2cbridge_power(int iix) {
             other error code if there is a (communications) error
     @note   Only available after aomw_topo_build() - or start/step.
     @note   addr is 1-based, so 1 <= addr <= aomw_topo_numnodes().
+    @note   Only the channels that drive a triplet are configured, see 
+            aomw_topo_node_chanmask().
 */
-aoresult_t aomw_topo_node_setcurrents(uint16_t addr, uint8_t flags) {
+aoresult_t aomw_topo_node_setcurrents_ctx( aomw_topo_ctx_t * ctx, uint16_t addr, uint8_t flags ) {
   aoresult_t result;
   // To make all triplets have the same brightness, we select a "base current"
   // with which all channels of all nodes are driven. The base current topo
@@ -429,23 +1271,20 @@ aoresult_t aomw_topo_node_setcurrents(uint16_t addr, uint8_t flags) {
   //   chn1 1.5mA 3mA  6mA 12mA 24mA
   //   chn2 1.5mA 3mA  6mA 12mA 24mA
 
-  if(   AOOSP_IDENTIFY_IS_RGBI(aomw_topo_node_id_[addr]) ) return aoresult_ok;     // Skip RGBI's
-  if( ! AOOSP_IDENTIFY_IS_SAID(aomw_topo_node_id_[addr]) ) return aoresult_sys_id; // Or shall we ignore the node, instead of giving error
-
-  // Channel 0 is high power, so we select current level 2 (3x12mA)
-  result= aoosp_send_setcurchn(addr, 0, flags, 2, 2, 2);
-  if( result!=aoresult_ok) return result;
-
-  // Channel 1 is low power, so we select current level 3 (3x12mA)
-  result= aoosp_send_setcurchn(addr, 1, flags, 3, 3, 3);
-  if( result!=aoresult_ok) return result;
-
-  // Is channel 2 in use for a triplet? If it is used for I2C bridge, bail out
-  if( aomw_topo_node_numtriplets_[addr]==2 ) return aoresult_ok;
-
-  // Channel 2 is low power, so we select current level 3 (3x12mA)
-  result= aoosp_send_setcurchn(addr, 2, flags, 3, 3, 3);
-  if( result!=aoresult_ok) return result;
+  uint32_t id= aomw_topo_rec_id(ctx, addr);
+  if(   AOOSP_IDENTIFY_IS_RGBI(id) ) return aoresult_ok;     // Skip RGBI's
+  if( ! AOOSP_IDENTIFY_IS_SAID(id) ) return aoresult_sys_id; // Or shall we ignore the node, instead of giving error
+
+  // Only live channels (that drive a triplet, not an I2C bridge) get a current
+  uint16_t tix1= aomw_topo_rec_triplet1(ctx, addr);
+  for( uint16_t tix=tix1; tix<tix1+aomw_topo_rec_numtriplets(ctx, addr); tix++ ) {
+    uint8_t chan= ctx->triplet_chan[tix];
+    // Channel 0 is high power, so we select current level 2 (3x12mA); channels 1 and 2 are low power, level 3 (3x12mA)
+    uint8_t cur= chan==0 ? 2 : 3;
+    AOMW_TRACE(AOMW_TRACE_TYPE_SETCURCHN, addr, chan, flags, cur<<8|cur, cur);
+    result= aoosp_send_setcurchn(addr, chan, flags, cur, cur, cur);
+    if( result!=aoresult_ok) return result;
+  }
 
   return aoresult_ok;
 }
@@ -463,33 +1302,49 @@ typedef enum aomw_topo_build_state_e {
   AOMW_TOPO_BUILD_STATE_CONFIGI2CPOWER,
   AOMW_TOPO_BUILD_STATE_CONFIGSETCURRENT,
   AOMW_TOPO_BUILD_STATE_CONFIGGOACTIVE,
+  AOMW_TOPO_BUILD_STATE_SCENELOAD,
+  AOMW_TOPO_BUILD_STATE_SCENESTREAM,
   AOMW_TOPO_BUILD_STATE_DONE,
 } aomw_topo_build_state_t;
 
 
-static aomw_topo_build_state_t aomw_topo_build_state;    // current state
-static aoresult_t              aomw_topo_build_result;   // persistent storage of last result (when state==AOMW_TOPO_BUILD_STATE_DONE)
-static int                     aomw_topo_build_substate; // Some states iterate over all nodes or all I2C bridges, this is used to keep track of which
-#define ADDR                   aomw_topo_build_substate  // an alias to make more clear what is iterated over in a state
-#define BIX                    aomw_topo_build_substate  // an alias to make more clear what is iterated over in a state
+// Scene restore (see section scene), used by the build
+#define AOMW_TOPO_SCENE_LOAD_NONE    0 // There is no (valid) scene to restore
+#define AOMW_TOPO_SCENE_LOAD_BUSY    1 // Loading, call load step again
+#define AOMW_TOPO_SCENE_LOAD_LOADED  2 // Scene loaded, ready to stream
+static void       aomw_topo_scene_loadstart( aomw_topo_ctx_t * ctx );
+static int        aomw_topo_scene_loadstep( aomw_topo_ctx_t * ctx );
+static aoresult_t aomw_topo_scene_streamstep( aomw_topo_ctx_t * ctx );
+static int        aomw_topo_scene_streamdone( aomw_topo_ctx_t * ctx );
+
+
+#define ADDR                   ctx->build_substate  // an alias to make more clear what is iterated over in a state
+#define BIX                    ctx->build_substate  // an alias to make more clear what is iterated over in a state
 
 
 /*!
     @brief  This function is part of the topology builder.
             Call this once, then follow up with aomw_topo_build_step().
+    @param  ctx
+            The context (the chain) to operate on.
     @note   Building might be redone, as long as it begins with start().
     @note   To build the topology map (fill the topo data model), several 
             telegrams need to be send to the chain, to individual nodes or 
-            even to channels: reset, init, identify, readotp (for i2c bridge), 
+            even to channels: reset, init, identify, readotp (channel configuration), 
             clrerror, setsetup (enable crc), setcurrent, goactive.
             If all those telegrams would be sent in one function, the runtime
             of that function would be rather long (for long OSP chains). 
             Therefore this API offers start/step/done, each sending 
             approximately one telegram per call. If the long run-time is of 
             no concern, call the convenience function aomw_topo_build().
+    @note   When the map was imported (aomw_topo_snapshot_import), the 
+            build skips identifying, and fails with aoresult_comparefail
+            when the chain length differs (a next build then scans).
+    @note   When a scene is configured (aomw_topo_scene_boot), the build
+            ends with loading it from EEPROM and sending it to the chain.
 */
-void aomw_topo_build_start() {
-  aomw_topo_build_state= AOMW_TOPO_BUILD_STATE_START;
+void aomw_topo_build_start_ctx( aomw_topo_ctx_t * ctx ) {
+  ctx->build_state= AOMW_TOPO_BUILD_STATE_START;
 }
 
 
@@ -497,88 +1352,139 @@ void aomw_topo_build_start() {
     @brief  This function is part of the topology builder.
             Call this until aomw_topo_build_done(), but after 
             aomw_topo_build_start().
+    @param  ctx
+            The context (the chain) to operate on.
     @return aoresult_ok      if successful
             other error code if there is a (communications) error
     @note   Send telegrams, approximately one per step() call.
 */
-#define ON_ERROR_RETURN() do { if( result!=aoresult_ok ) { aomw_topo_build_result=result; aomw_topo_build_state=AOMW_TOPO_BUILD_STATE_DONE; return result; } } while(0)
-aoresult_t aomw_topo_build_step() {
+#define ON_ERROR_RETURN() do { if( result!=aoresult_ok ) { ctx->build_result=result; ctx->build_state=AOMW_TOPO_BUILD_STATE_DONE; return result; } } while(0)
+aoresult_t aomw_topo_build_step_ctx( aomw_topo_ctx_t * ctx ) {
   aoresult_t result;
+  int loop;
 
-  switch( aomw_topo_build_state ) {
+  switch( ctx->build_state ) {
 
     case AOMW_TOPO_BUILD_STATE_START:
       // reset & init entire chain
-      result= aoosp_exec_resetinit(&aomw_topo_last_, &aomw_topo_loop_); ON_ERROR_RETURN();
+      loop= ctx->loop; // direction of a preloaded map
+      result= aoosp_exec_resetinit(&ctx->last, &ctx->loop); ON_ERROR_RETURN();
+      AOMW_TRACE(AOMW_TRACE_TYPE_RESETINIT, ctx->last, 0xFF, ctx->loop, 0, 0);
+      aomw_topo_fb_clear(ctx); // reset switched all triplets off
+      // with an imported map, skip identifying when the chain length and direction match
+      if( ctx->preloaded ) {
+        aomw_topo_prev_save(ctx); // a verified build does not change the map
+        if( ctx->last!=ctx->numnodes || ctx->loop!=loop ) { ctx->preloaded=0; result=aoresult_comparefail; ON_ERROR_RETURN(); }
+        if( ctx->ids==ctx->ids_ram ) ctx->preloaded= 0; // imported map is verified, later builds scan again (a fixed map stays)
+        ctx->build_state= AOMW_TOPO_BUILD_STATE_CONFIGCLRERROR;
+        return aoresult_ok;
+      }
       // prep next state (clear database)
-      aomw_topo_numnodes_ = 0;
-      aomw_topo_numtriplets_ = 0;
-      aomw_topo_numi2cbridges_ = 0;
-      ADDR=1; // nodes to scan: 1<=ADDR<=aomw_topo_last_
-      aomw_topo_build_state= AOMW_TOPO_BUILD_STATE_IDENTIFYING;
+      aomw_topo_prev_save(ctx);
+      aomw_topo_useram(ctx);
+      ctx->hash= AOMW_TOPO_HASH_INIT;
+      ctx->numnodes = 0;
+      ctx->numids = 0;
+      ctx->numtriplets = 0;
+      ctx->numi2cbridges = 0;
+      aomw_topo_remap_clear(ctx); // a failed build must not leave a remap of the old map
+      ctx->generation++;
+      ADDR=1; // nodes to scan: 1<=ADDR<=ctx->last
+      ctx->build_state= AOMW_TOPO_BUILD_STATE_IDENTIFYING;
       return aoresult_ok;
 
     case AOMW_TOPO_BUILD_STATE_IDENTIFYING:
       // Scan node (get its id, get number of triplets)
-      if( ADDR<=aomw_topo_last_ ) { // nodes to scan: 1<=ADDR<=aomw_topo_last_
-        result= aomw_topo_node_identify(ADDR++); ON_ERROR_RETURN();
+      if( ADDR<=ctx->last ) { // nodes to scan: 1<=ADDR<=ctx->last
+        result= aomw_topo_node_identify(ctx, ADDR++); ON_ERROR_RETURN();
         return aoresult_ok; // loop
       }
-      AORESULT_ASSERT( aomw_topo_last_==aomw_topo_numnodes_);
+      AORESULT_ASSERT( ctx->last==ctx->numnodes);
+      aomw_topo_remap_bake(ctx);
+      ctx->generation++; // map is complete
       // prep next state
-      aomw_topo_build_state= AOMW_TOPO_BUILD_STATE_CONFIGCLRERROR;
+      ctx->build_state= AOMW_TOPO_BUILD_STATE_CONFIGCLRERROR;
       return aoresult_ok;
 
     case AOMW_TOPO_BUILD_STATE_CONFIGCLRERROR:
       // Broadcast clear error (to clear the over voltage flag of all SAIDs), must have, otherwise SAID will not go ACTIVE
+      AOMW_TRACE(AOMW_TRACE_TYPE_CLRERROR, 0, 0xFF, 0, 0, 0);
       result= aoosp_send_clrerror(0); ON_ERROR_RETURN();
       // prep next state
-      aomw_topo_build_state= AOMW_TOPO_BUILD_STATE_CONFIGENABLECRC;
-      ADDR=1; // nodes to enable CRC checking for: 1<=ADDR<=aomw_topo_last_
+      ctx->build_state= AOMW_TOPO_BUILD_STATE_CONFIGENABLECRC;
+      ADDR=1; // nodes to enable CRC checking for: 1<=ADDR<=ctx->last
       return aoresult_ok;
 
     case AOMW_TOPO_BUILD_STATE_CONFIGENABLECRC:
       // Enable CRC for all nodes (could be skipped)
-      if( ADDR <= aomw_topo_last_ ) { // nodes to enable CRC checking for: 1<=ADDR<=aomw_topo_last_
-        result= aomw_topo_node_enablecrc(ADDR++); ON_ERROR_RETURN();
+      if( ADDR <= ctx->last ) { // nodes to enable CRC checking for: 1<=ADDR<=ctx->last
+        result= aomw_topo_node_enablecrc(ctx, ADDR++); ON_ERROR_RETURN();
         return aoresult_ok; // loop
       }
       // prep next state
-      BIX=0; // I2C bridges to power: 0<=BIX<aomw_topo_numi2cbridges_
-      aomw_topo_build_state= AOMW_TOPO_BUILD_STATE_CONFIGI2CPOWER;
+      BIX=0; // I2C bridges to power: 0<=BIX<ctx->numi2cbridges
+      ctx->build_state= AOMW_TOPO_BUILD_STATE_CONFIGI2CPOWER;
       return aoresult_ok;
 
     case AOMW_TOPO_BUILD_STATE_CONFIGI2CPOWER:
       // Every I2C bridge needs its pads powered
-      if( BIX < aomw_topo_numi2cbridges_ ) { // I2C bridges to power: 0<=BIX<aomw_topo_numi2cbridges_
-        result= aomw_topo_i2cbridge_power(BIX++); ON_ERROR_RETURN();
+      if( BIX < ctx->numi2cbridges ) { // I2C bridges to power: 0<=BIX<ctx->numi2cbridges
+        result= aomw_topo_i2cbridge_power(ctx, BIX++); ON_ERROR_RETURN();
         return aoresult_ok; // loop
       }
       // prep next state
-      ADDR=1; // nodes to set PWM current: 1<=ADDR<=aomw_topo_last_
-      aomw_topo_build_state= AOMW_TOPO_BUILD_STATE_CONFIGSETCURRENT;
+      ADDR=1; // nodes to set PWM current: 1<=ADDR<=ctx->last
+      ctx->build_state= AOMW_TOPO_BUILD_STATE_CONFIGSETCURRENT;
       return aoresult_ok;
 
     case AOMW_TOPO_BUILD_STATE_CONFIGSETCURRENT:
       // Set the current level of the PWM drivers
-      if( ADDR <= aomw_topo_last_ ) { // nodes to set PWM current: 1<=ADDR<=aomw_topo_last_
-        result= aomw_topo_node_setcurrents(ADDR++,AOOSP_CURCHN_FLAGS_DITHER); ON_ERROR_RETURN();
+      if( ADDR <= ctx->last ) { // nodes to set PWM current: 1<=ADDR<=ctx->last
+        result= aomw_topo_node_setcurrents_ctx(ctx, ADDR++,AOOSP_CURCHN_FLAGS_DITHER | (ctx->sync ? AOOSP_CURCHN_FLAGS_SYNCEN : 0) ); ON_ERROR_RETURN();
         return aoresult_ok; // loop
       }
       // prep next state
-      aomw_topo_build_state= AOMW_TOPO_BUILD_STATE_CONFIGGOACTIVE;
+      ctx->build_state= AOMW_TOPO_BUILD_STATE_CONFIGGOACTIVE;
       return aoresult_ok;
 
     case AOMW_TOPO_BUILD_STATE_CONFIGGOACTIVE:
       // Switch all nodes to active (LEDs on)
+      AOMW_TRACE(AOMW_TRACE_TYPE_GOACTIVE, 0, 0xFF, 0, 0, 0);
       result= aoosp_send_goactive(0); ON_ERROR_RETURN();
       // prep next state
-      aomw_topo_build_result= aoresult_ok;
-      aomw_topo_build_state= AOMW_TOPO_BUILD_STATE_DONE;
+      aomw_topo_scene_loadstart(ctx);
+      ctx->build_state= AOMW_TOPO_BUILD_STATE_SCENELOAD;
+      return aoresult_ok;
+
+    case AOMW_TOPO_BUILD_STATE_SCENELOAD:
+      // Load the scene to restore (if any, see aomw_topo_scene_boot) from EEPROM, a chunk per step
+      switch( aomw_topo_scene_loadstep(ctx) ) {
+        case AOMW_TOPO_SCENE_LOAD_BUSY: 
+          return aoresult_ok; // loop
+        case AOMW_TOPO_SCENE_LOAD_LOADED: 
+          ctx->build_state= AOMW_TOPO_BUILD_STATE_SCENESTREAM;
+          return aoresult_ok;
+      }
+      // prep next state (no scene to restore)
+      ctx->build_result= aoresult_ok;
+      ctx->build_state= AOMW_TOPO_BUILD_STATE_DONE;
+      return aoresult_ok;
+
+    case AOMW_TOPO_BUILD_STATE_SCENESTREAM:
+      // Send the scene, one triplet per step
+      if( !aomw_topo_scene_streamdone(ctx) ) {
+        result= aomw_topo_scene_streamstep(ctx); ON_ERROR_RETURN();
+        return aoresult_ok; // loop
+      }
+      // In sync mode the SAIDs latched the scene; show it
+      if( ctx->sync ) { result= aomw_topo_sync_ctx(ctx); ON_ERROR_RETURN(); }
+      // prep next state
+      ctx->build_result= aoresult_ok;
+      ctx->build_state= AOMW_TOPO_BUILD_STATE_DONE;
       return aoresult_ok;
 
     case AOMW_TOPO_BUILD_STATE_DONE:
-      return aomw_topo_build_result;
+      return ctx->build_result;
   }
 
   return aoresult_assert; // should never reach this
@@ -589,38 +1495,147 @@ aoresult_t aomw_topo_build_step() {
     @brief  This function is part of the topology builder.
             Call this after aomw_topo_build_step(), to determine if
             another step() is needed.
+    @param  ctx
+            The context (the chain) to operate on.
     @return 1   if no more step is neededaoresult_ok
             0   if another aomw_topo_build_step() is needed
 */
-int aomw_topo_build_done() {
-  return aomw_topo_build_state==AOMW_TOPO_BUILD_STATE_DONE;
+int aomw_topo_build_done_ctx( aomw_topo_ctx_t * ctx ) {
+  return ctx->build_state==AOMW_TOPO_BUILD_STATE_DONE;
 }
 
 
 /*!
     @brief  This function is a high level wrapper around the fine grain
             topology builder functions.
+    @param  ctx
+            The context (the chain) to operate on.
     @return aoresult_ok      if successful
             other error code if there is a (communications) error
     @note   Send many telegrams, several per OSP node.
     @note   See aomw_topo_build_start().
 */
-aoresult_t aomw_topo_build() {
+aoresult_t aomw_topo_build_ctx( aomw_topo_ctx_t * ctx ) {
   aoresult_t result;
-  aomw_topo_build_start();
-  while( !aomw_topo_build_done() ) {
-    result= aomw_topo_build_step();
+  aomw_topo_build_start_ctx(ctx);
+  while( !aomw_topo_build_done_ctx(ctx) ) {
+    result= aomw_topo_build_step_ctx(ctx);
     if( result!=aoresult_ok ) return result;
   }
   return aoresult_ok;
 }
 
 
-// === color helpers ========================================================
+// === telegram cost ========================================================
+
+
+// The time to send a pwm telegram depends on the telegram type, the SPI 
+// clock, the MCU, and (with trace enabled) on tracing. Instead of 
+// configuring it, topo measures every pwm telegram it sends and keeps per
+// telegram type an exponentially weighted moving average (EWMA). From that,
+// it predicts how long sending a number of triplets takes, so that an 
+// application (or the scheduler, see aomw_sched_autoperiod) can pick a 
+// frame period that the chain sustains.
+
+
+#define AOMW_TOPO_COST_SHIFT 3 // Weight of a new sample in the EWMA is 1/2^3
+#define AOMW_TOPO_COST_FRAC  4 // The EWMA is kept in 1/2^4 us
+
+
+// Adds a sample of `us` micro seconds for a telegram of type `type` (AOMW_TOPO_COST_XXX).
+static void aomw_topo_cost_add( aomw_topo_ctx_t * ctx, int type, uint32_t us ) {
+  int32_t sample= us << AOMW_TOPO_COST_FRAC;
+  if( ctx->cost[type]==0 ) { ctx->cost[type]= sample | 1; return; } // first sample (|1 keeps it non-zero)
+  int32_t cost= ctx->cost[type];
+  ctx->cost[type]= cost + ( (sample-cost) >> AOMW_TOPO_COST_SHIFT );
+  if( ctx->cost[type]==0 ) ctx->cost[type]= 1;
+}
+
 
+// Returns the cost of a telegram type in 1/16 us; when that type has no samples, the cost of the other type (or 0).
+static uint32_t aomw_topo_cost_get( aomw_topo_ctx_t * ctx, int type ) {
+  if( ctx->cost[type]!=0 ) return ctx->cost[type];
+  return ctx->cost[1-type];
+}
+
+
+/*!
+    @brief  Returns the measured cost of a pwm telegram.
+    @param  ctx
+            The context (the chain) to operate on.
+    @param  type
+            AOMW_TOPO_COST_SETPWM (RGBI) or AOMW_TOPO_COST_SETPWMCHN (SAID).
+    @return The moving average of the send time in micro seconds, 
+            0 when no telegram of that type was sent yet.
+    @note   Every pwm telegram topo sends (settriplet, range and zone fill,
+            framebuffer flush) is measured; a new sample weighs 1/8.
+*/
+uint32_t aomw_topo_cost_us_ctx( aomw_topo_ctx_t * ctx, int type ) {
+  AORESULT_ASSERT( 0<=type && type<AOMW_TOPO_COST_NUM );
+  return ctx->cost[type] >> AOMW_TOPO_COST_FRAC;
+}
+
+
+/*!
+    @brief  Forgets the measured costs (e.g. after changing the SPI clock).
+    @param  ctx
+            The context (the chain) to operate on.
+*/
+void aomw_topo_cost_reset_ctx( aomw_topo_ctx_t * ctx ) {
+  for( int type=0; type<AOMW_TOPO_COST_NUM; type++ ) ctx->cost[type]= 0;
+}
+
+
+/*!
+    @brief  Predicts the time to send `numtriplets` triplets.
+    @param  ctx
+            The context (the chain) to operate on.
+    @param  numtriplets
+            The number of triplets (e.g. the number of dirty triplets, or 
+            aomw_topo_numtriplets() for a full frame).
+    @return The predicted time in micro seconds (0 when nothing was 
+            measured yet).
+    @note   Uses the mix of RGBI and SAID triplets of the chain; for the 
+            exact mix of the dirty triplets see aomw_topo_fb_predict_us().
+*/
+uint32_t aomw_topo_predict_us_ctx( aomw_topo_ctx_t * ctx, int numtriplets ) {
+  if( ctx->numtriplets==0 || numtriplets<=0 ) return 0;
+  if( ctx->numonchan_generation!=ctx->generation ) {
+    ctx->numonchan= 0;
+    for( uint16_t tix=0; tix<ctx->numtriplets; tix++ ) if( ctx->triplet_chan[tix]!=AOMW_TOPO_CHAN_NONE ) ctx->numonchan++;
+    ctx->numonchan_generation= ctx->generation;
+  }
+  uint32_t sum= ctx->numonchan * aomw_topo_cost_get(ctx, AOMW_TOPO_COST_SETPWMCHN)
+              + (ctx->numtriplets-ctx->numonchan) * aomw_topo_cost_get(ctx, AOMW_TOPO_COST_SETPWM); // cost of all triplets
+  return (uint64_t)sum * numtriplets / ctx->numtriplets >> AOMW_TOPO_COST_FRAC;
+}
+
+
+/*!
+    @brief  Predicts the time aomw_topo_fb_flush() takes now.
+    @param  ctx
+            The context (the chain) to operate on.
+    @return The predicted time in micro seconds (0 when nothing is dirty 
+            or nothing was measured yet).
+    @note   Walks the dirty triplets, so it takes the exact mix of RGBI 
+            and SAID triplets into account.
+*/
+uint32_t aomw_topo_fb_predict_us_ctx( aomw_topo_ctx_t * ctx ) {
+  uint32_t sum= 0;
+  int numwords= (ctx->remap_num+31)/32;
+  for( int wix=0; wix<numwords; wix++ ) {
+    uint32_t bits= ctx->fb_dirty[wix];
+    while( bits ) {
+      uint16_t ptix= wix*32 + __builtin_ctzl(bits);
+      bits &= bits-1;
+      sum+= aomw_topo_cost_get(ctx, ctx->triplet_chan[ptix]==AOMW_TOPO_CHAN_NONE ? AOMW_TOPO_COST_SETPWM : AOMW_TOPO_COST_SETPWMCHN );
+    }
+  }
+  return sum >> AOMW_TOPO_COST_FRAC;
+}
 
-// The over all dim level used in aomw_topo_settriplet (0..1024).
-static int aomw_topo_dim = AOMW_TOPO_DIM_DEFAULT;
+
+// === color helpers ========================================================
 
 
 // We define some standard colors.
@@ -634,17 +1649,171 @@ extern const aomw_topo_rgb_t aomw_topo_white  = { 0x7FFF,0x7FFF,0x7FFF, "white"
 extern const aomw_topo_rgb_t aomw_topo_off    = { 0x0000,0x0000,0x0000, "off" };
 
 
-/*!
-    @brief  Sets the color for triplet `tix` to `rgb`.
-    @param  tix
-            The index of the triplet.
-    @param  rgb
-            A topo color, each component (red, green, blue) has a brightness 
+// Sends the (already dimmed) pwm values r/g/b to the triplet on node addr, channel chan (AOMW_TOPO_CHAN_NONE for RGBI)
+static aoresult_t aomw_topo_sendaddrchan( aomw_topo_ctx_t * ctx, uint16_t addr, uint8_t chan, uint16_t r, uint16_t g, uint16_t b ) {
+  aoresult_t result;
+  // This is a bit of a shortcut. When the triplet is "on a channel" we
+  // equate that to needing a setpwmchn telegram. In a context of only
+  // two kinds of nodes known at the moment (SAID and RGBI) that is enough.
+  if( chan!=AOMW_TOPO_CHAN_NONE ) {
+    // Triplet to configure is an external one driven by a SAID. The PWM 
+    // register contains a 15-bit PWM value followed by a 1 bit LSB-dithering
+    // control. Use the 15-bits of "topo brightness range" and no dithering (<<1).
+    AOMW_TRACE(AOMW_TRACE_TYPE_SETPWMCHN, addr, chan, r, g, b);
+    uint32_t t0= micros();
+    result= aoosp_send_setpwmchn(addr, chan, r << 1, g << 1, b << 1 );
+    aomw_topo_cost_add(ctx, AOMW_TOPO_COST_SETPWMCHN, micros()-t0);
+  } else {
+    // Triplet to configure is an RGBI. The PWM register contains a 1-bit drive 
+    // current (0=10mA=nightmode, 1=50mA=daymode) followed by a 15-bit PWM value. 
+    // Use drive current nightmode and the 15-bits of "topo brightness range".
+    AOMW_TRACE(AOMW_TRACE_TYPE_SETPWM, addr, 0xFF, r, g, b);
+    uint32_t t0= micros();
+    result= aoosp_send_setpwm( addr, r, g, b, 0b000 );
+    aomw_topo_cost_add(ctx, AOMW_TOPO_COST_SETPWM, micros()-t0);
+  }
+  return result;
+}
+
+
+// Sends the (already dimmed) pwm values r/g/b to (logical) triplet tix
+static aoresult_t aomw_topo_sendtriplet( aomw_topo_ctx_t * ctx, uint16_t tix, uint16_t r, uint16_t g, uint16_t b ) {
+  AORESULT_ASSERT( tix<ctx->numtriplets );
+  return aomw_topo_sendaddrchan(ctx, ctx->ltriplet_addr[tix], ctx->ltriplet_chan[tix], r, g, b);
+}
+
+
+// When all triplets of the chain get the same color, broadcast telegrams
+// (address 0) replace the telegrams per triplet: one setpwm for all RGBIs,
+// and one setpwmchn per channel for all SAIDs. So clearing a chain, or 
+// painting it one color, takes at most four telegrams, whatever its length.
+// A broadcast drives a channel on every SAID, but some channels must not 
+// be driven: channel 2 of a SAID with an I2C bridge, the second channel of
+// a cluster, and channels overridden as not live (aomw_topo_chanmask_override,
+// eg a haptic actuator). So a channel is only broadcast when it is live on
+// all SAIDs; otherwise its triplets are sent one by one.
+#define AOMW_TOPO_BCAST_CHAN(c)    (1<<(c))    // Some SAID has a triplet on channel c (0..2)
+#define AOMW_TOPO_BCAST_RGBI       0x08        // Some node is an RGBI
+#define AOMW_TOPO_BCAST_UNICAST(c) (0x10<<(c)) // Some SAID has no triplet on channel c: its triplets are sent one by one
+
+
+// Returns the broadcasts (AOMW_TOPO_BCAST_xxx) a whole chain fill needs; determined once per map.
+static uint8_t aomw_topo_bcast_kinds( aomw_topo_ctx_t * ctx ) {
+  if( ctx->bcast_generation!=ctx->generation ) {
+    uint8_t kinds= 0;
+    uint16_t numchan[3]= {0,0,0};
+    for( uint16_t tix=0; tix<ctx->numtriplets; tix++ ) {
+      uint8_t chan= ctx->triplet_chan[tix];
+      if( chan==AOMW_TOPO_CHAN_NONE ) kinds|= AOMW_TOPO_BCAST_RGBI; else { kinds|= AOMW_TOPO_BCAST_CHAN(chan); numchan[chan]++; }
+    }
+    uint16_t numsaids= 0;
+    for( uint16_t addr=1; addr<=ctx->numnodes; addr++ ) 
+      if( AOOSP_IDENTIFY_IS_SAID(aomw_topo_rec_id(ctx, addr)) ) numsaids++;
+    int numtele= (kinds & AOMW_TOPO_BCAST_RGBI) ? 1 : 0;
+    for( uint8_t chan=0; chan<3; chan++ ) {
+      if( !(kinds & AOMW_TOPO_BCAST_CHAN(chan)) ) continue;
+      if( numchan[chan]<numsaids ) { kinds|= AOMW_TOPO_BCAST_UNICAST(chan); numtele+= numchan[chan]; } else numtele+= 1;
+    }
+    ctx->bcast_kinds= kinds;
+    ctx->bcast_numtele= numtele;
+    ctx->bcast_generation= ctx->generation;
+  }
+  return ctx->bcast_kinds;
+}
+
+
+// Returns the number of telegrams aomw_topo_sendall() sends.
+static uint16_t aomw_topo_sendall_numtele( aomw_topo_ctx_t * ctx ) {
+  aomw_topo_bcast_kinds(ctx);
+  return ctx->bcast_numtele;
+}
+
+
+// Power (see section "power"): the estimated current of a triplet, and the bookkeeping of what was sent.
+static uint32_t aomw_topo_power_triplet( aomw_topo_ctx_t * ctx, uint16_t ptix, uint16_t r, uint16_t g, uint16_t b );
+static void aomw_topo_power_sent( aomw_topo_ctx_t * ctx, uint16_t ptix, uint32_t ua );
+
+
+// With a power budget, a whole chain fill is sent in two passes: first the
+// triplets (broadcast groups) that get darker, then those that get brighter,
+// so that the chain does not exceed the budget halfway.
+#define AOMW_TOPO_SENDALL_ALL      0 // Send to all triplets
+#define AOMW_TOPO_SENDALL_DARKER   1 // Send only to triplets that get darker (or stay)
+#define AOMW_TOPO_SENDALL_BRIGHTER 2 // Send only to triplets that get brighter
+
+
+// Sends the (already dimmed) pwm values r/g/b to the triplets on `chan` (AOMW_TOPO_CHAN_NONE for RGBIs), with one broadcast or one by one (`unicast`).
+static aoresult_t aomw_topo_sendall_chan( aomw_topo_ctx_t * ctx, uint8_t chan, int unicast, uint16_t r, uint16_t g, uint16_t b, int pass ) {
+  aoresult_t result;
+  if( unicast ) {
+    for( uint16_t ptix=0; ptix<ctx->numtriplets; ptix++ ) {
+      if( ctx->triplet_chan[ptix]!=chan ) continue;
+      uint32_t ua= aomw_topo_power_triplet(ctx, ptix, r, g, b);
+      if( pass!=AOMW_TOPO_SENDALL_ALL && (ua<=ctx->power_sent_ua[ptix]) != (pass==AOMW_TOPO_SENDALL_DARKER) ) continue;
+      result= aomw_topo_sendaddrchan(ctx, ctx->triplet_addr[ptix], chan, r, g, b);
+      if( result!=aoresult_ok ) return result;
+      aomw_topo_power_sent(ctx, ptix, ua);
+    }
+    return aoresult_ok;
+  }
+  uint32_t ua0= 0; // current of the group now
+  uint32_t ua1= 0; // current of the group after the broadcast
+  for( uint16_t ptix=0; ptix<ctx->numtriplets; ptix++ ) {
+    if( ctx->triplet_chan[ptix]!=chan ) continue;
+    ua0+= ctx->power_sent_ua[ptix];
+    ua1+= aomw_topo_power_triplet(ctx, ptix, r, g, b);
+  }
+  if( pass!=AOMW_TOPO_SENDALL_ALL && (ua1<=ua0) != (pass==AOMW_TOPO_SENDALL_DARKER) ) return aoresult_ok;
+  result= aomw_topo_sendaddrchan(ctx, 0x000, chan, r, g, b);
+  if( result!=aoresult_ok ) return result;
+  for( uint16_t ptix=0; ptix<ctx->numtriplets; ptix++ ) 
+    if( ctx->triplet_chan[ptix]==chan ) aomw_topo_power_sent(ctx, ptix, aomw_topo_power_triplet(ctx, ptix, r, g, b) );
+  return aoresult_ok;
+}
+
+
+// Sends the (already dimmed) pwm values r/g/b to all triplets of the chain, using broadcasts where allowed; `pass` is AOMW_TOPO_SENDALL_XXX.
+static aoresult_t aomw_topo_sendall( aomw_topo_ctx_t * ctx, uint16_t r, uint16_t g, uint16_t b, int pass ) {
+  uint8_t kinds= aomw_topo_bcast_kinds(ctx);
+  aoresult_t result;
+  if( kinds & AOMW_TOPO_BCAST_RGBI ) {
+    result= aomw_topo_sendall_chan(ctx, AOMW_TOPO_CHAN_NONE, 0, r, g, b, pass);
+    if( result!=aoresult_ok ) return result;
+  }
+  for( uint8_t chan=0; chan<3; chan++ ) {
+    if( !(kinds & AOMW_TOPO_BCAST_CHAN(chan)) ) continue;
+    result= aomw_topo_sendall_chan(ctx, chan, kinds & AOMW_TOPO_BCAST_UNICAST(chan), r, g, b, pass);
+    if( result!=aoresult_ok ) return result;
+  }
+  return aoresult_ok;
+}
+
+
+// Framebuffer: sets all triplets to `rgb` and marks none dirty (after the chain was filled with it).
+static void aomw_topo_fb_fill( aomw_topo_ctx_t * ctx, const aomw_topo_rgb_t * rgb );
+// Framebuffer: sets (logical) triplet `tix` to `rgb` and marks it not dirty (after it was sent the dimmed pwm values r/g/b).
+static void aomw_topo_fb_sent( aomw_topo_ctx_t * ctx, uint16_t tix, const aomw_topo_rgb_t * rgb, uint16_t r, uint16_t g, uint16_t b );
+// Power: sets the (logical) triplets in `zone` to `rgb` via the framebuffer and sends them, when the chain stays within the budget.
+static aoresult_t aomw_topo_power_setzone( aomw_topo_ctx_t * ctx, const aomw_topo_zone_t * zone, const aomw_topo_rgb_t * rgb );
+
+
+/*!
+    @brief  Sets the color for triplet `tix` to `rgb`.
+    @param  ctx
+            The context (the chain) to operate on.
+    @param  tix
+            The (logical) index of the triplet.
+    @param  rgb
+            A topo color, each component (red, green, blue) has a brightness 
             level from 0 to 0x7FFF (or AOMW_TOPO_BRIGHTNESS_MAX).
     @return aoresult_ok      if successful
+            aoresult_other   if a power budget is set, and sending would 
+                             take the chain over it (see note)
             other error code if there is a (communications) error
     @note   Only available after aomw_topo_build() - or start/step.
     @note   tix is 0-based, so , 0 <= tix < aomw_topo_numtriplets().
+    @note   tix is a logical index, see aomw_topo_remap_mirror(); the 
+            remap is baked in the lookup tables, so it costs nothing.
     @note   One high level feature of the topo module is to abstract away
             how to drive triplets (if there is a channel, the channel's 
             current settings, and available pwm bits). 
@@ -656,35 +1825,118 @@ extern const aomw_topo_rgb_t aomw_topo_off    = { 0x0000,0x0000,0x0000, "off" };
             and also use the 15 bit "topo brightness range" as PWM value.
     @note   The `rgb` color is dimmed down using the global dim value, 
             set by `aomw_topo_dim_set()`.
+    @note   The framebuffer is updated too (the triplet is not dirty), so
+            that it keeps matching the chain.
+    @note   With a power budget (aomw_topo_power_budget_set()), the color
+            goes via the framebuffer, and is sent with the dim level of the
+            last flush (aomw_topo_power_dim()). Only this triplet is sent, 
+            and only when the estimated current of the chain stays within 
+            the budget; otherwise it stays dirty, and aoresult_other is 
+            returned: call aomw_topo_fb_flush(), which lowers the level.
 */
-aoresult_t aomw_topo_settriplet( uint16_t tix, const aomw_topo_rgb_t *rgb  ) {
-  // We dim brightness here to prevent under voltage
-  uint16_t r = (rgb->r)*aomw_topo_dim/1024; 
-  uint16_t g = (rgb->g)*aomw_topo_dim/1024; 
-  uint16_t b = (rgb->b)*aomw_topo_dim/1024; 
-  // Select osp node and channel 
-  uint16_t addr = aomw_topo_triplet_addr(tix);
-  aoresult_t result;
-  // This is a bit of a shortcut. When the triplet is "on a channel" we
-  // equate that to needing a setpwmchn telegram. In a context of only
-  // two kinds of nodes known at the moment (SAID and RGBI) that is enough.
-  if( aomw_topo_triplet_onchan(tix) ) {
-    // Triplet to configure is an external one driven by a SAID. The PWM 
-    // register contains a 15-bit PWM value followed by a 1 bit LSB-dithering
-    // control. Use the 15-bits of "topo brightness range" and no dithering (<<1).
-    result= aoosp_send_setpwmchn(addr, aomw_topo_triplet_chan(tix), r << 1, g << 1, b << 1 );
-  } else {
-    // Triplet to configure is an RGBI. The PWM register contains a 1-bit drive 
-    // current (0=10mA=nightmode, 1=50mA=daymode) followed by a 15-bit PWM value. 
-    // Use drive current nightmode and the 15-bits of "topo brightness range".
-    result= aoosp_send_setpwm( addr, r, g, b, 0b000 );
+aoresult_t aomw_topo_settriplet_ctx( aomw_topo_ctx_t * ctx, uint16_t tix, const aomw_topo_rgb_t *rgb ) {
+  if( ctx->power_budget_ua!=0 && tix<ctx->remap_num ) {
+    aomw_topo_zone_t zone;
+    aomw_topo_zone_clear(&zone);
+    aomw_topo_zone_addrange(&zone, tix, tix+1);
+    return aomw_topo_power_setzone(ctx, &zone, rgb);
   }
+  // We dim brightness here to prevent under voltage
+  uint16_t r = (rgb->r)*ctx->dim/1024; 
+  uint16_t g = (rgb->g)*ctx->dim/1024; 
+  uint16_t b = (rgb->b)*ctx->dim/1024; 
+  aoresult_t result= aomw_topo_sendtriplet(ctx, tix, r, g, b);
+  if( result==aoresult_ok ) aomw_topo_fb_sent(ctx, tix, rgb, r, g, b); // the framebuffer keeps matching the chain
   return result;
 }
 
 
+/*!
+    @brief  Sets the color for all triplets `tix0` up to (but excluding) 
+            `tix1` to `rgb`; a "range fill".
+    @param  ctx
+            The context (the chain) to operate on.
+    @param  tix0
+            The index of the first triplet to set.
+    @param  tix1
+            The index of the triplet after the last one to set.
+    @param  rgb
+            A topo color, each component (red, green, blue) has a brightness 
+            level from 0 to 0x7FFF (or AOMW_TOPO_BRIGHTNESS_MAX).
+    @return aoresult_ok      if successful
+            aoresult_other   if a power budget is set, and sending would 
+                             take the chain over it (see note)
+            other error code if there is a (communications) error
+    @note   Only available after aomw_topo_build() - or start/step.
+    @note   0 <= tix0 <= tix1 <= aomw_topo_numtriplets().
+    @note   Same effect as calling aomw_topo_settriplet() for every triplet
+            in the range, but the color is dimmed only once.
+    @note   The range is in logical indices (see aomw_topo_remap_mirror()).
+    @note   When the range is the whole chain, broadcast telegrams are 
+            sent (at most four, instead of one per triplet).
+    @note   The framebuffer is set to `rgb` for the range (not dirty).
+    @note   With a power budget (aomw_topo_power_budget_set()), the range
+            goes via the framebuffer, like aomw_topo_settriplet(). A range 
+            of the whole chain is flushed (aomw_topo_fb_flush()), so it is
+            scaled to the budget.
+*/
+aoresult_t aomw_topo_settriplets_ctx( aomw_topo_ctx_t * ctx, uint16_t tix0, uint16_t tix1, const aomw_topo_rgb_t *rgb ) {
+  AORESULT_ASSERT( tix0<=tix1 && tix1<=ctx->numtriplets );
+  if( ctx->power_budget_ua!=0 && tix1<=ctx->remap_num ) {
+    aomw_topo_zone_t zone;
+    aomw_topo_zone_clear(&zone);
+    aomw_topo_zone_addrange(&zone, tix0, tix1);
+    return aomw_topo_power_setzone(ctx, &zone, rgb);
+  }
+  // We dim brightness here to prevent under voltage
+  uint16_t r = (rgb->r)*ctx->dim/1024; 
+  uint16_t g = (rgb->g)*ctx->dim/1024; 
+  uint16_t b = (rgb->b)*ctx->dim/1024; 
+  if( tix0==0 && tix1==ctx->numtriplets && aomw_topo_sendall_numtele(ctx)<tix1 ) {
+    aoresult_t result= aomw_topo_sendall(ctx, r, g, b, AOMW_TOPO_SENDALL_ALL);
+    if( result==aoresult_ok ) aomw_topo_fb_fill(ctx, rgb); // the framebuffer keeps matching the chain
+    return result;
+  }
+  for( uint16_t tix=tix0; tix<tix1; tix++ ) {
+    aoresult_t result= aomw_topo_sendtriplet(ctx, tix, r, g, b);
+    if( result!=aoresult_ok ) return result;
+    aomw_topo_fb_sent(ctx, tix, rgb, r, g, b);
+  }
+  return aoresult_ok;
+}
+
+
+/*!
+    @brief  Sets the color for the triplet on node `addr`, channel `chan`
+            to `rgb`; like aomw_topo_settriplet() but without table lookup.
+    @param  ctx
+            The context (the chain) to operate on.
+    @param  addr
+            The address of the OSP node driving the triplet.
+    @param  chan
+            The channel of that node (AOMW_TOPO_CHAN_NONE for RGBI).
+    @param  rgb
+            A topo color, each component (red, green, blue) has a brightness 
+            level from 0 to 0x7FFF (or AOMW_TOPO_BRIGHTNESS_MAX).
+    @return aoresult_ok      if successful
+            other error code if there is a (communications) error
+    @note   Intended for a fixed topology, where addr and chan are compile 
+            time constants, see AOMW_TOPO_FIXED_SETTRIPLET().
+    @note   Bypasses the framebuffer, and thus the power budget.
+*/
+aoresult_t aomw_topo_settriplet_at_ctx( aomw_topo_ctx_t * ctx, uint16_t addr, uint8_t chan, const aomw_topo_rgb_t *rgb ) {
+  // We dim brightness here to prevent under voltage
+  uint16_t r = (rgb->r)*ctx->dim/1024; 
+  uint16_t g = (rgb->g)*ctx->dim/1024; 
+  uint16_t b = (rgb->b)*ctx->dim/1024; 
+  return aomw_topo_sendaddrchan(ctx, addr, chan, r, g, b);
+}
+
+
 /*!
     @brief  Sets the global dim-level for aomw_topo_settriplet().
+    @param  ctx
+            The context (the chain) to operate on.
     @param  dim
             The dim level; "pro-kibi": 0 to 1024.
     @note   Can be called even if topo has not been built.
@@ -694,19 +1946,933 @@ aoresult_t aomw_topo_settriplet( uint16_t tix, const aomw_topo_rgb_t *rgb  ) {
             calls are effected.
     @note   See also aomw_topo_dim_get().
 */
-void aomw_topo_dim_set( int dim ) {
+void aomw_topo_dim_set_ctx( aomw_topo_ctx_t * ctx, int dim ) {
   if( dim<0    ) dim=0;
   if( dim>1024 ) dim=1024;
-  aomw_topo_dim = dim;
+  ctx->dim = dim;
 }
 
 
 /*!
     @brief  Gets the global dim-level.
+    @param  ctx
+            The context (the chain) to operate on.
     @note   See aomw_topo_dim_set().
 */
-int aomw_topo_dim_get() {
-  return aomw_topo_dim;
+int aomw_topo_dim_get_ctx( aomw_topo_ctx_t * ctx ) {
+  return ctx->dim;
+}
+
+
+// === remap ================================================================
+
+
+/*!
+    @brief  Resets the remap: logical triplet index equals physical index.
+    @param  ctx
+            The context (the chain) to operate on.
+    @note   Can be called even if topo has not been built.
+*/
+void aomw_topo_remap_identity_ctx( aomw_topo_ctx_t * ctx ) {
+  for( uint16_t tix=0; tix<ctx->remap_num; tix++ ) ctx->remap_l2p[tix]= tix;
+  ctx->remap_keepnum= ctx->remap_num; // also after a failed build: the next build does not restore the old remap
+  aomw_topo_remap_apply(ctx);
+}
+
+
+/*!
+    @brief  Mirrors the logical triplets `tix0` up to (but excluding) `tix1`;
+            it reverses their order.
+    @param  ctx
+            The context (the chain) to operate on.
+    @param  tix0
+            The (logical) index of the first triplet to mirror.
+    @param  tix1
+            The (logical) index of the triplet after the last one to mirror.
+    @note   0 <= tix0 <= tix1 <= aomw_topo_numtriplets().
+    @note   Mirror, offset and permute compose: each one rearranges the 
+            current logical order. For example, a board wired in reverse is
+            aomw_topo_remap_mirror(0,aomw_topo_numtriplets()), and when the 
+            first two triplets are on the MCU board, mirroring the range 
+            2..numtriplets leaves them in place.
+    @note   The remap is baked into tables, so that aomw_topo_settriplet(),
+            aomw_topo_settriplets() and aomw_topo_fb_set() do not slow down.
+            Baking takes O(numtriplets); remap once, not per frame.
+    @note   The remap survives a rebuild, unless the number of triplets 
+            changes; then it is reset to the identity.
+*/
+void aomw_topo_remap_mirror_ctx( aomw_topo_ctx_t * ctx, uint16_t tix0, uint16_t tix1 ) {
+  AORESULT_ASSERT( tix0<=tix1 && tix1<=ctx->remap_num );
+  while( tix0+1<tix1 ) {
+    uint16_t ptix= ctx->remap_l2p[tix0];
+    ctx->remap_l2p[tix0++]= ctx->remap_l2p[--tix1];
+    ctx->remap_l2p[tix1]= ptix;
+  }
+  aomw_topo_remap_apply(ctx);
+}
+
+
+/*!
+    @brief  Rotates the logical triplets; the triplet that had logical 
+            index `offset` gets logical index 0.
+    @param  ctx
+            The context (the chain) to operate on.
+    @param  offset
+            The rotation; may be negative, is taken modulo the number of 
+            triplets.
+    @note   See aomw_topo_remap_mirror() for composing and baking.
+*/
+void aomw_topo_remap_offset_ctx( aomw_topo_ctx_t * ctx, int offset ) {
+  int num= ctx->remap_num;
+  if( num==0 ) return;
+  offset%= num;
+  if( offset<0 ) offset+= num;
+  // Rotate using p2l as scratch (apply recomputes it)
+  for( int tix=0; tix<num; tix++ ) ctx->remap_p2l[tix]= ctx->remap_l2p[tix];
+  for( int tix=0; tix<num; tix++ ) ctx->remap_l2p[tix]= ctx->remap_p2l[(tix+offset)%num];
+  aomw_topo_remap_apply(ctx);
+}
+
+
+/*!
+    @brief  Permutes the logical triplets; the triplet that had logical 
+            index `perm[tix]` gets logical index `tix`.
+    @param  ctx
+            The context (the chain) to operate on.
+    @param  perm
+            The permutation; every index 0..num-1 must occur once.
+    @param  num
+            The number of entries in `perm`, must be aomw_topo_numtriplets().
+    @return aoresult_ok      if successful
+            aoresult_other   if `num` is wrong or `perm` is not a permutation
+                             (the remap is unchanged)
+    @note   Typically used for interleaved boards, with a const table.
+    @note   See aomw_topo_remap_mirror() for composing and baking.
+*/
+aoresult_t aomw_topo_remap_permute_ctx( aomw_topo_ctx_t * ctx, const uint16_t * perm, uint16_t num ) {
+  if( num!=ctx->remap_num || num!=ctx->numtriplets ) return aoresult_other;
+  // Check that perm is a permutation (using p2l as scratch, apply recomputes it)
+  for( uint16_t tix=0; tix<num; tix++ ) ctx->remap_p2l[tix]= 0;
+  for( uint16_t tix=0; tix<num; tix++ ) {
+    if( perm[tix]>=num || ctx->remap_p2l[perm[tix]] ) { aomw_topo_remap_apply(ctx); return aoresult_other; }
+    ctx->remap_p2l[perm[tix]]= 1;
+  }
+  // Compose
+  for( uint16_t tix=0; tix<num; tix++ ) ctx->remap_p2l[tix]= ctx->remap_l2p[tix];
+  for( uint16_t tix=0; tix<num; tix++ ) ctx->remap_l2p[tix]= ctx->remap_p2l[perm[tix]];
+  aomw_topo_remap_apply(ctx);
+  return aoresult_ok;
+}
+
+
+/*!
+    @brief  Returns the physical index of a logical triplet.
+    @param  ctx
+            The context (the chain) to operate on.
+    @param  tix
+            The logical index of the triplet.
+    @return The physical index (as used by aomw_topo_triplet_addr()).
+*/
+uint16_t aomw_topo_remap_phys_ctx( aomw_topo_ctx_t * ctx, uint16_t tix ) {
+  AORESULT_ASSERT( tix<ctx->remap_num );
+  return ctx->remap_l2p[tix];
+}
+
+
+/*!
+    @brief  Returns the logical index of a physical triplet.
+    @param  ctx
+            The context (the chain) to operate on.
+    @param  ptix
+            The physical index of the triplet.
+    @return The logical index (as used by aomw_topo_settriplet()).
+*/
+uint16_t aomw_topo_remap_logical_ctx( aomw_topo_ctx_t * ctx, uint16_t ptix ) {
+  AORESULT_ASSERT( ptix<ctx->remap_num );
+  return ctx->remap_p2l[ptix];
+}
+
+
+/*!
+    @brief  Returns if the remap is the identity.
+    @param  ctx
+            The context (the chain) to operate on.
+    @return 1 if logical and physical indices are equal, 0 otherwise.
+*/
+int aomw_topo_remap_isidentity_ctx( aomw_topo_ctx_t * ctx ) {
+  return ctx->remap_isidentity;
+}
+
+
+// === power ================================================================
+
+
+// All LEDs of a chain draw their current from one supply. When a frame is 
+// too bright, the supply voltage drops, nodes flag under voltage, and go 
+// to the error state (they switch off). Dimming (aomw_topo_dim_set) lowers
+// the current of every frame, but a bright frame may still trip nodes. 
+// With a power budget, topo estimates the LED current of the framebuffer, 
+// and a flush lowers the dim level of a frame that would exceed the budget.
+//
+// The estimate is kept up to date incrementally: aomw_topo_fb_set() 
+// subtracts the current of the old color of the triplet and adds that of
+// the new color, so a flush does not rescan the framebuffer. The current 
+// of a triplet is its pwm fraction times the drive current of its channel
+// (as configured by aomw_topo_node_setcurrents). When the map changes, the
+// estimate is recomputed once (it is cached per generation).
+//
+// The lowered dim level applies to the whole chain, so when it changes 
+// all triplets are resent. To not resend the chain for every small change,
+// the level is lowered with headroom (to 7/8 of what fits), and a darker 
+// frame raises it again only when that is worthwhile (more than 1/8).
+//
+// Topo also keeps the estimated current of each triplet as it was last 
+// sent. A flush first sends the triplets that get darker, and then those
+// that get brighter, so the chain stays within the budget while a frame 
+// (eg with a lowered level) is being sent. A zone flush that would take 
+// the chain over the budget becomes a full flush.
+
+
+#define AOMW_TOPO_POWER_SAID_UA 12000 // Current (uA) of a SAID LED at full pwm (level 2 on channel 0, level 3 on channels 1 and 2)
+#define AOMW_TOPO_POWER_RGBI_UA 10000 // Current (uA) of an RGBI LED at full pwm (night mode)
+
+
+// Returns the estimated current (uA) of physical triplet `ptix` showing the (undimmed) color r/g/b.
+static uint32_t aomw_topo_power_triplet( aomw_topo_ctx_t * ctx, uint16_t ptix, uint16_t r, uint16_t g, uint16_t b ) {
+  uint32_t ua= ctx->triplet_chan[ptix]==AOMW_TOPO_CHAN_NONE ? AOMW_TOPO_POWER_RGBI_UA : AOMW_TOPO_POWER_SAID_UA;
+  return ( (uint32_t)r + g + b ) * ua / AOMW_TOPO_BRIGHTNESS_MAX;
+}
+
+
+// Returns the estimated current (uA) of the undimmed framebuffer; only recomputed when the map changed.
+static uint32_t aomw_topo_power_fb( aomw_topo_ctx_t * ctx ) {
+  if( ctx->power_generation!=ctx->generation ) {
+    ctx->power_fb_ua= 0;
+    for( uint16_t ptix=0; ptix<ctx->remap_num; ptix++ ) {
+      const aomw_topo_fbpix_t * pix= &ctx->fb[ptix];
+      ctx->power_fb_ua+= aomw_topo_power_triplet(ctx, ptix, pix->r, pix->g, pix->b);
+    }
+    ctx->power_generation= ctx->generation;
+  }
+  return ctx->power_fb_ua;
+}
+
+
+// Records that physical triplet `ptix` was sent with (dimmed) pwm values of estimated current `ua`.
+static void aomw_topo_power_sent( aomw_topo_ctx_t * ctx, uint16_t ptix, uint32_t ua ) {
+  ctx->power_chain_ua-= ctx->power_sent_ua[ptix];
+  ctx->power_chain_ua+= ua;
+  ctx->power_sent_ua[ptix]= ua;
+}
+
+
+// Updates the estimate for physical triplet `ptix` changing to r/g/b; call before the framebuffer is written.
+static void aomw_topo_power_fbchange( aomw_topo_ctx_t * ctx, uint16_t ptix, uint16_t r, uint16_t g, uint16_t b ) {
+  if( ctx->power_generation!=ctx->generation ) return; // recomputed on next use
+  const aomw_topo_fbpix_t * pix= &ctx->fb[ptix];
+  ctx->power_fb_ua-= aomw_topo_power_triplet(ctx, ptix, pix->r, pix->g, pix->b);
+  ctx->power_fb_ua+= aomw_topo_power_triplet(ctx, ptix, r, g, b);
+}
+
+
+// Returns if a frame with (undimmed) current `ua` fits the budget at dim level `dim`.
+static int aomw_topo_power_fits( aomw_topo_ctx_t * ctx, uint32_t ua, int dim ) {
+  return ctx->power_budget_ua==0 || (uint64_t)ua*dim <= (uint64_t)ctx->power_budget_ua*1024;
+}
+
+
+// Returns the dim level for a frame with (undimmed) current `ua`: the dim level when it fits, otherwise a lower level with 1/8 headroom.
+static int aomw_topo_power_fit( aomw_topo_ctx_t * ctx, uint32_t ua ) {
+  if( aomw_topo_power_fits(ctx, ua, ctx->dim) ) return ctx->dim;
+  return (uint64_t)ctx->power_budget_ua*1024*7/8/ua;
+}
+
+
+// Flush: returns the dim level to send the dirty triplets with; when the level changes all triplets are marked dirty.
+static int aomw_topo_power_flushdim( aomw_topo_ctx_t * ctx ) {
+  if( ctx->power_budget_ua==0 ) return ctx->fb_dim= ctx->dim; // no budget: a dim change needs aomw_topo_fb_invalidate(), as always
+  uint32_t ua= aomw_topo_power_fb(ctx);
+  int dim= ctx->fb_dim;
+  if( dim>ctx->dim || !aomw_topo_power_fits(ctx, ua, dim) ) {
+    dim= aomw_topo_power_fit(ctx, ua); // lower (with headroom)
+  } else if( dim<ctx->dim ) {
+    int fit= aomw_topo_power_fit(ctx, ua);
+    if( fit==ctx->dim || fit-dim>dim/8 ) dim= fit; // raise, when worthwhile
+  }
+  if( dim==ctx->fb_dim ) return dim;
+  ctx->fb_dim= dim;
+  aomw_topo_fb_invalidate_ctx(ctx);
+  return dim;
+}
+
+
+/*!
+    @brief  Sets the power budget: the maximum estimated LED current of the
+            chain for a frame sent from the framebuffer.
+    @param  ctx
+            The context (the chain) to operate on.
+    @param  ma
+            The budget in mA; 0 for no budget (the default).
+    @note   A flush (aomw_topo_fb_flush(), aomw_topo_fb_flush_some(), 
+            aomw_topo_fb_commit(), aomw_topo_zone_flush()) of a frame 
+            whose estimated current at the dim level exceeds the budget, 
+            sends it with a lower dim level, so that it fits. The dim level
+            itself is not changed; aomw_topo_power_dim() returns the level
+            of the last flush. A scene restored by the build is scaled too.
+    @note   The next flush resends all triplets.
+    @note   With a budget, a change of the dim level also takes effect at 
+            the next flush (no aomw_topo_fb_invalidate() needed).
+    @note   With a budget, aomw_topo_settriplet(), aomw_topo_settriplets()
+            and aomw_topo_zone_settriplets() go via the framebuffer, so 
+            they are budgeted too: they return aoresult_other instead of 
+            exceeding it. Only aomw_topo_settriplet_at() bypasses it. A 
+            flush assumes the chain shows what topo sent last.
+    @note   The estimate only covers the LEDs (not the nodes themselves),
+            and assumes the currents set by the build; keep a margin.
+    @note   Budgets above UINT32_MAX/1000 mA are clipped.
+*/
+void aomw_topo_power_budget_set_ctx( aomw_topo_ctx_t * ctx, uint32_t ma ) {
+  if( ma>UINT32_MAX/1000 ) ma= UINT32_MAX/1000;
+  ctx->power_budget_ua= ma*1000;
+  aomw_topo_fb_invalidate_ctx(ctx);
+}
+
+
+/*!
+    @brief  Returns the power budget (see aomw_topo_power_budget_set()).
+    @param  ctx
+            The context (the chain) to operate on.
+    @return The budget in mA; 0 for no budget.
+*/
+uint32_t aomw_topo_power_budget_get_ctx( aomw_topo_ctx_t * ctx ) {
+  return ctx->power_budget_ua/1000;
+}
+
+
+/*!
+    @brief  Returns the estimated LED current of the framebuffer at the dim
+            level (so before scaling to the budget).
+    @param  ctx
+            The context (the chain) to operate on.
+    @return The estimated current in mA.
+    @note   Cheap: the estimate is updated by aomw_topo_fb_set(), and only
+            recomputed after the map changed.
+*/
+uint32_t aomw_topo_power_ma_ctx( aomw_topo_ctx_t * ctx ) {
+  return (uint64_t)aomw_topo_power_fb(ctx)*ctx->dim/1024/1000;
+}
+
+
+/*!
+    @brief  Returns the dim level the last flush of the framebuffer used.
+    @param  ctx
+            The context (the chain) to operate on.
+    @return The dim level (0..1024); lower than aomw_topo_dim_get() when
+            the frame was scaled to fit the power budget.
+*/
+int aomw_topo_power_dim_ctx( aomw_topo_ctx_t * ctx ) {
+  return ctx->fb_dim;
+}
+
+
+// === framebuffer ==========================================================
+
+
+// Instead of sending a telegram per aomw_topo_settriplet() call, an 
+// application (or effect) can draw a frame in the framebuffer with 
+// aomw_topo_fb_set(), and then send it with aomw_topo_fb_flush(). The
+// flush only sends triplets that changed (dirty tracking), and sends them
+// in physical (chain) order, whatever the logical order (remap) is.
+
+
+/*!
+    @brief  Sets the color of (logical) triplet `tix` in the framebuffer.
+    @param  ctx
+            The context (the chain) to operate on.
+    @param  tix
+            The logical index of the triplet.
+    @param  rgb
+            A topo color, components 0..AOMW_TOPO_BRIGHTNESS_MAX.
+    @return 1 if the color changed (the triplet is marked dirty), 0 otherwise.
+    @note   No telegram is sent; see aomw_topo_fb_flush().
+    @note   The triplet is only marked dirty when its color changes.
+    @note   The framebuffer covers at most AOMW_TOPO_MAXTRIPLETS (200) 
+            triplets; a larger fixed topology can not use it.
+*/
+int aomw_topo_fb_set_ctx( aomw_topo_ctx_t * ctx, uint16_t tix, const aomw_topo_rgb_t * rgb ) {
+  AORESULT_ASSERT( tix<ctx->remap_num );
+  uint16_t ptix= ctx->remap_l2p[tix];
+  aomw_topo_fbpix_t * pix= &ctx->fb[ptix];
+  if( pix->r==rgb->r && pix->g==rgb->g && pix->b==rgb->b ) return 0;
+  aomw_topo_power_fbchange(ctx, ptix, rgb->r, rgb->g, rgb->b);
+  pix->r= rgb->r;
+  pix->g= rgb->g;
+  pix->b= rgb->b;
+  ctx->fb_dirty[ptix/32] |= 1UL << (ptix%32);
+  return 1;
+}
+
+
+/*!
+    @brief  Gets the color of (logical) triplet `tix` from the framebuffer.
+    @param  ctx
+            The context (the chain) to operate on.
+    @param  tix
+            The logical index of the triplet.
+    @param  rgb
+            Output: the color (the `name` field is set to NULL).
+*/
+void aomw_topo_fb_get_ctx( aomw_topo_ctx_t * ctx, uint16_t tix, aomw_topo_rgb_t * rgb ) {
+  AORESULT_ASSERT( tix<ctx->remap_num );
+  const aomw_topo_fbpix_t * pix= &ctx->fb[ctx->remap_l2p[tix]];
+  rgb->r= pix->r;
+  rgb->g= pix->g;
+  rgb->b= pix->b;
+  rgb->name= 0;
+}
+
+
+/*!
+    @brief  Marks all triplets dirty, so that the next flush sends them all.
+    @param  ctx
+            The context (the chain) to operate on.
+    @note   Needed after changing the dim level (aomw_topo_dim_set()), or
+            when the chain was changed behind the back of the framebuffer
+            (eg by aomw_topo_settriplet_at()).
+*/
+void aomw_topo_fb_invalidate_ctx( aomw_topo_ctx_t * ctx ) {
+  for( uint16_t ptix=0; ptix<ctx->remap_num; ptix++ ) ctx->fb_dirty[ptix/32] |= 1UL << (ptix%32);
+}
+
+
+/*!
+    @brief  Returns the number of dirty triplets (to be sent by a flush).
+    @param  ctx
+            The context (the chain) to operate on.
+    @return Number of dirty triplets.
+*/
+int aomw_topo_fb_numdirty_ctx( aomw_topo_ctx_t * ctx ) {
+  int num= 0;
+  for( int wix=0; wix<AOMW_TOPO_ZONE_NUMWORDS; wix++ ) num+= __builtin_popcountl(ctx->fb_dirty[wix]);
+  return num;
+}
+
+
+// Framebuffer: sets all triplets to `rgb` and marks none dirty (after the chain was filled with it).
+static void aomw_topo_fb_fill( aomw_topo_ctx_t * ctx, const aomw_topo_rgb_t * rgb ) {
+  for( uint16_t ptix=0; ptix<ctx->remap_num; ptix++ ) {
+    aomw_topo_power_fbchange(ctx, ptix, rgb->r, rgb->g, rgb->b);
+    ctx->fb[ptix].r= rgb->r;
+    ctx->fb[ptix].g= rgb->g;
+    ctx->fb[ptix].b= rgb->b;
+  }
+  memset(ctx->fb_dirty, 0, sizeof ctx->fb_dirty);
+}
+
+
+// Framebuffer: sets (logical) triplet `tix` to `rgb` and marks it not dirty (after it was sent the dimmed pwm values r/g/b).
+static void aomw_topo_fb_sent( aomw_topo_ctx_t * ctx, uint16_t tix, const aomw_topo_rgb_t * rgb, uint16_t r, uint16_t g, uint16_t b ) {
+  if( tix>=ctx->remap_num ) return; // beyond the framebuffer (large fixed topology)
+  uint16_t ptix= ctx->remap_l2p[tix];
+  aomw_topo_power_fbchange(ctx, ptix, rgb->r, rgb->g, rgb->b);
+  ctx->fb[ptix].r= rgb->r;
+  ctx->fb[ptix].g= rgb->g;
+  ctx->fb[ptix].b= rgb->b;
+  ctx->fb_dirty[ptix/32] &= ~(1UL << (ptix%32));
+  aomw_topo_power_sent(ctx, ptix, aomw_topo_power_triplet(ctx, ptix, r, g, b));
+}
+
+
+// Framebuffer: sets (logical) triplet `tix` to `rgb` and marks it dirty, also when the color did not change, so that a flush sends it.
+static void aomw_topo_fb_force( aomw_topo_ctx_t * ctx, uint16_t tix, const aomw_topo_rgb_t * rgb ) {
+  aomw_topo_fb_set_ctx(ctx, tix, rgb);
+  uint16_t ptix= ctx->remap_l2p[tix];
+  ctx->fb_dirty[ptix/32] |= 1UL << (ptix%32);
+}
+
+
+// Flush: when the whole framebuffer has one color, and broadcasts are cheaper than the dirty triplets, sends broadcasts and returns 1 (result in `result`).
+static int aomw_topo_fb_flushuniform( aomw_topo_ctx_t * ctx, int dim, aoresult_t * result ) {
+  if( ctx->remap_num!=ctx->numtriplets || ctx->numtriplets==0 ) return 0;
+  if( aomw_topo_fb_numdirty_ctx(ctx)<=aomw_topo_sendall_numtele(ctx) ) return 0;
+  const aomw_topo_fbpix_t * pix0= &ctx->fb[0];
+  for( uint16_t ptix=1; ptix<ctx->remap_num; ptix++ ) {
+    const aomw_topo_fbpix_t * pix= &ctx->fb[ptix];
+    if( pix->r!=pix0->r || pix->g!=pix0->g || pix->b!=pix0->b ) return 0;
+  }
+  uint16_t r = (pix0->r)*dim/1024; 
+  uint16_t g = (pix0->g)*dim/1024; 
+  uint16_t b = (pix0->b)*dim/1024; 
+  if( ctx->power_budget_ua==0 ) {
+    *result= aomw_topo_sendall(ctx, r, g, b, AOMW_TOPO_SENDALL_ALL);
+  } else {
+    *result= aomw_topo_sendall(ctx, r, g, b, AOMW_TOPO_SENDALL_DARKER);
+    if( *result==aoresult_ok ) *result= aomw_topo_sendall(ctx, r, g, b, AOMW_TOPO_SENDALL_BRIGHTER);
+  }
+  if( *result==aoresult_ok ) for( int wix=0; wix<AOMW_TOPO_ZONE_NUMWORDS; wix++ ) ctx->fb_dirty[wix]= 0;
+  return 1;
+}
+
+
+// Flush: sends at most `*max` dirty triplets (only those in `zone`, unless NULL) with dim level `dim`; decrements `*max` per telegram.
+// Without a budget in physical order; with a budget first the triplets that get darker, then those that get brighter.
+static aoresult_t aomw_topo_fb_sendsome( aomw_topo_ctx_t * ctx, const aomw_topo_zone_t * zone, int * max, int dim ) {
+  int numpasses= ctx->power_budget_ua==0 ? 1 : 2;
+  int numwords= (ctx->remap_num+31)/32;
+  for( int pass=0; pass<numpasses; pass++ ) {
+    for( int wix=0; wix<numwords; wix++ ) {
+      uint32_t bits= ctx->fb_dirty[wix];
+      if( zone && ctx->remap_isidentity ) bits &= zone->bits[wix];
+      while( bits ) {
+        int bix= __builtin_ctzl(bits);
+        bits &= bits-1;
+        uint16_t ptix= wix*32 + bix;
+        if( zone && !ctx->remap_isidentity && !aomw_topo_zone_has(zone,ctx->remap_p2l[ptix]) ) continue;
+        const aomw_topo_fbpix_t * pix= &ctx->fb[ptix];
+        uint16_t r = (pix->r)*dim/1024; 
+        uint16_t g = (pix->g)*dim/1024; 
+        uint16_t b = (pix->b)*dim/1024; 
+        uint32_t ua= aomw_topo_power_triplet(ctx, ptix, r, g, b);
+        if( numpasses==2 && (ua<=ctx->power_sent_ua[ptix]) != (pass==0) ) continue; // pass 0 darker, pass 1 brighter
+        if( *max<=0 ) return aoresult_ok;
+        aoresult_t result= aomw_topo_sendaddrchan(ctx, ctx->triplet_addr[ptix], ctx->triplet_chan[ptix], r, g, b);
+        if( result!=aoresult_ok ) return result;
+        aomw_topo_power_sent(ctx, ptix, ua);
+        ctx->fb_dirty[wix] &= ~(1UL << bix);
+        (*max)--;
+      }
+    }
+  }
+  return aoresult_ok;
+}
+
+
+/*!
+    @brief  Sends all dirty triplets of the framebuffer to the chain.
+    @param  ctx
+            The context (the chain) to operate on.
+    @return aoresult_ok      if successful
+            other error code if there is a (communications) error
+    @note   Sends one telegram per dirty triplet, in physical order 
+            (ascending node address), dimmed with the global dim level.
+    @note   The dirty bits are scanned a word (32 triplets) at a time, so 
+            a flush of an unchanged frame is cheap.
+    @note   When a telegram fails, the flush stops; the triplets not yet 
+            sent stay dirty, so a next flush continues.
+    @note   When all triplets of the framebuffer have the same color, and
+            that takes fewer telegrams, the flush uses broadcasts (eg to 
+            clear the chain).
+    @note   With a power budget (aomw_topo_power_budget_set()), a frame 
+            that would exceed it is sent with a lower dim level. The 
+            triplets that get darker are sent first, so the chain stays 
+            within the budget while the frame is being sent.
+*/
+aoresult_t aomw_topo_fb_flush_ctx( aomw_topo_ctx_t * ctx ) {
+  aoresult_t result;
+  int dim= aomw_topo_power_flushdim(ctx);
+  if( aomw_topo_fb_flushuniform(ctx, dim, &result) ) return result;
+  return aomw_topo_fb_flush_some_ctx(ctx, INT_MAX);
+}
+
+
+/*!
+    @brief  Sends at most `max` dirty triplets of the framebuffer.
+    @param  ctx
+            The context (the chain) to operate on.
+    @param  max
+            The maximum number of triplets (telegrams) to send.
+    @return aoresult_ok      if successful
+            other error code if there is a (communications) error
+    @note   As aomw_topo_fb_flush(), but in parts: the sent triplets are 
+            no longer dirty, so the next call continues where this one 
+            stopped. The flush is complete when aomw_topo_fb_numdirty()
+            is 0. Used to interleave the flushes of several chains.
+    @note   With a power budget, every part sends the triplets that get
+            darker first, so the chain stays within the budget.
+*/
+aoresult_t aomw_topo_fb_flush_some_ctx( aomw_topo_ctx_t * ctx, int max ) {
+  int dim= aomw_topo_power_flushdim(ctx);
+  return aomw_topo_fb_sendsome(ctx, NULL, &max, dim);
+}
+
+// === sync =================================================================
+
+
+// Without sync, a node shows a new color as soon as its telegram arrives. 
+// On a long chain, the triplets of one frame therefore change one after 
+// the other, and a fast animation (eg a sweep) shows tearing. In sync mode
+// the SAIDs latch received pwm values (SYNCEN flag in their current 
+// registers), and show them when a (broadcast) sync telegram arrives. So 
+// a frame is flushed, and then committed with one telegram: all SAID 
+// triplets change at once, and the frame latency no longer depends on 
+// the position in the chain. RGBI nodes have no sync; they keep showing 
+// their new color on arrival.
+
+
+/*!
+    @brief  Enables or disables sync mode.
+    @param  ctx
+            The context (the chain) to operate on.
+    @param  enable
+            1 to enable (SAIDs latch pwm values until a sync telegram), 
+            0 to disable (SAIDs show pwm values on arrival).
+    @return aoresult_ok      if successful
+            aoresult_sys_id  if a node is not an RGBI or SAID
+            other error code if there is a (communications) error
+    @note   When a topology is built, this sends telegrams to configure 
+            the current registers of all SAIDs. The mode is remembered: a 
+            next build configures the SAIDs accordingly.
+    @note   In sync mode, aomw_topo_settriplet() and aomw_topo_fb_flush() 
+            on a SAID have no visible effect until aomw_topo_sync(); use 
+            aomw_topo_fb_commit() to flush and sync in one call.
+*/
+aoresult_t aomw_topo_sync_set_ctx( aomw_topo_ctx_t * ctx, int enable ) {
+  ctx->sync= enable!=0;
+  uint8_t flags= AOOSP_CURCHN_FLAGS_DITHER | (ctx->sync ? AOOSP_CURCHN_FLAGS_SYNCEN : 0);
+  for( uint16_t addr=1; addr<=ctx->numnodes; addr++ ) {
+    aoresult_t result= aomw_topo_node_setcurrents_ctx(ctx, addr, flags);
+    if( result!=aoresult_ok ) return result;
+  }
+  return aoresult_ok;
+}
+
+
+/*!
+    @brief  Returns if sync mode is enabled.
+    @param  ctx
+            The context (the chain) to operate on.
+    @return 1 if enabled, 0 if disabled.
+*/
+int aomw_topo_sync_get_ctx( aomw_topo_ctx_t * ctx ) {
+  return ctx->sync;
+}
+
+
+/*!
+    @brief  Broadcasts a sync telegram, so that all SAIDs in sync mode 
+            show their latched pwm values at the same moment.
+    @param  ctx
+            The context (the chain) to operate on.
+    @return aoresult_ok      if successful
+            other error code if there is a (communications) error
+    @note   Also sent when sync mode is disabled (nodes then ignore it).
+*/
+aoresult_t aomw_topo_sync_ctx( aomw_topo_ctx_t * ctx ) {
+  (void)ctx; // the telegram is a broadcast on the port of the chain
+  AOMW_TRACE(AOMW_TRACE_TYPE_SYNC, 0, 0xFF, 0, 0, 0);
+  return aoosp_send_sync(0x000);
+}
+
+
+/*!
+    @brief  Sends all dirty triplets of the framebuffer, and in sync mode,
+            commits them with a sync telegram.
+    @param  ctx
+            The context (the chain) to operate on.
+    @return aoresult_ok      if successful
+            other error code if there is a (communications) error
+    @note   In sync mode the whole frame appears at once (tear-free), one 
+            telegram after the last dirty triplet was sent. Without sync 
+            mode this is the same as aomw_topo_fb_flush().
+    @note   When the flush fails no sync is sent, so the (SAIDs of the) 
+            chain keep showing the previous frame.
+*/
+aoresult_t aomw_topo_fb_commit_ctx( aomw_topo_ctx_t * ctx ) {
+  aoresult_t result= aomw_topo_fb_flush_ctx(ctx);
+  if( result!=aoresult_ok || !ctx->sync ) return result;
+  return aomw_topo_sync_ctx(ctx);
+}
+
+
+// === zones ================================================================
+
+
+// A zone is a set of (logical) triplets, eg "left wing" or "status LEDs on 
+// the MCU board". It is a bitset, so set operations are a few word 
+// operations, and the fill routines walk the set bits word by word (skipping
+// empty words), so a group update scales with the size of the set, not with
+// the length of the chain. The application owns the zones (eg static 
+// variables); they are not tied to a topology generation, so recompute them
+// after a build changed the chain (or the remap).
+
+
+/*!
+    @brief  Makes `zone` empty.
+    @param  zone
+            The zone.
+*/
+void aomw_topo_zone_clear( aomw_topo_zone_t * zone ) {
+  memset(zone, 0, sizeof *zone);
+}
+
+
+/*!
+    @brief  Adds triplets `tix0` up to (but excluding) `tix1` to `zone`.
+    @param  zone
+            The zone.
+    @param  tix0
+            The (logical) index of the first triplet to add.
+    @param  tix1
+            The (logical) index of the triplet after the last one to add.
+    @note   0 <= tix0 <= tix1 <= AOMW_TOPO_MAXTRIPLETS.
+    @note   Use aomw_topo_zone_addrange(zone,tix,tix+1) to add one triplet.
+*/
+void aomw_topo_zone_addrange( aomw_topo_zone_t * zone, uint16_t tix0, uint16_t tix1 ) {
+  AORESULT_ASSERT( tix0<=tix1 && tix1<=AOMW_TOPO_MAXTRIPLETS );
+  for( uint16_t tix=tix0; tix<tix1; tix++ ) zone->bits[tix/32] |= 1UL << (tix%32);
+}
+
+
+/*!
+    @brief  Removes triplets `tix0` up to (but excluding) `tix1` from `zone`.
+    @param  zone
+            The zone.
+    @param  tix0
+            The (logical) index of the first triplet to remove.
+    @param  tix1
+            The (logical) index of the triplet after the last one to remove.
+    @note   0 <= tix0 <= tix1 <= AOMW_TOPO_MAXTRIPLETS.
+*/
+void aomw_topo_zone_removerange( aomw_topo_zone_t * zone, uint16_t tix0, uint16_t tix1 ) {
+  AORESULT_ASSERT( tix0<=tix1 && tix1<=AOMW_TOPO_MAXTRIPLETS );
+  for( uint16_t tix=tix0; tix<tix1; tix++ ) zone->bits[tix/32] &= ~(1UL << (tix%32));
+}
+
+
+/*!
+    @brief  Adds the triplets of node `addr` to `zone`.
+    @param  ctx
+            The context (the chain) to operate on.
+    @param  zone
+            The zone.
+    @param  addr
+            The address of the node (1 <= addr <= aomw_topo_numnodes()).
+    @note   The node's triplets are physical; they are added with their 
+            logical index (see aomw_topo_remap_logical()).
+    @note   For example, the status LEDs on the MCU board at the start of
+            the chain are aomw_topo_zone_addnode(zone,1).
+*/
+void aomw_topo_zone_addnode_ctx( aomw_topo_ctx_t * ctx, aomw_topo_zone_t * zone, uint16_t addr ) {
+  AORESULT_ASSERT( 1<=addr && addr<=ctx->numnodes );
+  uint16_t ptix0= aomw_topo_rec_triplet1(ctx, addr);
+  for( uint16_t ptix=ptix0; ptix<ptix0+aomw_topo_rec_numtriplets(ctx, addr); ptix++ ) {
+    uint16_t tix= aomw_topo_remap_logical_ctx(ctx, ptix);
+    zone->bits[tix/32] |= 1UL << (tix%32);
+  }
+}
+
+
+/*!
+    @brief  Returns if triplet `tix` is in `zone`.
+    @param  zone
+            The zone.
+    @param  tix
+            The (logical) index of the triplet.
+    @return 1 if in zone, 0 otherwise.
+*/
+int aomw_topo_zone_has( const aomw_topo_zone_t * zone, uint16_t tix ) {
+  AORESULT_ASSERT( tix<AOMW_TOPO_MAXTRIPLETS );
+  return (zone->bits[tix/32] >> (tix%32)) & 1;
+}
+
+
+/*!
+    @brief  Returns the number of triplets in `zone`.
+    @param  zone
+            The zone.
+    @return The number of triplets.
+*/
+int aomw_topo_zone_count( const aomw_topo_zone_t * zone ) {
+  int num= 0;
+  for( int wix=0; wix<AOMW_TOPO_ZONE_NUMWORDS; wix++ ) num+= __builtin_popcountl(zone->bits[wix]);
+  return num;
+}
+
+
+/*!
+    @brief  Computes the union of two zones: `dst` = `z1` + `z2`.
+    @param  dst
+            The result; may be the same as z1 or z2.
+    @param  z1
+            The first operand.
+    @param  z2
+            The second operand.
+*/
+void aomw_topo_zone_union( aomw_topo_zone_t * dst, const aomw_topo_zone_t * z1, const aomw_topo_zone_t * z2 ) {
+  for( int wix=0; wix<AOMW_TOPO_ZONE_NUMWORDS; wix++ ) dst->bits[wix]= z1->bits[wix] | z2->bits[wix];
+}
+
+
+/*!
+    @brief  Computes the intersection of two zones: `dst` = `z1` * `z2`.
+    @param  dst
+            The result; may be the same as z1 or z2.
+    @param  z1
+            The first operand.
+    @param  z2
+            The second operand.
+*/
+void aomw_topo_zone_intersect( aomw_topo_zone_t * dst, const aomw_topo_zone_t * z1, const aomw_topo_zone_t * z2 ) {
+  for( int wix=0; wix<AOMW_TOPO_ZONE_NUMWORDS; wix++ ) dst->bits[wix]= z1->bits[wix] & z2->bits[wix];
+}
+
+
+/*!
+    @brief  Computes the difference of two zones: `dst` = `z1` - `z2`.
+    @param  dst
+            The result; may be the same as z1 or z2.
+    @param  z1
+            The first operand.
+    @param  z2
+            The second operand (the triplets to remove from z1).
+    @note   The complement of a zone is the difference with a zone of all 
+            triplets (aomw_topo_zone_addrange(all,0,aomw_topo_numtriplets())).
+*/
+void aomw_topo_zone_diff( aomw_topo_zone_t * dst, const aomw_topo_zone_t * z1, const aomw_topo_zone_t * z2 ) {
+  for( int wix=0; wix<AOMW_TOPO_ZONE_NUMWORDS; wix++ ) dst->bits[wix]= z1->bits[wix] & ~z2->bits[wix];
+}
+
+
+/*!
+    @brief  Sets the color for all triplets in `zone` to `rgb`; a "zone fill".
+    @param  ctx
+            The context (the chain) to operate on.
+    @param  zone
+            The zone.
+    @param  rgb
+            A topo color, components 0..AOMW_TOPO_BRIGHTNESS_MAX.
+    @return aoresult_ok      if successful
+            aoresult_other   if a power budget is set, and sending would 
+                             take the chain over it
+            other error code if there is a (communications) error
+    @note   Only available after aomw_topo_build() - or start/step.
+    @note   Sends one telegram per triplet in the zone (in logical order);
+            the color is dimmed only once. Triplets beyond 
+            aomw_topo_numtriplets() are ignored.
+    @note   The framebuffer is set to `rgb` for the zone (not dirty).
+    @note   With a power budget (aomw_topo_power_budget_set()), the zone
+            goes via the framebuffer, like aomw_topo_settriplet().
+*/
+aoresult_t aomw_topo_zone_settriplets_ctx( aomw_topo_ctx_t * ctx, const aomw_topo_zone_t * zone, const aomw_topo_rgb_t * rgb ) {
+  if( ctx->power_budget_ua!=0 ) return aomw_topo_power_setzone(ctx, zone, rgb);
+  // We dim brightness here to prevent under voltage
+  uint16_t r = (rgb->r)*ctx->dim/1024; 
+  uint16_t g = (rgb->g)*ctx->dim/1024; 
+  uint16_t b = (rgb->b)*ctx->dim/1024; 
+  int numwords= (ctx->remap_num+31)/32;
+  for( int wix=0; wix<numwords; wix++ ) {
+    uint32_t bits= zone->bits[wix];
+    while( bits ) {
+      int bix= __builtin_ctzl(bits);
+      bits &= bits-1;
+      uint16_t tix= wix*32 + bix;
+      if( tix>=ctx->numtriplets ) break;
+      aoresult_t result= aomw_topo_sendtriplet(ctx, tix, r, g, b);
+      if( result!=aoresult_ok ) return result;
+      aomw_topo_fb_sent(ctx, tix, rgb, r, g, b);
+    }
+  }
+  return aoresult_ok;
+}
+
+
+/*!
+    @brief  Sets the color for all triplets in `zone` to `rgb` in the 
+            framebuffer; like aomw_topo_fb_set() for each triplet.
+    @param  ctx
+            The context (the chain) to operate on.
+    @param  zone
+            The zone.
+    @param  rgb
+            A topo color, components 0..AOMW_TOPO_BRIGHTNESS_MAX.
+    @note   No telegrams are sent; see aomw_topo_zone_flush() or 
+            aomw_topo_fb_flush().
+*/
+void aomw_topo_zone_fb_set_ctx( aomw_topo_ctx_t * ctx, const aomw_topo_zone_t * zone, const aomw_topo_rgb_t * rgb ) {
+  int numwords= (ctx->remap_num+31)/32;
+  for( int wix=0; wix<numwords; wix++ ) {
+    uint32_t bits= zone->bits[wix];
+    while( bits ) {
+      int bix= __builtin_ctzl(bits);
+      bits &= bits-1;
+      uint16_t tix= wix*32 + bix;
+      if( tix>=ctx->remap_num ) break;
+      aomw_topo_fb_set_ctx(ctx, tix, rgb);
+    }
+  }
+}
+
+
+// Power: returns the estimated current (uA) of the chain after sending the dirty triplets in `zone` with dim level `dim`.
+static uint32_t aomw_topo_power_zone( aomw_topo_ctx_t * ctx, const aomw_topo_zone_t * zone, int dim ) {
+  uint32_t ua= ctx->power_chain_ua;
+  int numwords= (ctx->remap_num+31)/32;
+  for( int wix=0; wix<numwords; wix++ ) {
+    uint32_t bits= ctx->fb_dirty[wix];
+    if( ctx->remap_isidentity ) bits &= zone->bits[wix];
+    while( bits ) {
+      int bix= __builtin_ctzl(bits);
+      bits &= bits-1;
+      uint16_t ptix= wix*32 + bix;
+      if( !ctx->remap_isidentity && !aomw_topo_zone_has(zone,ctx->remap_p2l[ptix]) ) continue;
+      const aomw_topo_fbpix_t * pix= &ctx->fb[ptix];
+      ua+= aomw_topo_power_triplet(ctx, ptix, (pix->r)*dim/1024, (pix->g)*dim/1024, (pix->b)*dim/1024);
+      ua-= ctx->power_sent_ua[ptix];
+    }
+  }
+  return ua;
+}
+
+
+/*!
+    @brief  Sends the dirty triplets of the framebuffer that are in `zone`.
+    @param  ctx
+            The context (the chain) to operate on.
+    @param  zone
+            The zone.
+    @return aoresult_ok      if successful
+            other error code if there is a (communications) error
+    @note   Like aomw_topo_fb_flush(), but restricted to a zone; dirty 
+            triplets outside the zone stay dirty.
+    @note   Sends in physical order. Without remap the dirty bits and the 
+            zone bits are and-ed a word at a time; with a remap each 
+            dirty triplet is looked up in the zone.
+    @note   With a power budget, when the dim level is lowered, or when 
+            sending the zone would take the chain over the budget (the 
+            triplets outside the zone still show their old colors), the 
+            whole framebuffer is flushed instead.
+*/
+aoresult_t aomw_topo_zone_flush_ctx( aomw_topo_ctx_t * ctx, const aomw_topo_zone_t * zone ) {
+  int fb_dim= ctx->fb_dim;
+  int dim= aomw_topo_power_flushdim(ctx);
+  if( ctx->power_budget_ua!=0 && ( dim<fb_dim || aomw_topo_power_zone(ctx, zone, dim)>ctx->power_budget_ua ) ) return aomw_topo_fb_flush_ctx(ctx);
+  int max= INT_MAX;
+  return aomw_topo_fb_sendsome(ctx, zone, &max, dim);
+}
+
+
+// Power: sets the (logical) triplets in `zone` to `rgb` via the framebuffer and sends them, when the chain stays within the budget.
+// Other dirty triplets are not sent, and the level is not lowered (that is up to a flush); returns aoresult_other when over budget.
+static aoresult_t aomw_topo_power_setzone( aomw_topo_ctx_t * ctx, const aomw_topo_zone_t * zone, const aomw_topo_rgb_t * rgb ) {
+  uint16_t num= 0;
+  int numwords= (ctx->remap_num+31)/32;
+  for( int wix=0; wix<numwords; wix++ ) {
+    uint32_t bits= zone->bits[wix];
+    while( bits ) {
+      int bix= __builtin_ctzl(bits);
+      bits &= bits-1;
+      uint16_t tix= wix*32 + bix;
+      if( tix>=ctx->remap_num ) break;
+      aomw_topo_fb_force(ctx, tix, rgb); // a set always sends, also when the color did not change
+      num++;
+    }
+  }
+  if( num==ctx->remap_num ) return aomw_topo_fb_flush_ctx(ctx); // whole chain: may use broadcasts
+  // Send with the level the chain shows (or the dim level, when lower), only when the chain then stays within the budget
+  int dim= ctx->fb_dim<ctx->dim ? ctx->fb_dim : ctx->dim;
+  if( aomw_topo_power_zone(ctx, zone, dim)>ctx->power_budget_ua ) return aoresult_other; // stay dirty; a flush lowers the level
+  int max= INT_MAX;
+  return aomw_topo_fb_sendsome(ctx, zone, &max, dim);
 }
 
 
@@ -717,6 +2883,8 @@ int aomw_topo_dim_get() {
     @brief  Searches the entire OSP chain for SAIDs with an I2C bridge, 
             and on the associated I2C bus searches for an I2C device with 
             address `daddr7`.
+    @param  ctx
+            The context (the chain) to operate on.
     @param  daddr7
             The 7bits I2C device address to be searched for.
     @param  addr
@@ -727,11 +2895,11 @@ int aomw_topo_dim_get() {
     @note   Only available after aomw_topo_build() - or start/step.
     @note   The search is from upstream (low addr) to downstream (high addr).
 */
-aoresult_t aomw_topo_i2cfind( int daddr7, uint16_t * addr ) {
+aoresult_t aomw_topo_i2cfind_ctx( aomw_topo_ctx_t * ctx, int daddr7, uint16_t * addr ) {
   *addr= 0xFFFF;
   if( addr==0 ) return aoresult_outargnull;
-  for( uint16_t iix=0; iix<aomw_topo_numi2cbridges_; iix++ ) {
-    uint16_t ad= aomw_topo_i2cbridge_addr_[iix];
+  for( uint16_t iix=0; iix<ctx->numi2cbridges; iix++ ) {
+    uint16_t ad= ctx->i2cbridge_addr[iix];
     uint8_t buf[8];
     aoresult_t result = aoosp_exec_i2cread8(ad, daddr7, 0x00, buf, 1);
     int i2cfail=  result==aoresult_dev_i2cnack || result==aoresult_dev_i2ctimeout;
@@ -743,6 +2911,397 @@ aoresult_t aomw_topo_i2cfind( int daddr7, uint16_t * addr ) {
 
 
 
+// === scene ================================================================
+
+
+// A scene is the content of the framebuffer plus the dim level, saved in 
+// an EEPROM (aomw_topo_scene_save). After power loss, the build restores 
+// the scene (see aomw_topo_scene_boot): right after the chain goes active,
+// it loads the scene and streams it to the chain, so the installation is 
+// lit before the application renders anything.
+//
+// The scene is run-length encoded (in physical triplet order, the order in
+// which it is streamed), either with a palette (full precision colors, a 
+// byte per run for the color) or direct (8 bits per component per run); 
+// the smaller one is used. The EEPROM format (multi byte values are little
+// endian):
+//
+//   offset  size  field
+//   0       1     magic 'S'
+//   1       1     version (AOMW_TOPO_SCENE_VERSION)
+//   2       1     encoding: AOMW_TOPO_SCENE_FLAGS_DIRECT or AOMW_TOPO_SCENE_FLAGS_PALETTE
+//   3       1     numcolors C (palette; 0 for direct)
+//   4       2     dim level
+//   6       4     topo hash (aomw_topo_hash) of the chain the scene is for
+//   10      2     numtriplets
+//   12      1     numruns R
+//   13      6*C   palette: r, g, b (16 bit each)
+//   ..      2*R   palette runs: length (1..255), palette index
+//   ..      4*R   direct runs: length (1..255), r, g, b (the upper 8 of the 15 bits)
+//   ..      1     checksum: all bytes (including this one) sum to 0 (mod 256)
+
+
+#define AOMW_TOPO_SCENE_VERSION    1
+#define AOMW_TOPO_SCENE_HDRSIZE    13
+#define AOMW_TOPO_SCENE_MAXCOLORS  32  // Max palette size
+#define AOMW_TOPO_SCENE_CHUNK      8   // Bytes loaded per build step
+
+
+// Returns the checksum byte that makes the `len` bytes of `buf` plus the checksum sum to 0.
+static uint8_t aomw_topo_scene_checksum( const uint8_t * buf, int len ) {
+  uint8_t sum= 0;
+  for( int i=0; i<len; i++ ) sum+= buf[i];
+  return -sum;
+}
+
+
+// Returns if framebuffer entries are equal.
+static int aomw_topo_scene_same( const aomw_topo_fbpix_t * p1, const aomw_topo_fbpix_t * p2 ) {
+  return p1->r==p2->r && p1->g==p2->g && p1->b==p2->b;
+}
+
+
+// Encodes the framebuffer as scene in ctx->scene_buf; returns the size, or -1 when it does not fit.
+static int aomw_topo_scene_encode( aomw_topo_ctx_t * ctx, int flags ) {
+  uint16_t num= ctx->remap_num;
+  uint8_t * buf= ctx->scene_buf;
+  // Count runs and palette colors (palette indices are parked in buf, after the header area)
+  int numruns= 0;
+  int numcolors= 0;
+  aomw_topo_fbpix_t palette[AOMW_TOPO_SCENE_MAXCOLORS];
+  for( uint16_t ptix=0; ptix<num; ) {
+    uint16_t end= ptix+1;
+    while( end<num && end-ptix<255 && aomw_topo_scene_same(&ctx->fb[end],&ctx->fb[ptix]) ) end++;
+    int cix= 0;
+    while( cix<numcolors && !aomw_topo_scene_same(&palette[cix],&ctx->fb[ptix]) ) cix++;
+    if( cix==numcolors && numcolors<=AOMW_TOPO_SCENE_MAXCOLORS ) { if( numcolors<AOMW_TOPO_SCENE_MAXCOLORS ) palette[cix]= ctx->fb[ptix]; numcolors++; }
+    numruns++;
+    ptix= end;
+  }
+  if( numruns>255 ) return -1;
+  int palsize= numcolors<=AOMW_TOPO_SCENE_MAXCOLORS ? AOMW_TOPO_SCENE_HDRSIZE + 6*numcolors + 2*numruns + 1 : AOMW_TOPO_SCENE_MAXSIZE+1;
+  int dirsize= AOMW_TOPO_SCENE_HDRSIZE + 4*numruns + 1;
+  int palette_enc;
+  if( flags==AOMW_TOPO_SCENE_FLAGS_PALETTE ) palette_enc= 1;
+  else if( flags==AOMW_TOPO_SCENE_FLAGS_DIRECT ) palette_enc= 0;
+  else palette_enc= palsize<=dirsize;
+  int len= palette_enc ? palsize : dirsize;
+  if( len>AOMW_TOPO_SCENE_MAXSIZE ) return -1;
+  // Header
+  buf[0]= 'S';
+  buf[1]= AOMW_TOPO_SCENE_VERSION;
+  buf[2]= palette_enc ? AOMW_TOPO_SCENE_FLAGS_PALETTE : AOMW_TOPO_SCENE_FLAGS_DIRECT;
+  buf[3]= palette_enc ? numcolors : 0;
+  aomw_topo_snapshot_put16(buf+4, ctx->dim);
+  aomw_topo_snapshot_put32(buf+6, ctx->hash);
+  aomw_topo_snapshot_put16(buf+10, num);
+  buf[12]= numruns;
+  uint8_t * p= buf+AOMW_TOPO_SCENE_HDRSIZE;
+  if( palette_enc ) {
+    for( int cix=0; cix<numcolors; cix++ ) {
+      aomw_topo_snapshot_put16(p+0, palette[cix].r);
+      aomw_topo_snapshot_put16(p+2, palette[cix].g);
+      aomw_topo_snapshot_put16(p+4, palette[cix].b);
+      p+= 6;
+    }
+  }
+  // Runs
+  for( uint16_t ptix=0; ptix<num; ) {
+    uint16_t end= ptix+1;
+    while( end<num && end-ptix<255 && aomw_topo_scene_same(&ctx->fb[end],&ctx->fb[ptix]) ) end++;
+    *p++= end-ptix;
+    if( palette_enc ) {
+      int cix= 0;
+      while( !aomw_topo_scene_same(&palette[cix],&ctx->fb[ptix]) ) cix++;
+      *p++= cix;
+    } else {
+      *p++= ctx->fb[ptix].r >> 7;
+      *p++= ctx->fb[ptix].g >> 7;
+      *p++= ctx->fb[ptix].b >> 7;
+    }
+    ptix= end;
+  }
+  *p= aomw_topo_scene_checksum(buf, len-1);
+  return len;
+}
+
+
+/*!
+    @brief  Saves the framebuffer and the dim level as scene in an EEPROM.
+    @param  ctx
+            The context (the chain) to operate on.
+    @param  addr
+            The address of the OSP node with the I2C bridge to the EEPROM.
+    @param  daddr7
+            The I2C device address of the EEPROM (AOMW_EEPROM_DADDR7_XXX).
+    @param  raddr
+            The address in the EEPROM where the scene starts.
+    @param  flags
+            AOMW_TOPO_SCENE_FLAGS_AUTO (the smallest encoding), 
+            AOMW_TOPO_SCENE_FLAGS_PALETTE, or AOMW_TOPO_SCENE_FLAGS_DIRECT.
+    @param  len
+            Output: the size of the scene in the EEPROM; may be NULL.
+    @return aoresult_ok          if successful
+            aoresult_outofmem    if the scene does not fit (after raddr)
+            other error code if there is a (communications) error
+    @note   The framebuffer is the scene, so render the scene with 
+            aomw_topo_fb_set() (or aomw_fx); direct settriplet calls 
+            are not part of it.
+    @note   The scene is run-length encoded; a palette keeps colors exact
+            (max 32 colors), direct encoding keeps 8 bits per component.
+            A uniform or banded scene is a few dozen bytes.
+    @note   The EEPROM is only written when its content differs (EEPROMs
+            wear, and a write takes 5ms per 6 bytes).
+    @note   The scene includes the topo hash; it is only restored on the 
+            same chain.
+*/
+aoresult_t aomw_topo_scene_save_ctx( aomw_topo_ctx_t * ctx, uint16_t addr, uint8_t daddr7, uint8_t raddr, int flags, int * len ) {
+  int size= aomw_topo_scene_encode(ctx, flags);
+  if( size<0 || raddr+size>AOMW_TOPO_SCENE_MAXSIZE ) return aoresult_outofmem;
+  if( len!=NULL ) *len= size;
+  aoresult_t result= aomw_eeprom_compare(addr, daddr7, raddr, ctx->scene_buf, size);
+  if( result==aoresult_ok ) return aoresult_ok; // already saved
+  return aomw_eeprom_write(addr, daddr7, raddr, ctx->scene_buf, size);
+}
+
+
+/*!
+    @brief  Configures the build to restore the scene from an EEPROM.
+    @param  ctx
+            The context (the chain) to operate on.
+    @param  addr
+            The address of the OSP node with the I2C bridge to the EEPROM;
+            0 to not restore.
+    @param  daddr7
+            The I2C device address of the EEPROM.
+    @param  raddr
+            The address in the EEPROM where the scene starts.
+    @note   Call before aomw_topo_build() (or start). After the chain goes
+            active, the build loads the scene (a chunk of 8 bytes per step)
+            and sends it (a triplet per step, in chain order), and sets the
+            dim level. The framebuffer is filled with the scene (not dirty).
+    @note   Only the first build (after this call) restores the scene. 
+            Later builds (rebuilds) skip it, unless the map hash differs 
+            from the previous build, so they do not override the 
+            framebuffer and dim level set by the application.
+    @note   A scene that can not be loaded (no EEPROM, no or corrupt scene,
+            or a scene for a different chain) is skipped; the build still
+            succeeds. See aomw_topo_scene_restored().
+*/
+void aomw_topo_scene_boot_ctx( aomw_topo_ctx_t * ctx, uint16_t addr, uint8_t daddr7, uint8_t raddr ) {
+  ctx->scene_addr= addr;
+  ctx->scene_daddr7= daddr7;
+  ctx->scene_raddr= raddr;
+  ctx->scene_booted= 0;
+}
+
+
+/*!
+    @brief  Returns if the last build restored a scene.
+    @param  ctx
+            The context (the chain) to operate on.
+    @return 1 if a scene was restored, 0 otherwise.
+*/
+int aomw_topo_scene_restored_ctx( aomw_topo_ctx_t * ctx ) {
+  return ctx->scene_restored;
+}
+
+
+// Decodes the color of the run at `p` (in the loaded scene) into `color`; returns the size of the run.
+static int aomw_topo_scene_run( aomw_topo_ctx_t * ctx, const uint8_t * p, aomw_topo_fbpix_t * color ) {
+  const uint8_t * buf= ctx->scene_buf;
+  if( buf[2]==AOMW_TOPO_SCENE_FLAGS_PALETTE ) {
+    int cix= p[1]<buf[3] ? p[1] : 0;
+    const uint8_t * pal= buf+AOMW_TOPO_SCENE_HDRSIZE+6*cix;
+    color->r= aomw_topo_snapshot_get16(pal+0);
+    color->g= aomw_topo_snapshot_get16(pal+2);
+    color->b= aomw_topo_snapshot_get16(pal+4);
+    return 2;
+  }
+  color->r= p[1]<<7 | p[1]>>1;
+  color->g= p[2]<<7 | p[2]>>1;
+  color->b= p[3]<<7 | p[3]>>1;
+  return 4;
+}
+
+
+// Build: prepares loading the scene.
+static void aomw_topo_scene_loadstart( aomw_topo_ctx_t * ctx ) {
+  ctx->scene_restored= 0;
+  ctx->scene_len= 0;
+  ctx->scene_pos= 0;
+}
+
+
+// Build: loads the header or a chunk of the scene; returns AOMW_TOPO_SCENE_LOAD_XXX.
+static int aomw_topo_scene_loadstep( aomw_topo_ctx_t * ctx ) {
+  if( ctx->scene_addr==0 ) return AOMW_TOPO_SCENE_LOAD_NONE;
+  uint8_t * buf= ctx->scene_buf;
+  if( ctx->scene_pos==0 ) {
+    // Only the first build (since boot), or a build that found a different map, restores
+    int same= ctx->scene_booted && ctx->scene_boothash==ctx->hash;
+    ctx->scene_booted= 1;
+    ctx->scene_boothash= ctx->hash;
+    if( same ) return AOMW_TOPO_SCENE_LOAD_NONE;
+    // Header
+    aoresult_t result= aomw_eeprom_read(ctx->scene_addr, ctx->scene_daddr7, ctx->scene_raddr, buf, AOMW_TOPO_SCENE_HDRSIZE);
+    if( result!=aoresult_ok ) return AOMW_TOPO_SCENE_LOAD_NONE;
+    if( buf[0]!='S' || buf[1]!=AOMW_TOPO_SCENE_VERSION ) return AOMW_TOPO_SCENE_LOAD_NONE;
+    if( aomw_topo_snapshot_get32(buf+6)!=ctx->hash || aomw_topo_snapshot_get16(buf+10)!=ctx->remap_num ) return AOMW_TOPO_SCENE_LOAD_NONE;
+    int numcolors= buf[3];
+    int numruns= buf[12];
+    if( buf[2]==AOMW_TOPO_SCENE_FLAGS_PALETTE ) ctx->scene_len= AOMW_TOPO_SCENE_HDRSIZE + 6*numcolors + 2*numruns + 1;
+    else if( buf[2]==AOMW_TOPO_SCENE_FLAGS_DIRECT ) ctx->scene_len= AOMW_TOPO_SCENE_HDRSIZE + 4*numruns + 1;
+    else return AOMW_TOPO_SCENE_LOAD_NONE;
+    if( ctx->scene_raddr+ctx->scene_len>AOMW_TOPO_SCENE_MAXSIZE ) return AOMW_TOPO_SCENE_LOAD_NONE;
+    ctx->scene_pos= AOMW_TOPO_SCENE_HDRSIZE;
+    return AOMW_TOPO_SCENE_LOAD_BUSY;
+  }
+  if( ctx->scene_pos<ctx->scene_len ) {
+    // Chunk of palette and runs
+    int chunk= ctx->scene_len-ctx->scene_pos;
+    if( chunk>AOMW_TOPO_SCENE_CHUNK ) chunk= AOMW_TOPO_SCENE_CHUNK;
+    aoresult_t result= aomw_eeprom_read(ctx->scene_addr, ctx->scene_daddr7, ctx->scene_raddr+ctx->scene_pos, buf+ctx->scene_pos, chunk);
+    if( result!=aoresult_ok ) return AOMW_TOPO_SCENE_LOAD_NONE;
+    ctx->scene_pos+= chunk;
+    return AOMW_TOPO_SCENE_LOAD_BUSY;
+  }
+  // Complete: check, then prepare streaming
+  if( aomw_topo_scene_checksum(buf, ctx->scene_len)!=0 ) return AOMW_TOPO_SCENE_LOAD_NONE;
+  int runs= AOMW_TOPO_SCENE_HDRSIZE + (buf[2]==AOMW_TOPO_SCENE_FLAGS_PALETTE ? 6*buf[3] : 0);
+  int sum= 0;
+  for( int rix=0; rix<buf[12]; rix++ ) sum+= buf[runs + rix*(buf[2]==AOMW_TOPO_SCENE_FLAGS_PALETTE?2:4)];
+  if( sum!=ctx->remap_num ) return AOMW_TOPO_SCENE_LOAD_NONE;
+  aomw_topo_dim_set_ctx(ctx, aomw_topo_snapshot_get16(buf+4) );
+  // Scale the scene to the power budget, like a flush
+  uint32_t ua= 0;
+  uint16_t ptix= 0;
+  for( int pos=runs, rix=0; rix<buf[12]; rix++ ) {
+    aomw_topo_fbpix_t color;
+    int num= buf[pos];
+    pos+= aomw_topo_scene_run(ctx, buf+pos, &color);
+    for( ; num>0; num--, ptix++ ) ua+= aomw_topo_power_triplet(ctx, ptix, color.r, color.g, color.b);
+  }
+  ctx->fb_dim= aomw_topo_power_fit(ctx, ua);
+  ctx->scene_pos= runs;
+  ctx->scene_runleft= 0;
+  ctx->scene_ptix= 0;
+  return AOMW_TOPO_SCENE_LOAD_LOADED;
+}
+
+
+// Build: sends the next triplet of the loaded scene.
+static aoresult_t aomw_topo_scene_streamstep( aomw_topo_ctx_t * ctx ) {
+  const uint8_t * buf= ctx->scene_buf;
+  if( ctx->scene_runleft==0 ) {
+    // Decode next run
+    ctx->scene_runleft= buf[ctx->scene_pos];
+    ctx->scene_pos+= aomw_topo_scene_run(ctx, buf+ctx->scene_pos, &ctx->scene_color);
+  }
+  uint16_t ptix= ctx->scene_ptix++;
+  ctx->scene_runleft--;
+  aomw_topo_power_fbchange(ctx, ptix, ctx->scene_color.r, ctx->scene_color.g, ctx->scene_color.b);
+  ctx->fb[ptix]= ctx->scene_color;
+  ctx->fb_dirty[ptix/32] &= ~(1UL << (ptix%32));
+  if( ctx->scene_ptix==ctx->remap_num ) ctx->scene_restored= 1;
+  uint16_t r = (ctx->scene_color.r)*ctx->fb_dim/1024; 
+  uint16_t g = (ctx->scene_color.g)*ctx->fb_dim/1024; 
+  uint16_t b = (ctx->scene_color.b)*ctx->fb_dim/1024; 
+  aoresult_t result= aomw_topo_sendaddrchan(ctx, ctx->triplet_addr[ptix], ctx->triplet_chan[ptix], r, g, b);
+  if( result==aoresult_ok ) aomw_topo_power_sent(ctx, ptix, aomw_topo_power_triplet(ctx, ptix, r, g, b) );
+  return result;
+}
+
+
+// Build: returns if all triplets of the scene are sent.
+static int aomw_topo_scene_streamdone( aomw_topo_ctx_t * ctx ) {
+  return ctx->scene_ptix>=ctx->remap_num;
+}
+
+
+// === default context ======================================================
+
+
+// Every function with suffix _ctx has a wrapper without the suffix, that 
+// operates on the default context. Applications that drive one chain use 
+// these (as do the other aomw modules and the topo command).
+
+
+uint32_t aomw_topo_generation() { return aomw_topo_generation_ctx(&aomw_topo_ctx_default); }
+int aomw_topo_loop() { return aomw_topo_loop_ctx(&aomw_topo_ctx_default); }
+uint16_t aomw_topo_numnodes() { return aomw_topo_numnodes_ctx(&aomw_topo_ctx_default); }
+uint32_t aomw_topo_node_id( uint16_t addr ) { return aomw_topo_node_id_ctx(&aomw_topo_ctx_default, addr); }
+uint8_t aomw_topo_node_numtriplets( uint16_t addr ) { return aomw_topo_node_numtriplets_ctx(&aomw_topo_ctx_default, addr); }
+uint16_t aomw_topo_node_triplet1( uint16_t addr ) { return aomw_topo_node_triplet1_ctx(&aomw_topo_ctx_default, addr); }
+uint8_t aomw_topo_node_chanmask( uint16_t addr ) { return aomw_topo_node_chanmask_ctx(&aomw_topo_ctx_default, addr); }
+aoresult_t aomw_topo_chanmask_override( uint16_t addr, uint8_t mask ) { return aomw_topo_chanmask_override_ctx(&aomw_topo_ctx_default, addr, mask); }
+uint16_t aomw_topo_numtriplets() { return aomw_topo_numtriplets_ctx(&aomw_topo_ctx_default); }
+uint16_t aomw_topo_triplet_addr( uint16_t tix ) { return aomw_topo_triplet_addr_ctx(&aomw_topo_ctx_default, tix); }
+int aomw_topo_triplet_onchan( uint16_t tix ) { return aomw_topo_triplet_onchan_ctx(&aomw_topo_ctx_default, tix); }
+uint8_t aomw_topo_triplet_chan( uint16_t tix ) { return aomw_topo_triplet_chan_ctx(&aomw_topo_ctx_default, tix); }
+uint16_t aomw_topo_numi2cbridges() { return aomw_topo_numi2cbridges_ctx(&aomw_topo_ctx_default); }
+uint16_t aomw_topo_i2cbridge_addr( uint16_t iix ) { return aomw_topo_i2cbridge_addr_ctx(&aomw_topo_ctx_default, iix); }
+void aomw_topo_dump_summary() { aomw_topo_dump_summary_ctx(&aomw_topo_ctx_default); }
+void aomw_topo_dump_nodes() { aomw_topo_dump_nodes_ctx(&aomw_topo_ctx_default); }
+void aomw_topo_dump_triplets() { aomw_topo_dump_triplets_ctx(&aomw_topo_ctx_default); }
+void aomw_topo_dump_i2cbridges() { aomw_topo_dump_i2cbridges_ctx(&aomw_topo_ctx_default); }
+void aomw_topo_dumpcsv_start() { aomw_topo_dumpcsv_start_ctx(&aomw_topo_ctx_default); }
+void aomw_topo_dumpcsv_step() { aomw_topo_dumpcsv_step_ctx(&aomw_topo_ctx_default); }
+int aomw_topo_dumpcsv_done() { return aomw_topo_dumpcsv_done_ctx(&aomw_topo_ctx_default); }
+void aomw_topo_dumpcsv() { aomw_topo_dumpcsv_ctx(&aomw_topo_ctx_default); }
+uint32_t aomw_topo_hash() { return aomw_topo_hash_ctx(&aomw_topo_ctx_default); }
+aoresult_t aomw_topo_diff( aomw_topo_diff_t * diff ) { return aomw_topo_diff_ctx(&aomw_topo_ctx_default, diff); }
+int aomw_topo_diff_node( uint16_t addr ) { return aomw_topo_diff_node_ctx(&aomw_topo_ctx_default, addr); }
+int aomw_topo_snapshot_size() { return aomw_topo_snapshot_size_ctx(&aomw_topo_ctx_default); }
+aoresult_t aomw_topo_snapshot_export( uint8_t * buf, int size, int * len ) { return aomw_topo_snapshot_export_ctx(&aomw_topo_ctx_default, buf, size, len); }
+aoresult_t aomw_topo_snapshot_import( const uint8_t * buf, int len ) { return aomw_topo_snapshot_import_ctx(&aomw_topo_ctx_default, buf, len); }
+int aomw_topo_snapshot_preloaded() { return aomw_topo_snapshot_preloaded_ctx(&aomw_topo_ctx_default); }
+void aomw_topo_fixed_install( const aomw_topo_fixed_t * fixed ) { aomw_topo_fixed_install_ctx(&aomw_topo_ctx_default, fixed); }
+aoresult_t aomw_topo_node_setcurrents( uint16_t addr, uint8_t flags ) { return aomw_topo_node_setcurrents_ctx(&aomw_topo_ctx_default, addr, flags); }
+void aomw_topo_build_start() { aomw_topo_build_start_ctx(&aomw_topo_ctx_default); }
+aoresult_t aomw_topo_build_step() { return aomw_topo_build_step_ctx(&aomw_topo_ctx_default); }
+int aomw_topo_build_done() { return aomw_topo_build_done_ctx(&aomw_topo_ctx_default); }
+aoresult_t aomw_topo_build() { return aomw_topo_build_ctx(&aomw_topo_ctx_default); }
+uint32_t aomw_topo_cost_us( int type ) { return aomw_topo_cost_us_ctx(&aomw_topo_ctx_default, type); }
+void aomw_topo_cost_reset() { aomw_topo_cost_reset_ctx(&aomw_topo_ctx_default); }
+uint32_t aomw_topo_predict_us( int numtriplets ) { return aomw_topo_predict_us_ctx(&aomw_topo_ctx_default, numtriplets); }
+uint32_t aomw_topo_fb_predict_us() { return aomw_topo_fb_predict_us_ctx(&aomw_topo_ctx_default); }
+aoresult_t aomw_topo_settriplet( uint16_t tix, const aomw_topo_rgb_t *rgb ) { return aomw_topo_settriplet_ctx(&aomw_topo_ctx_default, tix, rgb); }
+aoresult_t aomw_topo_settriplets( uint16_t tix0, uint16_t tix1, const aomw_topo_rgb_t *rgb ) { return aomw_topo_settriplets_ctx(&aomw_topo_ctx_default, tix0, tix1, rgb); }
+aoresult_t aomw_topo_settriplet_at( uint16_t addr, uint8_t chan, const aomw_topo_rgb_t *rgb ) { return aomw_topo_settriplet_at_ctx(&aomw_topo_ctx_default, addr, chan, rgb); }
+void aomw_topo_dim_set( int dim ) { aomw_topo_dim_set_ctx(&aomw_topo_ctx_default, dim); }
+int aomw_topo_dim_get() { return aomw_topo_dim_get_ctx(&aomw_topo_ctx_default); }
+void aomw_topo_remap_identity() { aomw_topo_remap_identity_ctx(&aomw_topo_ctx_default); }
+void aomw_topo_remap_mirror( uint16_t tix0, uint16_t tix1 ) { aomw_topo_remap_mirror_ctx(&aomw_topo_ctx_default, tix0, tix1); }
+void aomw_topo_remap_offset( int offset ) { aomw_topo_remap_offset_ctx(&aomw_topo_ctx_default, offset); }
+aoresult_t aomw_topo_remap_permute( const uint16_t * perm, uint16_t num ) { return aomw_topo_remap_permute_ctx(&aomw_topo_ctx_default, perm, num); }
+uint16_t aomw_topo_remap_phys( uint16_t tix ) { return aomw_topo_remap_phys_ctx(&aomw_topo_ctx_default, tix); }
+uint16_t aomw_topo_remap_logical( uint16_t ptix ) { return aomw_topo_remap_logical_ctx(&aomw_topo_ctx_default, ptix); }
+int aomw_topo_remap_isidentity() { return aomw_topo_remap_isidentity_ctx(&aomw_topo_ctx_default); }
+int aomw_topo_fb_set( uint16_t tix, const aomw_topo_rgb_t * rgb ) { return aomw_topo_fb_set_ctx(&aomw_topo_ctx_default, tix, rgb); }
+void aomw_topo_fb_get( uint16_t tix, aomw_topo_rgb_t * rgb ) { aomw_topo_fb_get_ctx(&aomw_topo_ctx_default, tix, rgb); }
+void aomw_topo_fb_invalidate() { aomw_topo_fb_invalidate_ctx(&aomw_topo_ctx_default); }
+int aomw_topo_fb_numdirty() { return aomw_topo_fb_numdirty_ctx(&aomw_topo_ctx_default); }
+aoresult_t aomw_topo_fb_flush() { return aomw_topo_fb_flush_ctx(&aomw_topo_ctx_default); }
+aoresult_t aomw_topo_fb_flush_some( int max ) { return aomw_topo_fb_flush_some_ctx(&aomw_topo_ctx_default, max); }
+aoresult_t aomw_topo_sync_set( int enable ) { return aomw_topo_sync_set_ctx(&aomw_topo_ctx_default, enable); }
+int aomw_topo_sync_get() { return aomw_topo_sync_get_ctx(&aomw_topo_ctx_default); }
+aoresult_t aomw_topo_sync() { return aomw_topo_sync_ctx(&aomw_topo_ctx_default); }
+aoresult_t aomw_topo_fb_commit() { return aomw_topo_fb_commit_ctx(&aomw_topo_ctx_default); }
+void aomw_topo_power_budget_set( uint32_t ma ) { aomw_topo_power_budget_set_ctx(&aomw_topo_ctx_default, ma); }
+uint32_t aomw_topo_power_budget_get() { return aomw_topo_power_budget_get_ctx(&aomw_topo_ctx_default); }
+uint32_t aomw_topo_power_ma() { return aomw_topo_power_ma_ctx(&aomw_topo_ctx_default); }
+int aomw_topo_power_dim() { return aomw_topo_power_dim_ctx(&aomw_topo_ctx_default); }
+void aomw_topo_zone_addnode( aomw_topo_zone_t * zone, uint16_t addr ) { aomw_topo_zone_addnode_ctx(&aomw_topo_ctx_default, zone, addr); }
+aoresult_t aomw_topo_zone_settriplets( const aomw_topo_zone_t * zone, const aomw_topo_rgb_t * rgb ) { return aomw_topo_zone_settriplets_ctx(&aomw_topo_ctx_default, zone, rgb); }
+void aomw_topo_zone_fb_set( const aomw_topo_zone_t * zone, const aomw_topo_rgb_t * rgb ) { aomw_topo_zone_fb_set_ctx(&aomw_topo_ctx_default, zone, rgb); }
+aoresult_t aomw_topo_zone_flush( const aomw_topo_zone_t * zone ) { return aomw_topo_zone_flush_ctx(&aomw_topo_ctx_default, zone); }
+aoresult_t aomw_topo_i2cfind( int daddr7, uint16_t * addr ) { return aomw_topo_i2cfind_ctx(&aomw_topo_ctx_default, daddr7, addr); }
+aoresult_t aomw_topo_scene_save( uint16_t addr, uint8_t daddr7, uint8_t raddr, int flags, int * len ) { return aomw_topo_scene_save_ctx(&aomw_topo_ctx_default, addr, daddr7, raddr, flags, len); }
+void aomw_topo_scene_boot( uint16_t addr, uint8_t daddr7, uint8_t raddr ) { aomw_topo_scene_boot_ctx(&aomw_topo_ctx_default, addr, daddr7, raddr); }
+int aomw_topo_scene_restored() { return aomw_topo_scene_restored_ctx(&aomw_topo_ctx_default); }
+
+
 // === command handler =======================================================
 
 
@@ -755,6 +3314,180 @@ static void aomw_topo_dim_show(  ) {
 }
 
 
+// Names of the build states (for bench)
+static const char * const aomw_topo_build_state_names[] = {
+  "start", "identifying", "clrerror", "enablecrc", "i2cpower", "setcurrent", "goactive", "sceneload", "scenestream", "done"
+};
+
+
+// Prints one line of bench results: `numtele` telegrams for `numtrip` triplet writes in `us` micro seconds
+static void aomw_topo_bench_show( const char * name, uint32_t us, int numtele, int numtrip ) {
+  if( us==0 ) us=1;
+  uint32_t telepersec = (uint64_t)numtele*1000000/us;
+  Serial.printf("%-11s %8luus %6d tele %6lu tele/s", name, (unsigned long)us, numtele, (unsigned long)telepersec );
+  if( numtrip>0 ) Serial.printf(" %5lu.%lu us/triplet", (unsigned long)(us/numtrip), (unsigned long)(us*10/numtrip%10) );
+  Serial.printf("\n");
+}
+
+
+// Runs a timed build (per phase) and timed write workloads, each repeated `num` times
+static aoresult_t aomw_topo_bench( int num ) {
+  aoresult_t result;
+  uint32_t   us[AOMW_TOPO_BUILD_STATE_DONE+1];
+  int        tele[AOMW_TOPO_BUILD_STATE_DONE+1];
+  uint32_t   t0, t1;
+
+  // Build, timing each phase (state) separately
+  for( int state=0; state<=AOMW_TOPO_BUILD_STATE_DONE; state++ ) { us[state]=0; tele[state]=0; }
+  aomw_topo_build_start();
+  while( !aomw_topo_build_done() ) {
+    int state= aomw_topo_ctx_default.build_state;
+    aospi_txcount_reset();
+    t0= micros();
+    result= aomw_topo_build_step();
+    t1= micros();
+    if( result!=aoresult_ok ) return result;
+    us[state]+= t1-t0;
+    tele[state]+= aospi_txcount_get();
+  }
+  uint32_t ustotal= 0;
+  int      teletotal= 0;
+  for( int state=0; state<AOMW_TOPO_BUILD_STATE_DONE; state++ ) {
+    aomw_topo_bench_show(aomw_topo_build_state_names[state], us[state], tele[state], 0);
+    ustotal+= us[state];
+    teletotal+= tele[state];
+  }
+  aomw_topo_bench_show("build", ustotal, teletotal, 0);
+  int numtriplets= aomw_topo_numtriplets();
+  if( numtriplets==0 ) return aoresult_ok;
+
+  // Single triplet writes (alternating on/off, to triplet 0)
+  aospi_txcount_reset();
+  t0= micros();
+  for( int i=0; i<num; i++ ) {
+    result= aomw_topo_settriplet( 0, i%2==0 ? &aomw_topo_white : &aomw_topo_off ); if( result!=aoresult_ok ) return result;
+  }
+  t1= micros();
+  aomw_topo_bench_show("single", t1-t0, aospi_txcount_get(), num);
+
+  // Full chain refresh (every triplet written individually)
+  aospi_txcount_reset();
+  t0= micros();
+  for( int i=0; i<num; i++ ) {
+    for( int tix=0; tix<numtriplets; tix++ ) {
+      result= aomw_topo_settriplet( tix, i%2==0 ? &aomw_topo_white : &aomw_topo_off ); if( result!=aoresult_ok ) return result;
+    }
+  }
+  t1= micros();
+  uint32_t uschain= t1-t0;
+  aomw_topo_bench_show("chain", uschain, aospi_txcount_get(), num*numtriplets);
+
+  // Range fills (entire chain in one call)
+  aospi_txcount_reset();
+  t0= micros();
+  for( int i=0; i<num; i++ ) {
+    result= aomw_topo_settriplets( 0, numtriplets, i%2==0 ? &aomw_topo_white : &aomw_topo_off ); if( result!=aoresult_ok ) return result;
+  }
+  t1= micros();
+  uint32_t usfill= t1-t0;
+  aomw_topo_bench_show("fill", usfill, aospi_txcount_get(), num*numtriplets);
+
+  // Frame rates
+  if( uschain==0 ) uschain=1;
+  if( usfill==0 ) usfill=1;
+  Serial.printf("fps %lu (chain) %lu (fill) for %d triplets\n", (unsigned long)((uint64_t)num*1000000/uschain), (unsigned long)((uint64_t)num*1000000/usfill), numtriplets );
+
+  // Leave chain dark
+  return aomw_topo_settriplets( 0, numtriplets, &aomw_topo_off );
+}
+
+
+// Max number of <tix> <red> <green> <blue> tuples in one "topo pwm" command. Six tuples take 
+// 26 arguments and a line of about 120 characters, within the limits of the command interpreter.
+#define AOMW_TOPO_CMD_MAXTUPLES 6
+
+
+// Parses 4 hex digits at `s` into `val`; returns false if a character is not a hex digit.
+static bool aomw_topo_cmd_hex4( const char * s, uint16_t * val ) {
+  uint16_t v= 0;
+  for( int i=0; i<4; i++ ) {
+    char c= s[i];
+    if( '0'<=c && c<='9' ) v= v*16 + c-'0';
+    else if( 'a'<=c && c<='f' ) v= v*16 + c-'a'+10;
+    else if( 'A'<=c && c<='F' ) v= v*16 + c-'A'+10;
+    else return false;
+  }
+  *val= v;
+  return true;
+}
+
+
+// Sends the dirty triplets of the framebuffer for a bulk "topo pwm"; prints a summary unless quiet.
+static void aomw_topo_cmd_pwmflush( int quiet, int num ) {
+  int numdirty= aomw_topo_fb_numdirty();
+  aoresult_t result= aomw_topo_fb_commit();
+  if( result!=aoresult_ok ) { Serial.printf("ERROR: 'pwm' failed (%s)\n",aoresult_to_str(result,1) ); return; }
+  if( !quiet ) Serial.printf("pwm: %d triplets, %d sent\n",num,numdirty);
+}
+
+
+// Handles "topo pwm <tix> <red> <green> <blue> ...": all tuples are parsed, then set in the framebuffer, then flushed.
+static void aomw_topo_cmd_pwmtuples( int argc, char * argv[] ) {
+  static aomw_topo_rgb_t rgbs[AOMW_TOPO_CMD_MAXTUPLES];
+  static uint16_t        tixs[AOMW_TOPO_CMD_MAXTUPLES];
+  int num= (argc-2)/4;
+  if( num==0 || (argc-2)%4!=0 ) { Serial.printf("ERROR: 'pwm' expects tuples <tix> <red> <green> <blue>\n" ); return; }
+  if( num>AOMW_TOPO_CMD_MAXTUPLES ) { Serial.printf("ERROR: 'pwm' expects at most %d tuples (use 'pwm hex')\n", AOMW_TOPO_CMD_MAXTUPLES ); return; }
+  int numtriplets= aomw_topo_numtriplets();
+  for( int i=0; i<num; i++ ) {
+    char ** arg= argv+2+4*i;
+    int tix;
+    bool ok= aocmd_cint_parse_dec(arg[0],&tix) ;
+    if( !ok || tix<0 || tix>=numtriplets ) { Serial.printf("ERROR: 'pwm' expects <tix> 0..%d, not '%s'\n", numtriplets-1, arg[0] ); return; }
+    tixs[i]= tix;
+    ok= aocmd_cint_parse_hex(arg[1],&rgbs[i].r) && rgbs[i].r<=AOMW_TOPO_BRIGHTNESS_MAX
+     && aocmd_cint_parse_hex(arg[2],&rgbs[i].g) && rgbs[i].g<=AOMW_TOPO_BRIGHTNESS_MAX
+     && aocmd_cint_parse_hex(arg[3],&rgbs[i].b) && rgbs[i].b<=AOMW_TOPO_BRIGHTNESS_MAX;
+    if( !ok ) { Serial.printf("ERROR: 'pwm' expects <red> <green> <blue> 0..%04X for T%d\n", AOMW_TOPO_BRIGHTNESS_MAX, tix ); return; }
+  }
+  for( int i=0; i<num; i++ ) aomw_topo_fb_force(&aomw_topo_ctx_default, tixs[i], &rgbs[i]); // sent even when the framebuffer has the color
+  if( num==1 ) {
+    aomw_topo_cmd_pwmflush(1, num);
+    if( argv[0][0]!='@' ) Serial.printf("pwm T%d: %04X %04X %04X\n",tixs[0],rgbs[0].r, rgbs[0].g, rgbs[0].b);
+    return;
+  }
+  aomw_topo_cmd_pwmflush(argv[0][0]=='@', num);
+}
+
+
+// Handles "topo pwm hex <tix0> <blob>": blob has 12 hex digits (rrrrggggbbbb) per triplet, for triplets from <tix0> on.
+static void aomw_topo_cmd_pwmhex( int argc, char * argv[] ) {
+  if( argc!=5 ) { Serial.printf("ERROR: 'pwm hex' expects <tix0> <blob>\n" ); return; }
+  int numtriplets= aomw_topo_numtriplets();
+  int tix0;
+  bool ok= aocmd_cint_parse_dec(argv[3],&tix0) ;
+  if( !ok || tix0<0 || tix0>=numtriplets ) { Serial.printf("ERROR: 'pwm hex' expects <tix0> 0..%d, not '%s'\n", numtriplets-1, argv[3] ); return; }
+  const char * blob= argv[4];
+  int len= strlen(blob);
+  int num= len/12;
+  if( len%12!=0 || num==0 ) { Serial.printf("ERROR: 'pwm hex' expects 12 hex digits per triplet, not %d digits\n", len ); return; }
+  if( tix0+num>numtriplets ) { Serial.printf("ERROR: 'pwm hex' has %d triplets, %d fit from T%d\n", num, numtriplets-tix0, tix0 ); return; }
+  // Check all (so that an error does not leave a half frame), then set
+  for( int i=0; i<num*3; i++ ) {
+    uint16_t val;
+    if( !aomw_topo_cmd_hex4(blob+4*i,&val) || val>AOMW_TOPO_BRIGHTNESS_MAX ) { Serial.printf("ERROR: 'pwm hex' expects hex 0000..%04X at digit %d\n", AOMW_TOPO_BRIGHTNESS_MAX, 4*i ); return; }
+  }
+  for( int i=0; i<num; i++ ) {
+    aomw_topo_rgb_t rgb;
+    aomw_topo_cmd_hex4(blob+12*i+0,&rgb.r);
+    aomw_topo_cmd_hex4(blob+12*i+4,&rgb.g);
+    aomw_topo_cmd_hex4(blob+12*i+8,&rgb.b);
+    aomw_topo_fb_force(&aomw_topo_ctx_default, tix0+i, &rgb); // sent even when the framebuffer has the color
+  }
+  aomw_topo_cmd_pwmflush(argv[0][0]=='@', num);
+}
+
+
 // The handler for the "topo" command
 static void aomw_topo_cmd( int argc, char * argv[] ) {
   if( argc>1 && aocmd_cint_isprefix("build",argv[1]) ) {
@@ -772,7 +3505,8 @@ static void aomw_topo_cmd( int argc, char * argv[] ) {
     aomw_topo_dump_summary();
     return;
   } else if( aocmd_cint_isprefix("enum",argv[1]) ) {
-    if( argc!=2 ) { Serial.printf("ERROR: 'enum' has too many args\n" ); return; }
+    if( argc==3 && aocmd_cint_isprefix("csv",argv[2]) ) { aomw_topo_dumpcsv(); return; }
+    if( argc!=2 ) { Serial.printf("ERROR: 'enum' expects nothing or 'csv'\n" ); return; }
     aomw_topo_dump_nodes();
     aomw_topo_dump_triplets();
     aomw_topo_dump_i2cbridges();
@@ -790,21 +3524,44 @@ static void aomw_topo_cmd( int argc, char * argv[] ) {
   } else if( aocmd_cint_isprefix("pwm",argv[1]) ) {
     if( argc<3 ) { Serial.printf("ERROR: 'pwm' expects <tix>\n" ); return; }
     if( aomw_topo_numtriplets()==0 ) Serial.printf("WARNING: forgot 'topo build'?\n" );
-    int tix;
-    bool ok= aocmd_cint_parse_dec(argv[2],&tix) ;
-    if( !ok || tix<0 || tix>=aomw_topo_numtriplets() ) { Serial.printf("ERROR: 'pwm' expects <tix> 0..%d, not %d\n", aomw_topo_numtriplets()-1, tix ); return; }
-    if( argc!=6 ) { Serial.printf("ERROR: expected <red> <green> <blue>\n" ); return; }
-    aomw_topo_rgb_t rgb;
-    ok= aocmd_cint_parse_hex(argv[3],&rgb.r) ;
-    if( !ok || rgb.r > AOMW_TOPO_BRIGHTNESS_MAX ) { Serial.printf("ERROR: 'pwm' expects <red> 0..%04X, not '%s'\n", AOMW_TOPO_BRIGHTNESS_MAX, argv[3] ); return; }
-    ok= aocmd_cint_parse_hex(argv[4],&rgb.g) ;
-    if( !ok || rgb.g > AOMW_TOPO_BRIGHTNESS_MAX ) { Serial.printf("ERROR: 'pwm' expects <green> 0..%04X, not '%s'\n", AOMW_TOPO_BRIGHTNESS_MAX, argv[4] ); return; }
-    ok= aocmd_cint_parse_hex(argv[5],&rgb.b) ;
-    if( !ok || rgb.b > AOMW_TOPO_BRIGHTNESS_MAX ) { Serial.printf("ERROR: 'pwm' expects <blue> 0..%04X, not '%s'\n", AOMW_TOPO_BRIGHTNESS_MAX, argv[5] ); return; }
-    // send telegram
-    aoresult_t result= aomw_topo_settriplet(tix,&rgb);
-    if( result!=aoresult_ok ) { Serial.printf("ERROR: 'pwm' failed (%s)\n",aoresult_to_str(result,1) ); return; }
-    if( argv[0][0]!='@' ) Serial.printf("pwm T%d: %04X %04X %04X\n",tix,rgb.r, rgb.g, rgb.b);
+    if( aocmd_cint_isprefix("hex",argv[2]) ) { aomw_topo_cmd_pwmhex(argc,argv); return; }
+    aomw_topo_cmd_pwmtuples(argc,argv);
+    return;
+  } else if( aocmd_cint_isprefix("sync",argv[1]) ) {
+    if( argc>3 ) { Serial.printf("ERROR: 'sync' has too many args\n" ); return; }
+    if( argc==3 ) {
+      int enable;
+      if( aocmd_cint_isprefix("on",argv[2]) ) enable=1;
+      else if( aocmd_cint_isprefix("off",argv[2]) ) enable=0;
+      else { Serial.printf("ERROR: 'sync' expects 'on' or 'off', not '%s'\n",argv[2] ); return; }
+      aoresult_t result= aomw_topo_sync_set(enable);
+      if( result!=aoresult_ok ) { Serial.printf("ERROR: 'sync' failed (%s)\n",aoresult_to_str(result,1) ); return; }
+    }
+    if( argv[0][0]!='@' ) Serial.printf("sync: %s\n", aomw_topo_sync_get() ? "on" : "off" );
+    return;
+  } else if( aocmd_cint_isprefix("power",argv[1]) ) {
+    if( argc>3 ) { Serial.printf("ERROR: 'power' has too many args\n" ); return; }
+    if( argc==3 ) {
+      int ma;
+      if( aocmd_cint_isprefix("off",argv[2]) ) ma=0;
+      else if( !aocmd_cint_parse_dec(argv[2],&ma) || ma<1 || ma>100000 ) { Serial.printf("ERROR: 'power' expects <ma> (1..100000) or 'off', not '%s'\n",argv[2] ); return; }
+      aomw_topo_power_budget_set(ma);
+    }
+    if( argv[0][0]!='@' ) {
+      if( aomw_topo_power_budget_get()==0 ) Serial.printf("power: budget off, ");
+      else Serial.printf("power: budget %lumA, ", (unsigned long)aomw_topo_power_budget_get() );
+      Serial.printf("framebuffer %lumA at dim %d, last flush dim %d\n", (unsigned long)aomw_topo_power_ma(), aomw_topo_dim_get(), aomw_topo_power_dim() );
+    }
+    return;
+  } else if( aocmd_cint_isprefix("bench",argv[1]) ) {
+    int num= 10;
+    if( argc>3 ) { Serial.printf("ERROR: 'bench' has too many args\n" ); return; }
+    if( argc==3 ) {
+      bool ok= aocmd_cint_parse_dec(argv[2],&num) ;
+      if( !ok || num<1 || num>10000 ) { Serial.printf("ERROR: 'bench' expects <num> (1..10000), not '%s'\n",argv[2] ); return; }
+    }
+    aoresult_t result= aomw_topo_bench(num);
+    if( result!=aoresult_ok ) { Serial.printf("ERROR: 'bench' failed (%s)\n",aoresult_to_str(result,1) ); return; }
     return;
   } else {
     Serial.printf("ERROR: 'topo' has unknown argument ('%s')\n", argv[1]); return;
@@ -816,9 +3573,10 @@ static void aomw_topo_cmd( int argc, char * argv[] ) {
 static const char aomw_topo_cmd_longhelp[] = 
   "SYNTAX: topo build\n"
   "- this resets, inits and scans all nodes on the chain creating the map\n"
-  "SYNTAX: topo [enum]\n"
+  "SYNTAX: topo [enum [csv]]\n"
   "- without argument, enumerates nodes (the topology map)\n"
   "- with argument, also enumerates triplets and i2c bridges\n"
+  "- with csv, prints nodes, triplets, i2c bridges and summary as CSV\n"
   "SYNTAX: topo dim [ <level> ]\n"
   "- without argument, shows current global dim level\n"
   "- with argument sets global dim level (0..1024)\n"
@@ -827,6 +3585,24 @@ static const char aomw_topo_cmd_longhelp[] =
   "- sets the pwm settings of RGB triplet <tix> (decimal)\n"
   "- <red> <green> <blue> are each 15 bits hex (0000..7FFF)\n"
   "- the 'topo dim' level is applied\n"
+  "SYNTAX: topo pwm <tix> <red> <green> <blue> ( <tix> <red> <green> <blue> )...\n"
+  "- bulk: sets up to 6 triplets; all are checked before any is set\n"
+  "SYNTAX: topo pwm hex <tix0> <blob>\n"
+  "- bulk: sets triplets <tix0>, <tix0>+1, ... from <blob>\n"
+  "- <blob> has 12 hex digits per triplet: 4 red, 4 green, 4 blue\n"
+  "- all forms go via the framebuffer; the given triplets are always sent\n"
+  "SYNTAX: topo sync [ on | off ]\n"
+  "- without argument, shows if sync mode is on\n"
+  "- with 'on', SAIDs latch pwm values; 'topo pwm' ends with a sync telegram\n"
+  "- so all triplets of a bulk 'topo pwm' change at once (RGBI nodes have no sync)\n"
+  "SYNTAX: topo power [ <ma> | off ]\n"
+  "- without argument, shows the budget and the estimated LED current of the framebuffer\n"
+  "- with <ma>, frames (framebuffer flushes, and all 'topo pwm') are scaled to that current\n"
+  "- so a bright frame does not cause under voltage; 'off' removes the budget\n"
+  "SYNTAX: topo bench [ <num> ]\n"
+  "- runs a build, timing each phase\n"
+  "- times <num> (default 10) single triplet writes, full chain refreshes and range fills\n"
+  "- reports telegrams/s, us/triplet and frames/s; chain is left dark\n"
   "NOTES:\n"
   "- a topology map tells which node types are at which address\n"
   "- the topology map must first be 'build' before any other 'topo' command\n"
@@ -25,48 +25,248 @@
 #include <aoresult.h>   // aoresult_t
 
 
+// All state of the topo module is in a context (aomw_topo_ctx_t, one per OSP chain). Every function that uses
+// state has a variant with suffix _ctx, that takes the context as first argument. The functions without the 
+// suffix are wrappers that use the default context (aomw_topo_ctx_default). See the end of this file.
+typedef struct aomw_topo_ctx_s aomw_topo_ctx_t;
+
+
+// Returns the generation of the map; it changes every time a build clears or completes the map.
+uint32_t aomw_topo_generation();
+uint32_t aomw_topo_generation_ctx( aomw_topo_ctx_t * ctx );
 // Returns if the current OSP chain has direction Loop (or BiDir).
 int aomw_topo_loop();
+int aomw_topo_loop_ctx( aomw_topo_ctx_t * ctx );
 // Returns the number of nodes in the scanned chain.
 uint16_t aomw_topo_numnodes();
+uint16_t aomw_topo_numnodes_ctx( aomw_topo_ctx_t * ctx );
 // Returns the identity of OSP node `addr`; 1<=addr<=aomw_topo_numnodes().
 uint32_t aomw_topo_node_id( uint16_t addr );
+uint32_t aomw_topo_node_id_ctx( aomw_topo_ctx_t * ctx, uint16_t addr );
 // Returns the number of triplets (RGB modules) of OSP node `addr`; 1<=addr<= aomw_topo_numnodes().
 uint8_t aomw_topo_node_numtriplets( uint16_t addr );
+uint8_t aomw_topo_node_numtriplets_ctx( aomw_topo_ctx_t * ctx, uint16_t addr );
 // Returns the index of the first triplet (RGB module) driven by OSP node `addr`; 1<=addr<=aomw_topo_numnodes().
 uint16_t aomw_topo_node_triplet1( uint16_t addr );
+uint16_t aomw_topo_node_triplet1_ctx( aomw_topo_ctx_t * ctx, uint16_t addr );
+// Returns the channels of OSP node `addr` that drive a triplet (bit c for channel c; 0 for RGBI); 1<=addr<=aomw_topo_numnodes().
+uint8_t aomw_topo_node_chanmask( uint16_t addr );
+uint8_t aomw_topo_node_chanmask_ctx( aomw_topo_ctx_t * ctx, uint16_t addr );
+// Channel masks for aomw_topo_chanmask_override()
+#define AOMW_TOPO_CHANMASK_ALL  0x07 // All three channels of a SAID drive a triplet
+#define AOMW_TOPO_CHANMASK_AUTO 0xFF // No override: the build derives the live channels from OTP
+// Overrides (for next builds) the channels of SAID `addr` that drive a triplet (eg unpopulated channels); `mask` AOMW_TOPO_CHANMASK_AUTO removes the override.
+aoresult_t aomw_topo_chanmask_override( uint16_t addr, uint8_t mask );
+aoresult_t aomw_topo_chanmask_override_ctx( aomw_topo_ctx_t * ctx, uint16_t addr, uint8_t mask );
 // Returns the number of triplets (RGB modules) in the scanned chain.
 uint16_t aomw_topo_numtriplets();
+uint16_t aomw_topo_numtriplets_ctx( aomw_topo_ctx_t * ctx );
 // Returns the address of the OSP node that drives triplet `tix`; 0<=tix<aomw_topo_numtriplets().
 uint16_t aomw_topo_triplet_addr( uint16_t tix );
+uint16_t aomw_topo_triplet_addr_ctx( aomw_topo_ctx_t * ctx, uint16_t tix );
 // Returns 1 if triplet `tix` is driven by an OSP node with channels; 0<=tix<aomw_topo_numtriplets().
 int aomw_topo_triplet_onchan( uint16_t tix );
+int aomw_topo_triplet_onchan_ctx( aomw_topo_ctx_t * ctx, uint16_t tix );
 // Returns the channel triplet `tix` is attached to in case the triplet is driven by an OSP node with channels, 0<=tix<aomw_topo_numtriplets(). Only defined when aomw_topo_triplet_onchan(tix).
 uint8_t aomw_topo_triplet_chan( uint16_t tix );
+uint8_t aomw_topo_triplet_chan_ctx( aomw_topo_ctx_t * ctx, uint16_t tix );
 // Returns the number of I2C bridges in the scanned chain.
 uint16_t aomw_topo_numi2cbridges();
+uint16_t aomw_topo_numi2cbridges_ctx( aomw_topo_ctx_t * ctx );
 // Returns the address of the OSP node that has I2C bridge `bix`; 0<=bix<aomw_topo_numi2cbridges().
 uint16_t aomw_topo_i2cbridge_addr( uint16_t bix );
+uint16_t aomw_topo_i2cbridge_addr_ctx( aomw_topo_ctx_t * ctx, uint16_t bix );
 
 
 // Prints on Serial a summary of the "topology map".
 void aomw_topo_dump_summary();
+void aomw_topo_dump_summary_ctx( aomw_topo_ctx_t * ctx );
 // Prints on Serial a list of nodes from the "topology map".
 void aomw_topo_dump_nodes();
+void aomw_topo_dump_nodes_ctx( aomw_topo_ctx_t * ctx );
 // Prints on Serial a list of triplets from the "topology map".
 void aomw_topo_dump_triplets();
+void aomw_topo_dump_triplets_ctx( aomw_topo_ctx_t * ctx );
 // Prints on Serial a list of I2C bridges from the "topology map".
 void aomw_topo_dump_i2cbridges();
+void aomw_topo_dump_i2cbridges_ctx( aomw_topo_ctx_t * ctx );
+// Prints on Serial the "topology map" as CSV (blocking); records N (node), T (triplet), I (I2C bridge), S (summary), each preceded by a # header.
+void aomw_topo_dumpcsv();
+void aomw_topo_dumpcsv_ctx( aomw_topo_ctx_t * ctx );
+// Part of the incremental CSV dump. Call this once, then follow up with aomw_topo_dumpcsv_step().
+void aomw_topo_dumpcsv_start();
+void aomw_topo_dumpcsv_start_ctx( aomw_topo_ctx_t * ctx );
+// Part of the incremental CSV dump. Call this until aomw_topo_dumpcsv_done(); only writes what Serial accepts without blocking.
+void aomw_topo_dumpcsv_step();
+void aomw_topo_dumpcsv_step_ctx( aomw_topo_ctx_t * ctx );
+// Part of the incremental CSV dump. Returns if all CSV lines are written.
+int aomw_topo_dumpcsv_done();
+int aomw_topo_dumpcsv_done_ctx( aomw_topo_ctx_t * ctx );
+
+
+// Returns a hash of the "topology map"; unlike the generation, it only changes when the chain changes.
+uint32_t aomw_topo_hash();
+uint32_t aomw_topo_hash_ctx( aomw_topo_ctx_t * ctx );
+// Result of comparing the "topology map" with the previous one (before the last build, import or install).
+typedef struct aomw_topo_diff_s {
+  int      changed;    // The maps differ
+  uint16_t numadded;   // Number of nodes only in the new map (at its end)
+  uint16_t numremoved; // Number of nodes only in the old map (at its end)
+  uint16_t numretyped; // Number of nodes in both maps, with different id or triplet count
+  uint16_t firstaddr;  // First address that is retyped, added or removed (0 if none)
+  uint16_t firsttix;   // First triplet whose address or channel changed (AOMW_TOPO_DIFF_NOTIX if none); later triplets are shifted
+} aomw_topo_diff_t;
+#define AOMW_TOPO_DIFF_NOTIX   0xFFFF
+// Compares the "topology map" with the previous one; O(N).
+aoresult_t aomw_topo_diff( aomw_topo_diff_t * diff );
+aoresult_t aomw_topo_diff_ctx( aomw_topo_ctx_t * ctx, aomw_topo_diff_t * diff );
+// Return values of aomw_topo_diff_node()
+#define AOMW_TOPO_DIFF_SAME    0
+#define AOMW_TOPO_DIFF_ADDED   1
+#define AOMW_TOPO_DIFF_REMOVED 2
+#define AOMW_TOPO_DIFF_RETYPED 3
+// Returns how node `addr` differs between the previous and the current "topology map"; AOMW_TOPO_DIFF_xxx.
+int aomw_topo_diff_node( uint16_t addr );
+int aomw_topo_diff_node_ctx( aomw_topo_ctx_t * ctx, uint16_t addr );
+
+
+// Returns the number of bytes needed to export the "topology map" as snapshot.
+int aomw_topo_snapshot_size();
+int aomw_topo_snapshot_size_ctx( aomw_topo_ctx_t * ctx );
+// Exports the "topology map" as versioned, checksummed binary blob in `buf` (of `size` bytes); `len` receives the bytes written.
+aoresult_t aomw_topo_snapshot_export( uint8_t * buf, int size, int * len );
+aoresult_t aomw_topo_snapshot_export_ctx( aomw_topo_ctx_t * ctx, uint8_t * buf, int size, int * len );
+// Imports a snapshot (from aomw_topo_snapshot_export) into the "topology map"; the next build then skips identifying nodes.
+aoresult_t aomw_topo_snapshot_import( const uint8_t * buf, int len );
+aoresult_t aomw_topo_snapshot_import_ctx( aomw_topo_ctx_t * ctx, const uint8_t * buf, int len );
+// Returns if the "topology map" was imported (and not yet verified by a build) or is fixed.
+int aomw_topo_snapshot_preloaded();
+int aomw_topo_snapshot_preloaded_ctx( aomw_topo_ctx_t * ctx );
+
+
+// A fixed topology is a chain layout declared at compile time; its tables live in flash. Declare the nodes
+// (in chain order, so the first one has address 1) with the AOMW_TOPO_FIXED_xxx() macros in a static constexpr
+// array, then let AOMW_TOPO_FIXED() compute the tables, e.g.
+//   static constexpr aomw_topo_fixednode_t mynodes[] = { AOMW_TOPO_FIXED_SAIDI2C(0x00000040), AOMW_TOPO_FIXED_RGBI(0x00000000) };
+//   AOMW_TOPO_FIXED(mychain, mynodes);
+//   ... aomw_topo_fixed_install(&mychain); aomw_topo_build(); // build verifies and configures only
+// Using AOMW_TOPO_FIXED() requires C++14 (loops in constexpr functions).
+#define AOMW_TOPO_CHAN_NONE 0xFF // Channel of a triplet in a node without channels (RGBI)
+// The map has a 16 bit record per node: an index in a table of the distinct node ids, the number of triplets, the live channels and flags.
+// The index of the first triplet of a node is only stored for every AOMW_TOPO_TRIPLET1_STRIDE-th node (addr 0, 16, ...).
+#define AOMW_TOPO_REC_IDIX              0x00FF // Record: index in the id table
+#define AOMW_TOPO_REC_NUMTRIPLETS       0x0300 // Record: number of triplets (0..3)
+#define AOMW_TOPO_REC_NUMTRIPLETS_SHIFT 8
+#define AOMW_TOPO_REC_I2CBRIDGE         0x0400 // Record flag: the node has an I2C bridge
+#define AOMW_TOPO_REC_CHANMASK          0x3800 // Record: the channels that drive a triplet (bit c for channel c; 0 for RGBI)
+#define AOMW_TOPO_REC_CHANMASK_SHIFT    11
+#define AOMW_TOPO_REC_MAKE(idix,numtriplets,chanmask,flags) ((uint16_t)((idix) | (numtriplets)<<AOMW_TOPO_REC_NUMTRIPLETS_SHIFT | (chanmask)<<AOMW_TOPO_REC_CHANMASK_SHIFT | (flags)))
+#define AOMW_TOPO_TRIPLET1_STRIDE       16
+typedef struct aomw_topo_fixednode_s { uint32_t id; uint8_t numtriplets; uint8_t i2cbridge; uint8_t chanmask; } aomw_topo_fixednode_t;
+#define AOMW_TOPO_FIXED_RGBI(id)    { (id), 1, 0, 0 } // RGBI: one triplet, no channel
+#define AOMW_TOPO_FIXED_SAID(id)    { (id), 3, 0, 0 } // SAID: three triplets, on channel 0, 1, 2
+#define AOMW_TOPO_FIXED_SAIDI2C(id) { (id), 2, 1, 0 } // SAID with I2C bridge: two triplets, on channel 0, 1
+#define AOMW_TOPO_FIXED_SAIDCHANS(id,mask,i2cbridge) { (id), (uint8_t)(((mask)&1)+((mask)>>1&1)+((mask)>>2&1)), (i2cbridge), (mask) } // SAID: a triplet per channel in `mask`
+// The tables of a fixed topology (node tables have an unused slot 0, since addresses start at 1)
+typedef struct aomw_topo_fixed_s {
+  uint16_t         numnodes;
+  uint16_t         numids;
+  const uint32_t * ids;
+  const uint16_t * node_rec;
+  const uint16_t * node_triplet1s;
+  uint16_t         numtriplets;
+  const uint16_t * triplet_addr;
+  const uint8_t  * triplet_chan;
+  uint16_t         numi2cbridges;
+  const uint16_t * i2cbridge_addr;
+  uint8_t          loop;
+} aomw_topo_fixed_t;
+// Compile time helpers for AOMW_TOPO_FIXED()
+template<int NN> constexpr int aomw_topo_fixed_numtriplets( const aomw_topo_fixednode_t (&nodes)[NN] ) {
+  int num= 0;
+  for( int i=0; i<NN; i++ ) num+= nodes[i].numtriplets;
+  return num;
+}
+template<int NN> constexpr int aomw_topo_fixed_numi2cbridges( const aomw_topo_fixednode_t (&nodes)[NN] ) {
+  int num= 0;
+  for( int i=0; i<NN; i++ ) num+= nodes[i].i2cbridge;
+  return num;
+}
+template<int NN> constexpr int aomw_topo_fixed_numids( const aomw_topo_fixednode_t (&nodes)[NN] ) {
+  int num= 0;
+  for( int i=0; i<NN; i++ ) {
+    int seen= 0;
+    for( int j=0; j<i; j++ ) if( nodes[j].id==nodes[i].id ) seen= 1;
+    num+= !seen;
+  }
+  return num;
+}
+template<int NN, int NT, int NB, int NI> struct aomw_topo_fixedtables_s {
+  uint32_t ids[NI>0?NI:1];
+  uint16_t node_rec[NN+1];
+  uint16_t node_triplet1s[NN/AOMW_TOPO_TRIPLET1_STRIDE+1];
+  uint16_t triplet_addr[NT>0?NT:1];
+  uint8_t  triplet_chan[NT>0?NT:1];
+  uint16_t i2cbridge_addr[NB>0?NB:1];
+};
+template<int NN, int NT, int NB, int NI> constexpr aomw_topo_fixedtables_s<NN,NT,NB,NI> aomw_topo_fixed_tables( const aomw_topo_fixednode_t (&nodes)[NN] ) {
+  aomw_topo_fixedtables_s<NN,NT,NB,NI> tables{};
+  int tix= 0;
+  int iix= 0;
+  int numids= 0;
+  for( int addr=1; addr<=NN; addr++ ) {
+    const aomw_topo_fixednode_t & node= nodes[addr-1];
+    int idix= 0;
+    while( idix<numids && tables.ids[idix]!=node.id ) idix++;
+    if( idix==numids ) tables.ids[numids++]= node.id;
+    if( addr%AOMW_TOPO_TRIPLET1_STRIDE==0 ) tables.node_triplet1s[addr/AOMW_TOPO_TRIPLET1_STRIDE]= tix;
+    int chanmask= 0;
+    for( int chan=0; chan<3; chan++ ) {
+      if( node.chanmask ? !(node.chanmask & (1<<chan)) : chan>=node.numtriplets ) continue;
+      tables.triplet_addr[tix]= addr;
+      tables.triplet_chan[tix]= node.numtriplets==1 && !node.i2cbridge && !node.chanmask ? AOMW_TOPO_CHAN_NONE : chan;
+      if( tables.triplet_chan[tix]!=AOMW_TOPO_CHAN_NONE ) chanmask|= 1<<chan;
+      tix++;
+    }
+    tables.node_rec[addr]= AOMW_TOPO_REC_MAKE(idix, node.numtriplets, chanmask, node.i2cbridge ? AOMW_TOPO_REC_I2CBRIDGE : 0);
+    if( node.i2cbridge ) tables.i2cbridge_addr[iix++]= addr;
+  }
+  return tables;
+}
+// Declares fixed topology `name` (of type aomw_topo_fixed_t) from `nodes`, a static constexpr array of aomw_topo_fixednode_t.
+// The chain is expected to have direction bidir; use AOMW_TOPO_FIXED_LOOP() for a chain with direction loop.
+#define AOMW_TOPO_FIXED(name, nodes) AOMW_TOPO_FIXED_(name, nodes, 0)
+#define AOMW_TOPO_FIXED_LOOP(name, nodes) AOMW_TOPO_FIXED_(name, nodes, 1)
+#define AOMW_TOPO_FIXED_(name, nodes, loop) \
+  static_assert( sizeof(nodes)/sizeof(nodes[0]) < AOMW_TOPO_MAXNODES, "fixed topology has too many nodes" ); \
+  static_assert( aomw_topo_fixed_numtriplets(nodes) <= AOMW_TOPO_MAXTRIPLETS, "fixed topology has too many triplets" ); \
+  static constexpr auto name##_tables = aomw_topo_fixed_tables< sizeof(nodes)/sizeof(nodes[0]), aomw_topo_fixed_numtriplets(nodes), aomw_topo_fixed_numi2cbridges(nodes), aomw_topo_fixed_numids(nodes) >(nodes); \
+  static const aomw_topo_fixed_t name = { \
+    sizeof(nodes)/sizeof(nodes[0]), aomw_topo_fixed_numids(nodes), name##_tables.ids, name##_tables.node_rec, name##_tables.node_triplet1s, \
+    aomw_topo_fixed_numtriplets(nodes), name##_tables.triplet_addr, name##_tables.triplet_chan, \
+    aomw_topo_fixed_numi2cbridges(nodes), name##_tables.i2cbridge_addr, (loop) \
+  }
+// Returns `tix` after asserting it is a triplet of fixed topology `fixed` (a constant `tix` folds the check away).
+static inline uint16_t aomw_topo_fixed_tix( const aomw_topo_fixed_t * fixed, uint16_t tix ) { AORESULT_ASSERT( tix<fixed->numtriplets ); return tix; }
+// Sets triplet `tix` of fixed topology `name` to `rgb`; with a constant `tix`, node address and channel are compile time constants.
+#define AOMW_TOPO_FIXED_SETTRIPLET(name, tix, rgb) aomw_topo_settriplet_at( name##_tables.triplet_addr[aomw_topo_fixed_tix(&name,tix)], name##_tables.triplet_chan[aomw_topo_fixed_tix(&name,tix)], rgb )
+// Installs fixed topology `fixed` as the "topology map"; the next build only verifies and configures.
+void aomw_topo_fixed_install( const aomw_topo_fixed_t * fixed );
+void aomw_topo_fixed_install_ctx( aomw_topo_ctx_t * ctx, const aomw_topo_fixed_t * fixed );
 
 
 // topo build in one run
 aoresult_t aomw_topo_build();
+aoresult_t aomw_topo_build_ctx( aomw_topo_ctx_t * ctx );
 // This function is part of the topology builder. Call this once, then follow up with aomw_topo_build_step().
 void aomw_topo_build_start();
+void aomw_topo_build_start_ctx( aomw_topo_ctx_t * ctx );
 // This function is part of the topology builder. Call this until aomw_topo_build_done(), but after aomw_topo_build_start().
 aoresult_t aomw_topo_build_step();
+aoresult_t aomw_topo_build_step_ctx( aomw_topo_ctx_t * ctx );
 // This function is part of the topology builder. Call this after aomw_topo_build_step(), to determine if another step() is needed.
 int aomw_topo_build_done();
+int aomw_topo_build_done_ctx( aomw_topo_ctx_t * ctx );
 
 
 // The topo module uses colors of type aomw_topo_rgb_t, their value should 
@@ -87,8 +287,16 @@ extern const aomw_topo_rgb_t aomw_topo_white;
 extern const aomw_topo_rgb_t aomw_topo_off;
 // Sets the color for triplet `tix` to `rgb` - this hides RGBI vs SAID qua current and triplet count
 aoresult_t aomw_topo_settriplet( uint16_t tix, const aomw_topo_rgb_t*rgb ); 
+aoresult_t aomw_topo_settriplet_ctx( aomw_topo_ctx_t * ctx, uint16_t tix, const aomw_topo_rgb_t*rgb );
+// Sets the color for the triplet on node `addr` channel `chan` (AOMW_TOPO_CHAN_NONE for RGBI) to `rgb`, without table lookup
+aoresult_t aomw_topo_settriplet_at( uint16_t addr, uint8_t chan, const aomw_topo_rgb_t*rgb ); 
+aoresult_t aomw_topo_settriplet_at_ctx( aomw_topo_ctx_t * ctx, uint16_t addr, uint8_t chan, const aomw_topo_rgb_t*rgb );
+// Sets the color for triplets tix0<=tix<tix1 to `rgb` (range fill)
+aoresult_t aomw_topo_settriplets( uint16_t tix0, uint16_t tix1, const aomw_topo_rgb_t*rgb ); 
+aoresult_t aomw_topo_settriplets_ctx( aomw_topo_ctx_t * ctx, uint16_t tix0, uint16_t tix1, const aomw_topo_rgb_t*rgb );
 // Sets the flags for node addr (if it is a SAID; r/g/b current settings as per topo standard)
 aoresult_t aomw_topo_node_setcurrents(uint16_t addr, uint8_t flags);
+aoresult_t aomw_topo_node_setcurrents_ctx( aomw_topo_ctx_t * ctx, uint16_t addr, uint8_t flags );
 
 
 // Default dim level in "prokibi": 100 is at 100/1024 or ~10% of max PWM. 
@@ -97,18 +305,260 @@ aoresult_t aomw_topo_node_setcurrents(uint16_t addr, uint8_t flags);
 #define AOMW_TOPO_DIM_DEFAULT 100 
 // Sets the global dim-level for aomw_topo_settriplet. Function clips to 0..1024.
 void aomw_topo_dim_set( int dim );
+void aomw_topo_dim_set_ctx( aomw_topo_ctx_t * ctx, int dim );
 // Gets the global dim-level
 int aomw_topo_dim_get();
+int aomw_topo_dim_get_ctx( aomw_topo_ctx_t * ctx );
+
+
+// Resets the remap; logical triplet index equals physical index.
+void aomw_topo_remap_identity();
+void aomw_topo_remap_identity_ctx( aomw_topo_ctx_t * ctx );
+// Mirrors (reverses) the logical triplets tix0<=tix<tix1.
+void aomw_topo_remap_mirror( uint16_t tix0, uint16_t tix1 );
+void aomw_topo_remap_mirror_ctx( aomw_topo_ctx_t * ctx, uint16_t tix0, uint16_t tix1 );
+// Rotates the logical triplets; the one at logical index `offset` moves to 0.
+void aomw_topo_remap_offset( int offset );
+void aomw_topo_remap_offset_ctx( aomw_topo_ctx_t * ctx, int offset );
+// Permutes the logical triplets; the one at logical index perm[tix] moves to tix.
+aoresult_t aomw_topo_remap_permute( const uint16_t * perm, uint16_t num );
+aoresult_t aomw_topo_remap_permute_ctx( aomw_topo_ctx_t * ctx, const uint16_t * perm, uint16_t num );
+// Returns the physical index of logical triplet `tix`.
+uint16_t aomw_topo_remap_phys( uint16_t tix );
+uint16_t aomw_topo_remap_phys_ctx( aomw_topo_ctx_t * ctx, uint16_t tix );
+// Returns the logical index of physical triplet `ptix`.
+uint16_t aomw_topo_remap_logical( uint16_t ptix );
+uint16_t aomw_topo_remap_logical_ctx( aomw_topo_ctx_t * ctx, uint16_t ptix );
+// Returns if the remap is the identity.
+int aomw_topo_remap_isidentity();
+int aomw_topo_remap_isidentity_ctx( aomw_topo_ctx_t * ctx );
+
+
+// Sets the color of (logical) triplet `tix` in the framebuffer (no telegram); returns 1 if it changed.
+int aomw_topo_fb_set( uint16_t tix, const aomw_topo_rgb_t * rgb );
+int aomw_topo_fb_set_ctx( aomw_topo_ctx_t * ctx, uint16_t tix, const aomw_topo_rgb_t * rgb );
+// Gets the color of (logical) triplet `tix` from the framebuffer.
+void aomw_topo_fb_get( uint16_t tix, aomw_topo_rgb_t * rgb );
+void aomw_topo_fb_get_ctx( aomw_topo_ctx_t * ctx, uint16_t tix, aomw_topo_rgb_t * rgb );
+// Marks all triplets of the framebuffer dirty (eg after a dim change).
+void aomw_topo_fb_invalidate();
+void aomw_topo_fb_invalidate_ctx( aomw_topo_ctx_t * ctx );
+// Returns the number of dirty triplets in the framebuffer.
+int aomw_topo_fb_numdirty();
+int aomw_topo_fb_numdirty_ctx( aomw_topo_ctx_t * ctx );
+// Sends the dirty triplets of the framebuffer, in physical order.
+aoresult_t aomw_topo_fb_flush();
+aoresult_t aomw_topo_fb_flush_ctx( aomw_topo_ctx_t * ctx );
+// Sends at most `max` dirty triplets of the framebuffer; a next call continues (for interleaving flushes).
+aoresult_t aomw_topo_fb_flush_some( int max );
+aoresult_t aomw_topo_fb_flush_some_ctx( aomw_topo_ctx_t * ctx, int max );
+
+// Enables (or disables) sync mode: SAIDs latch new pwm values until a sync telegram (RGBI nodes have no sync).
+aoresult_t aomw_topo_sync_set( int enable );
+aoresult_t aomw_topo_sync_set_ctx( aomw_topo_ctx_t * ctx, int enable );
+// Returns if sync mode is enabled.
+int aomw_topo_sync_get();
+int aomw_topo_sync_get_ctx( aomw_topo_ctx_t * ctx );
+// Broadcasts a sync telegram: all SAIDs in sync mode show their latched pwm values at once.
+aoresult_t aomw_topo_sync();
+aoresult_t aomw_topo_sync_ctx( aomw_topo_ctx_t * ctx );
+// Flushes the framebuffer and (in sync mode) commits it with one sync telegram.
+aoresult_t aomw_topo_fb_commit();
+aoresult_t aomw_topo_fb_commit_ctx( aomw_topo_ctx_t * ctx );
+
+// Sets the power budget (mA): a flush scales a frame whose estimated LED current exceeds it down (0: no budget).
+void aomw_topo_power_budget_set( uint32_t ma );
+void aomw_topo_power_budget_set_ctx( aomw_topo_ctx_t * ctx, uint32_t ma );
+// Returns the power budget (mA); 0 for no budget.
+uint32_t aomw_topo_power_budget_get();
+uint32_t aomw_topo_power_budget_get_ctx( aomw_topo_ctx_t * ctx );
+// Returns the estimated LED current (mA) of the framebuffer at the dim level (kept up to date by aomw_topo_fb_set).
+uint32_t aomw_topo_power_ma();
+uint32_t aomw_topo_power_ma_ctx( aomw_topo_ctx_t * ctx );
+// Returns the dim level of the last flush; lower than the dim level when the frame was scaled to the budget.
+int aomw_topo_power_dim();
+int aomw_topo_power_dim_ctx( aomw_topo_ctx_t * ctx );
+
+
+
+// Telegram types for which the cost (send time) is measured
+#define AOMW_TOPO_COST_SETPWM    0 // setpwm telegram (RGBI)
+#define AOMW_TOPO_COST_SETPWMCHN 1 // setpwmchn telegram (SAID)
+#define AOMW_TOPO_COST_NUM       2
+// Returns the moving average of the send time (us) of telegram type AOMW_TOPO_COST_XXX (0 when not measured yet).
+uint32_t aomw_topo_cost_us( int type );
+uint32_t aomw_topo_cost_us_ctx( aomw_topo_ctx_t * ctx, int type );
+// Forgets the measured costs.
+void aomw_topo_cost_reset();
+void aomw_topo_cost_reset_ctx( aomw_topo_ctx_t * ctx );
+// Predicts the time (us) to send `numtriplets` triplets (using the RGBI/SAID mix of the chain).
+uint32_t aomw_topo_predict_us( int numtriplets );
+uint32_t aomw_topo_predict_us_ctx( aomw_topo_ctx_t * ctx, int numtriplets );
+// Predicts the time (us) the next aomw_topo_fb_flush() takes.
+uint32_t aomw_topo_fb_predict_us();
+uint32_t aomw_topo_fb_predict_us_ctx( aomw_topo_ctx_t * ctx );
+
+
+// Encodings of a scene (aomw_topo_scene_save)
+#define AOMW_TOPO_SCENE_FLAGS_AUTO    0 // The smallest of palette and direct
+#define AOMW_TOPO_SCENE_FLAGS_DIRECT  1 // Runs with an 8 bit per component color
+#define AOMW_TOPO_SCENE_FLAGS_PALETTE 2 // Runs with an index in a palette of (max 32) exact colors
+// Saves the framebuffer and dim level as scene in an EEPROM (written only when different); `len` (may be NULL) gets the size.
+aoresult_t aomw_topo_scene_save( uint16_t addr, uint8_t daddr7, uint8_t raddr, int flags, int * len );
+aoresult_t aomw_topo_scene_save_ctx( aomw_topo_ctx_t * ctx, uint16_t addr, uint8_t daddr7, uint8_t raddr, int flags, int * len );
+// Configures the build to restore the scene from an EEPROM, right after the chain goes active (addr 0: no restore).
+void aomw_topo_scene_boot( uint16_t addr, uint8_t daddr7, uint8_t raddr );
+void aomw_topo_scene_boot_ctx( aomw_topo_ctx_t * ctx, uint16_t addr, uint8_t daddr7, uint8_t raddr );
+// Returns if the last build restored a scene.
+int aomw_topo_scene_restored();
+int aomw_topo_scene_restored_ctx( aomw_topo_ctx_t * ctx );
+
+// Max number of triplets in the (RAM) topology map; also the size of a zone
+#define AOMW_TOPO_MAXTRIPLETS    200 // Theoretical max is 3000 (3 triplets on 1000 SAIDs)
+#define AOMW_TOPO_ZONE_NUMWORDS  ((AOMW_TOPO_MAXTRIPLETS+31)/32)
+// A zone is a set of (logical) triplets; a bitset with bit tix%32 of bits[tix/32] for triplet tix
+typedef struct aomw_topo_zone_s { uint32_t bits[AOMW_TOPO_ZONE_NUMWORDS]; } aomw_topo_zone_t;
+// Makes `zone` empty.
+void aomw_topo_zone_clear( aomw_topo_zone_t * zone );
+// Adds triplets tix0<=tix<tix1 to `zone`.
+void aomw_topo_zone_addrange( aomw_topo_zone_t * zone, uint16_t tix0, uint16_t tix1 );
+// Removes triplets tix0<=tix<tix1 from `zone`.
+void aomw_topo_zone_removerange( aomw_topo_zone_t * zone, uint16_t tix0, uint16_t tix1 );
+// Adds the triplets of node `addr` to `zone`.
+void aomw_topo_zone_addnode( aomw_topo_zone_t * zone, uint16_t addr );
+void aomw_topo_zone_addnode_ctx( aomw_topo_ctx_t * ctx, aomw_topo_zone_t * zone, uint16_t addr );
+// Returns if triplet `tix` is in `zone`.
+int aomw_topo_zone_has( const aomw_topo_zone_t * zone, uint16_t tix );
+// Returns the number of triplets in `zone`.
+int aomw_topo_zone_count( const aomw_topo_zone_t * zone );
+// dst = z1 + z2
+void aomw_topo_zone_union( aomw_topo_zone_t * dst, const aomw_topo_zone_t * z1, const aomw_topo_zone_t * z2 );
+// dst = z1 * z2
+void aomw_topo_zone_intersect( aomw_topo_zone_t * dst, const aomw_topo_zone_t * z1, const aomw_topo_zone_t * z2 );
+// dst = z1 - z2
+void aomw_topo_zone_diff( aomw_topo_zone_t * dst, const aomw_topo_zone_t * z1, const aomw_topo_zone_t * z2 );
+// Sets all triplets in `zone` to `rgb` (telegram per triplet).
+aoresult_t aomw_topo_zone_settriplets( const aomw_topo_zone_t * zone, const aomw_topo_rgb_t * rgb );
+aoresult_t aomw_topo_zone_settriplets_ctx( aomw_topo_ctx_t * ctx, const aomw_topo_zone_t * zone, const aomw_topo_rgb_t * rgb );
+// Sets all triplets in `zone` to `rgb` in the framebuffer (no telegrams).
+void aomw_topo_zone_fb_set( const aomw_topo_zone_t * zone, const aomw_topo_rgb_t * rgb );
+void aomw_topo_zone_fb_set_ctx( aomw_topo_ctx_t * ctx, const aomw_topo_zone_t * zone, const aomw_topo_rgb_t * rgb );
+// Sends the dirty triplets of the framebuffer that are in `zone`.
+aoresult_t aomw_topo_zone_flush( const aomw_topo_zone_t * zone );
+aoresult_t aomw_topo_zone_flush_ctx( aomw_topo_ctx_t * ctx, const aomw_topo_zone_t * zone );
 
 
 // Searches the entire OSP chain for SAIDs with an I2C bridge, and on the associated I2C bus searches for an I2C device with address `daddr7`.
 aoresult_t aomw_topo_i2cfind( int daddr7, uint16_t * addr );
+aoresult_t aomw_topo_i2cfind_ctx( aomw_topo_ctx_t * ctx, int daddr7, uint16_t * addr );
 
 
 //Registers the "topo" command with the command interpreter.
 int aomw_topo_cmd_register();
 
 
+// Sizes of the topology map in a context (AOMW_TOPO_MAXTRIPLETS is defined above)
+#define AOMW_TOPO_MAXNODES       100 // Theoretical max is 1000 (addr space of OSP)
+#define AOMW_TOPO_MAXIDS           8 // Distinct node ids in a chain (typically one for RGBI and one for SAID)
+#define AOMW_TOPO_MAXI2CBRIDGES    5 // Theoretical max is 1000 (every one of the 1000 SAIDs)
+#define AOMW_TOPO_SCENE_MAXSIZE  256 // Size of the EEPROMs (aomw_eeprom) holding a scene
+#define AOMW_TOPO_DUMP_BUFSIZE   256 // Size of the buffer the dump functions format into
+// Undimmed color of one triplet in the framebuffer
+typedef struct aomw_topo_fbpix_s { uint16_t r; uint16_t g; uint16_t b; } aomw_topo_fbpix_t;
+// The state of the topo module for one OSP chain. The fields are private to aomw_topo.cpp, use the _ctx functions.
+// Declare a context as global or static variable (the default member initializers set it up), and do not copy it
+// (it has pointers to its own tables). Contexts share no mutable state.
+// Note that all contexts send their telegrams via aoosp/aospi, which drives one SPI port; a firmware with several
+// chains must route the telegrams of each context to its own port (and serialize access to a shared port).
+struct aomw_topo_ctx_s {
+  // The map: a build (or snapshot import) fills the tables in RAM; a fixed topology (aomw_topo_fixed_install) has
+  // its tables in flash. The observers use the pointers, that point to one or the other.
+  int               loop;                                           // Chain has direction loop (1) or bidir (0)
+  uint16_t          last;                                           // The address of the last node (response from INIT telegram)
+  uint32_t          ids_ram[AOMW_TOPO_MAXIDS];                      // The distinct identities reported by the nodes
+  uint16_t          node_rec_ram[AOMW_TOPO_MAXNODES];               // Per node: index in ids, number of triplets (RGBI: 1, SAID: 0..3) and flags
+  uint16_t          node_triplet1s_ram[AOMW_TOPO_MAXNODES/AOMW_TOPO_TRIPLET1_STRIDE+1]; // The first triplet of every 16th node (addr 0, 16, ...)
+  uint16_t          triplet_addr_ram[AOMW_TOPO_MAXTRIPLETS];        // The address of the node this triplet belongs to
+  uint8_t           triplet_chan_ram[AOMW_TOPO_MAXTRIPLETS];        // The channel of the node this triplet is connected to (AOMW_TOPO_CHAN_NONE for RGBI)
+  uint16_t          i2cbridge_addr_ram[AOMW_TOPO_MAXI2CBRIDGES];    // The address of the node this i2c bridge belongs to
+  uint16_t          numnodes;                                       // The number of nodes in the chain (at the end of scan must be equal to last)
+  uint16_t          numids;                                         // The number of distinct identities
+  const uint32_t *  ids = ids_ram;                                  // The distinct identities reported by the nodes
+  const uint16_t *  node_rec = node_rec_ram;                        // Per node: index in ids, number of triplets and flags (AOMW_TOPO_REC_xxx)
+  const uint16_t *  node_triplet1s = node_triplet1s_ram;            // The first triplet of every 16th node; derived for the others
+  uint16_t          numtriplets;                                    // Number of triplets in the chain
+  const uint16_t *  triplet_addr = triplet_addr_ram;                // The address of the node this triplet belongs to
+  const uint8_t  *  triplet_chan = triplet_chan_ram;                // The channel of the node this triplet is connected to
+  uint16_t          numi2cbridges;                                  // Number of I2C bridges in the chain (SAIDs with OTP flag)
+  const uint16_t *  i2cbridge_addr = i2cbridge_addr_ram;            // The address of the node this i2c bridge belongs to
+  uint32_t          generation = 1;                                 // Incremented each time the map is cleared or completed (by a build)
+  uint32_t          hash;                                           // Rolling hash over the node records (see aomw_topo_hash)
+  int               preloaded;                                      // The map was imported (not yet verified) or is fixed; the next build skips identifying
+  // The previous map (for aomw_topo_diff)
+  uint16_t          prev_numnodes;                                  // The number of nodes in the previous map
+  uint16_t          prev_numtriplets;                               // The number of triplets in the previous map
+  uint32_t          prev_hash;                                      // The hash of the previous map
+  uint16_t          prev_numids;                                    // The number of distinct identities of the previous map
+  uint32_t          prev_ids[AOMW_TOPO_MAXIDS];                     // The distinct identities of the previous map
+  uint16_t          prev_node_rec[AOMW_TOPO_MAXNODES];              // The node records of the previous map
+  // The build
+  int               build_state;                                    // Current state of the build (a aomw_topo_build_state_t)
+  aoresult_t        build_result;                                   // Persistent storage of last result (when build is done)
+  int               build_substate;                                 // Node or I2C bridge a build state iterates over
+  uint8_t           chanmask_override[AOMW_TOPO_MAXNODES];          // Per node: 0 (no override), or AOMW_TOPO_CHANMASK_OVERRIDE|mask
+  // The remap (logical tix to physical tix), baked into tables per logical tix
+  uint16_t          remap_num;                                      // Number of triplets the remap is for
+  uint16_t          remap_keepnum;                                  // Number of triplets remap_l2p was made for; a build of that size restores it
+  int               remap_isidentity = 1;                           // The remap is the identity (logical tix equals physical tix)
+  uint16_t          remap_l2p[AOMW_TOPO_MAXTRIPLETS];               // The physical tix of each logical tix
+  uint16_t          remap_p2l[AOMW_TOPO_MAXTRIPLETS];               // The logical tix of each physical tix (inverse of l2p)
+  uint16_t          ltriplet_addr_ram[AOMW_TOPO_MAXTRIPLETS];       // Baked: the address of the node driving each logical triplet
+  uint8_t           ltriplet_chan_ram[AOMW_TOPO_MAXTRIPLETS];       // Baked: the channel driving each logical triplet
+  const uint16_t *  ltriplet_addr = triplet_addr_ram;               // Node address per logical tix (the physical table when identity)
+  const uint8_t  *  ltriplet_chan = triplet_chan_ram;               // Channel per logical tix (the physical table when identity)
+  // The framebuffer, indexed by physical tix
+  aomw_topo_fbpix_t fb[AOMW_TOPO_MAXTRIPLETS];                      // The undimmed colors
+  uint32_t          fb_dirty[AOMW_TOPO_ZONE_NUMWORDS];              // Bit per physical tix: fb differs from what was sent
+  int               dim = AOMW_TOPO_DIM_DEFAULT;                    // The over all dim level (0..1024)
+  int               sync;                                           // Sync mode: SAIDs latch pwm values until a sync telegram
+  // Power budget
+  uint32_t          power_budget_ua;                                // Max estimated LED current (uA) of a flushed frame; 0 for no budget
+  uint32_t          power_fb_ua;                                    // Estimated LED current (uA) of the undimmed framebuffer, cached for power_generation
+  uint32_t          power_generation;                               // Generation for which power_fb_ua was computed (updated incrementally by fb_set)
+  int               fb_dim = AOMW_TOPO_DIM_DEFAULT;                 // The dim level of the last flush (dim, or lower to fit the budget)
+  uint16_t          power_sent_ua[AOMW_TOPO_MAXTRIPLETS];           // Per physical tix: estimated current (uA) of the triplet as last sent by topo
+  uint32_t          power_chain_ua;                                 // Sum of power_sent_ua: estimated current of the chain
+  // Telegram cost
+  uint32_t          cost[AOMW_TOPO_COST_NUM];                       // EWMA of the cost per telegram type (in 1/16 us); 0 when there was no sample
+  uint16_t          numonchan;                                      // Number of triplets on a channel (SAID), cached for numonchan_generation
+  uint32_t          numonchan_generation;                           // Generation for which numonchan was counted
+  // Broadcast fills
+  uint8_t           bcast_kinds;                                    // Broadcasts a whole chain fill needs (AOMW_TOPO_BCAST_xxx), cached for bcast_generation
+  uint16_t          bcast_numtele;                                  // Telegrams a whole chain fill needs, cached for bcast_generation
+  uint32_t          bcast_generation;                               // Generation for which bcast_kinds and bcast_numtele were determined
+  // Scene
+  uint8_t           scene_buf[AOMW_TOPO_SCENE_MAXSIZE];             // The encoded scene (being saved or loaded)
+  uint16_t          scene_addr;                                     // Restore: the node with the I2C bridge to the EEPROM (0 for no restore)
+  uint8_t           scene_daddr7;                                   // Restore: the I2C address of the EEPROM
+  uint8_t           scene_raddr;                                    // Restore: the address in the EEPROM
+  int               scene_restored;                                 // The last build restored a scene
+  int               scene_booted;                                   // A build (since aomw_topo_scene_boot) considered restoring the scene
+  uint32_t          scene_boothash;                                 // The hash of the map of that build (a rebuild restores only when it differs)
+  int               scene_len;                                      // Load: size of the scene (known after the header is loaded)
+  int               scene_pos;                                      // Load: bytes loaded; stream: offset of the next run
+  int               scene_runleft;                                  // Stream: triplets left in the current run
+  uint16_t          scene_ptix;                                     // Stream: next (physical) triplet to send
+  aomw_topo_fbpix_t scene_color;                                    // Stream: color of the current run
+  // Dump
+  char              dump_buf[AOMW_TOPO_DUMP_BUFSIZE];               // Formatted, but not yet written characters
+  int               dump_len;                                       // Number of characters in dump_buf
+  int               dump_pos;                                       // Number of characters of dump_buf already written (only used by the incremental csv dump)
+  int               dumpcsv_lix;                                    // The index of the next line of the incremental csv dump to format
+};
+// The default context, used by all functions without _ctx suffix (and by the topo command).
+extern aomw_topo_ctx_t aomw_topo_ctx_default;
+
+
 #endif
 
 
@@ -0,0 +1,228 @@
+// aomw_trace.cpp - optional ring buffer tracing the telegrams sent by the middleware
+/*****************************************************************************
+ * Copyright 2024 by ams OSRAM AG                                            *
+ * All rights are reserved.                                                  *
+ *                                                                           *
+ * IMPORTANT - PLEASE READ CAREFULLY BEFORE COPYING, INSTALLING OR USING     *
+ * THE SOFTWARE.                                                             *
+ *                                                                           *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS       *
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT         *
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS         *
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT  *
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,     *
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT          *
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,     *
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY     *
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT       *
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE     *
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.      *
+ *****************************************************************************/
+#include <Arduino.h>     // Serial.printf
+#include <aocmd.h>       // aocmd_cint_register()
+#include <aomw_trace.h>  // own
+
+
+// The trace ring records (timestamp, telegram type, addr, payload) of every 
+// telegram that aomw_topo sends (and thus also what aomw_tscript and 
+// aomw_flag send, since they render via topo). The ring is lock-free with 
+// a single producer: an entry is written first, then the head is published
+// (release). A reader copies an entry and then checks (acquire fence, then 
+// re-reading the head) that the head did not move so far that the entry 
+// was overwritten meanwhile. The slot of entry `head` may be being written,
+// so that of entry head-AOMW_TRACE_SIZE is not readable: the ring holds at
+// most AOMW_TRACE_SIZE-1 readable entries.
+// The dump is CSV, which extras/aomw_trace_replay.py replays against a 
+// mocked chain.
+
+
+#if AOMW_TRACE_ENABLED
+static_assert( (AOMW_TRACE_SIZE & (AOMW_TRACE_SIZE-1))==0, "AOMW_TRACE_SIZE must be a power of 2" );
+static aomw_trace_entry_t aomw_trace_ring[AOMW_TRACE_SIZE]; // The entries, entry n is at n%AOMW_TRACE_SIZE
+#endif
+static uint32_t aomw_trace_head; // Number of entries ever added (since clear); only written by the producer
+static uint32_t aomw_trace_tail; // Number of the oldest entry still of interest (set by clear)
+
+
+/*!
+    @brief  Appends an entry to the trace ring, overwriting the oldest 
+            entry when the ring is full.
+    @param  type
+            The telegram type, AOMW_TRACE_TYPE_xxx.
+    @param  addr
+            The address of the node the telegram is sent to (0 for broadcast).
+    @param  chan
+            The channel (0xFF if not applicable).
+    @param  d0
+            Payload, depends on type (see AOMW_TRACE_TYPE_xxx).
+    @param  d1
+            Payload, depends on type.
+    @param  d2
+            Payload, depends on type.
+    @note   Do not call directly, but use macro AOMW_TRACE(), which compiles
+            to nothing when tracing is disabled.
+    @note   Single producer: only call from one task.
+*/
+void aomw_trace_add( uint8_t type, uint16_t addr, uint8_t chan, uint16_t d0, uint16_t d1, uint16_t d2 ) {
+  #if AOMW_TRACE_ENABLED
+    uint32_t head= aomw_trace_head;
+    aomw_trace_entry_t * entry= &aomw_trace_ring[head%AOMW_TRACE_SIZE];
+    entry->us= micros();
+    entry->type= type;
+    entry->chan= chan;
+    entry->addr= addr;
+    entry->d[0]= d0;
+    entry->d[1]= d1;
+    entry->d[2]= d2;
+    __atomic_store_n(&aomw_trace_head, head+1, __ATOMIC_RELEASE); // publish
+  #else
+    (void)type; (void)addr; (void)chan; (void)d0; (void)d1; (void)d2;
+  #endif
+}
+
+
+/*!
+    @brief  Empties the trace ring.
+*/
+void aomw_trace_clear() {
+  aomw_trace_tail= __atomic_load_n(&aomw_trace_head, __ATOMIC_ACQUIRE);
+}
+
+
+// Returns the number of the oldest entry still in the ring (the slot of entry `head` may be being overwritten).
+static uint32_t aomw_trace_oldest( uint32_t head ) {
+  #if AOMW_TRACE_ENABLED
+    uint32_t oldest= head>=AOMW_TRACE_SIZE ? head-AOMW_TRACE_SIZE+1 : 0;
+    return oldest>aomw_trace_tail ? oldest : aomw_trace_tail;
+  #else
+    return head;
+  #endif
+}
+
+
+/*!
+    @brief  Returns the number of entries in the trace ring.
+    @return 0..AOMW_TRACE_SIZE-1 (always 0 when tracing is disabled).
+*/
+int aomw_trace_count() {
+  uint32_t head= __atomic_load_n(&aomw_trace_head, __ATOMIC_ACQUIRE);
+  return head - aomw_trace_oldest(head);
+}
+
+
+/*!
+    @brief  Copies an entry from the trace ring.
+    @param  ix
+            The index of the entry; 0 is the oldest, aomw_trace_count()-1
+            the newest.
+    @param  entry
+            Output parameter, receives the entry.
+    @return 1 if successful, 0 if the entry does not exist (anymore); the
+            producer may have overwritten it while the caller was reading.
+*/
+int aomw_trace_get( int ix, aomw_trace_entry_t * entry ) {
+  #if AOMW_TRACE_ENABLED
+    uint32_t head= __atomic_load_n(&aomw_trace_head, __ATOMIC_ACQUIRE);
+    uint32_t num= aomw_trace_oldest(head) + ix;
+    if( ix<0 || num>=head ) return 0;
+    *entry= aomw_trace_ring[num%AOMW_TRACE_SIZE];
+    __atomic_thread_fence(__ATOMIC_ACQUIRE); // the copy completes before head is read again
+    head= __atomic_load_n(&aomw_trace_head, __ATOMIC_RELAXED);
+    return head-num < AOMW_TRACE_SIZE; // producer did not start overwriting the slot while copying
+  #else
+    (void)ix; (void)entry;
+    return 0;
+  #endif
+}
+
+
+// Names of the trace types
+static const char * const aomw_trace_type_names[AOMW_TRACE_TYPE_COUNT] = {
+  "resetinit", "identify", "i2cenable", "clrerror", "setsetup", "setcurchn", "goactive", "setpwm", "setpwmchn", "sync"
+};
+
+
+/*!
+    @brief  Returns the name of a trace type.
+    @param  type
+            The telegram type, AOMW_TRACE_TYPE_xxx.
+    @return The name, e.g. "setpwmchn", or "unknown".
+*/
+const char * aomw_trace_type_str( uint8_t type ) {
+  if( type>=AOMW_TRACE_TYPE_COUNT ) return "unknown";
+  return aomw_trace_type_names[type];
+}
+
+
+/*!
+    @brief  Prints on Serial all entries of the trace ring as CSV, 
+            oldest first.
+    @note   Format: a header line "#us,type,addr,chan,d0,d1,d2", then one
+            line per entry. The time stamps are in micro seconds; `chan`
+            is empty when not applicable.
+    @note   The producer may continue adding; entries overwritten during 
+            the dump are skipped.
+*/
+void aomw_trace_dump() {
+  Serial.printf("#us,type,addr,chan,d0,d1,d2\n");
+  int count= aomw_trace_count();
+  int skipped= 0;
+  for( int ix=0; ix<count; ix++ ) {
+    aomw_trace_entry_t entry;
+    if( !aomw_trace_get(ix,&entry) ) { skipped++; continue; }
+    Serial.printf("%lu,%s,%d,", (unsigned long)entry.us, aomw_trace_type_str(entry.type), entry.addr );
+    if( entry.chan!=0xFF ) Serial.printf("%d", entry.chan );
+    Serial.printf(",%04X,%04X,%04X\n", entry.d[0], entry.d[1], entry.d[2] );
+  }
+  if( skipped>0 ) Serial.printf("#skipped %d (overwritten)\n",skipped);
+}
+
+
+// === command handler =======================================================
+
+
+// The handler for the "trace" command
+static void aomw_trace_cmd( int argc, char * argv[] ) {
+  if( !AOMW_TRACE_ENABLED ) Serial.printf("WARNING: tracing not compiled in (AOMW_TRACE_ENABLED)\n"); 
+  if( argc==1 ) {
+    aomw_trace_dump();
+    return;
+  } else if( aocmd_cint_isprefix("clear",argv[1]) ) {
+    if( argc!=2 ) { Serial.printf("ERROR: 'clear' has too many args\n" ); return; }
+    aomw_trace_clear();
+    if( argv[0][0]!='@' ) Serial.printf("trace cleared\n");
+    return;
+  } else if( aocmd_cint_isprefix("count",argv[1]) ) {
+    if( argc!=2 ) { Serial.printf("ERROR: 'count' has too many args\n" ); return; }
+    Serial.printf("trace %d/%d entries\n", aomw_trace_count(), AOMW_TRACE_SIZE );
+    return;
+  } else {
+    Serial.printf("ERROR: 'trace' has unknown argument ('%s')\n", argv[1]); return;
+  }
+}
+
+
+// The long help text for the "trace" command.
+static const char aomw_trace_cmd_longhelp[] = 
+  "SYNTAX: trace\n"
+  "- dumps the telegram trace as CSV (oldest first)\n"
+  "SYNTAX: trace clear\n"
+  "- empties the telegram trace\n"
+  "SYNTAX: trace count\n"
+  "- shows how many telegrams are in the trace\n"
+  "NOTES:\n"
+  "- the trace records telegrams sent by the topo module (and tscript, flag)\n"
+  "- tracing must be compiled in (AOMW_TRACE_ENABLED in aomw_trace.h)\n"
+  "- extras/aomw_trace_replay.py replays a dump against a mocked chain\n"
+  "- supports @-prefix to suppress output\n"
+;
+
+
+/*!
+    @brief  Registers the "trace" command with the command interpreter.
+    @return Number of remaining registration slots (or -1 if registration failed).
+*/
+int aomw_trace_cmd_register() {
+  return aocmd_cint_register(aomw_trace_cmd, "trace", "dump the telegram trace", aomw_trace_cmd_longhelp);
+}
+
@@ -0,0 +1,93 @@
+// aomw_trace.h - optional ring buffer tracing the telegrams sent by the middleware
+/*****************************************************************************
+ * Copyright 2024 by ams OSRAM AG                                            *
+ * All rights are reserved.                                                  *
+ *                                                                           *
+ * IMPORTANT - PLEASE READ CAREFULLY BEFORE COPYING, INSTALLING OR USING     *
+ * THE SOFTWARE.                                                             *
+ *                                                                           *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS       *
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT         *
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS         *
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT  *
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,     *
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT          *
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,     *
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY     *
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT       *
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE     *
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.      *
+ *****************************************************************************/
+#ifndef _AOMW_TRACE_H_
+#define _AOMW_TRACE_H_
+
+
+#include <stdint.h>    // uint16_t
+
+
+// Tracing is a compile time option; when disabled (0) AOMW_TRACE() compiles 
+// to nothing and there is no ring buffer. Enable by defining it as 1 (here, 
+// or as build flag).
+#ifndef AOMW_TRACE_ENABLED
+#define AOMW_TRACE_ENABLED 0
+#endif
+// Number of entries in the trace ring (must be a power of 2).
+#ifndef AOMW_TRACE_SIZE
+#define AOMW_TRACE_SIZE 256
+#endif
+
+
+// Telegram types recorded in the trace
+#define AOMW_TRACE_TYPE_RESETINIT  0 // addr=last, d0=loop
+#define AOMW_TRACE_TYPE_IDENTIFY   1 
+#define AOMW_TRACE_TYPE_I2CENABLE  2 // readotp of the channel configuration (I2C bridge, clustering)
+#define AOMW_TRACE_TYPE_CLRERROR   3
+#define AOMW_TRACE_TYPE_SETSETUP   4 // d0=flags
+#define AOMW_TRACE_TYPE_SETCURCHN  5 // chan, d0=flags, d1=red<<8|green current, d2=blue current
+#define AOMW_TRACE_TYPE_GOACTIVE   6
+#define AOMW_TRACE_TYPE_SETPWM     7 // d0..d2=r/g/b (topo brightness range, after dimming)
+#define AOMW_TRACE_TYPE_SETPWMCHN  8 // chan, d0..d2=r/g/b (topo brightness range, after dimming)
+#define AOMW_TRACE_TYPE_SYNC       9 // broadcast (addr 0) commit of latched pwm values
+#define AOMW_TRACE_TYPE_COUNT     10
+
+
+// One trace entry (16 bytes).
+typedef struct aomw_trace_entry_s {
+  uint32_t us;     // Timestamp (micros()) just before sending
+  uint8_t  type;   // AOMW_TRACE_TYPE_xxx
+  uint8_t  chan;   // Channel (0xFF when not applicable)
+  uint16_t addr;   // Node address (0 for broadcast)
+  uint16_t d[3];   // Payload, depends on type
+} aomw_trace_entry_t;
+
+
+// Records a telegram; compiles to nothing when AOMW_TRACE_ENABLED is 0.
+#if AOMW_TRACE_ENABLED
+#define AOMW_TRACE(type,addr,chan,d0,d1,d2) aomw_trace_add(type,addr,chan,d0,d1,d2)
+#else
+#define AOMW_TRACE(type,addr,chan,d0,d1,d2) do { } while(0)
+#endif
+
+
+// Appends an entry to the trace ring (overwriting the oldest). Use AOMW_TRACE() instead.
+void aomw_trace_add( uint8_t type, uint16_t addr, uint8_t chan, uint16_t d0, uint16_t d1, uint16_t d2 );
+// Empties the trace ring.
+void aomw_trace_clear();
+// Returns the number of entries in the trace ring (0..AOMW_TRACE_SIZE-1).
+int aomw_trace_count();
+// Copies entry `ix` (0 is the oldest of aomw_trace_count()) to `entry`; returns 0 if that entry was overwritten meanwhile.
+int aomw_trace_get( int ix, aomw_trace_entry_t * entry );
+// Returns the name of trace type `type`.
+const char * aomw_trace_type_str( uint8_t type );
+// Prints on Serial the trace ring as CSV (oldest first).
+void aomw_trace_dump();
+
+
+//Registers the "trace" command with the command interpreter.
+int aomw_trace_cmd_register();
+
+
+#endif
+
+
+